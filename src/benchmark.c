@@ -0,0 +1,821 @@
+/* 
+*  BSD 2-Clause “Simplified” License
+*  Copyright (c) 2019, Aldrik Ramaekers, aldrik.ramaekers@protonmail.com
+*  All rights reserved.
+*/
+
+typedef struct t_benchmark_read_args
+{
+	file_reader *reader;
+	u64 bytes_read;
+	u64 files_read;
+	u64 files_failed;
+} benchmark_read_args;
+
+static void *benchmark_file_reads_consumer(void *args)
+{
+	benchmark_read_args *info = args;
+	
+	file_read read;
+	while (file_reader_next(info->reader, &read))
+	{
+		if (read.content.content)
+		{
+			info->bytes_read += read.content.content_length;
+			info->files_read++;
+		}
+		else
+		{
+			info->files_failed++;
+		}
+		file_reader_release(info->reader, &read);
+	}
+	
+	return 0;
+}
+
+static char *benchmark_file_name(char *buffer, char *directory, s32 index)
+{
+#ifdef OS_LINUX
+	snprintf(buffer, MAX_INPUT_LENGTH, "%s/bench_%07d.txt", directory, index);
+#endif
+#ifdef OS_WIN
+	snprintf(buffer, MAX_INPUT_LENGTH, "%s\\bench_%07d.txt", directory, index);
+#endif
+	return buffer;
+}
+
+static void benchmark_generate_small_files(char *directory, s32 file_count, s32 file_size)
+{
+	char path[MAX_INPUT_LENGTH];
+	
+	// files are generated once and reused by later runs
+	if (platform_file_exists(benchmark_file_name(path, directory, file_count-1)) &&
+		platform_get_file_size(path) == file_size)
+		return;
+	
+	if (!platform_directory_exists(directory))
+		platform_create_directory(directory);
+	
+	char *buffer = mem_alloc(file_size);
+	for (s32 i = 0; i < file_size; i++)
+	{
+		buffer[i] = (i % 64 == 63) ? '\n' : 'a' + (i % 26);
+	}
+	
+	for (s32 i = 0; i < file_count; i++)
+	{
+		platform_write_file_content(benchmark_file_name(path, directory, i), "wb", buffer, file_size);
+	}
+	
+	mem_free(buffer);
+}
+
+void benchmark_file_reads(char *directory, s32 file_count, s32 file_size)
+{
+	benchmark_generate_small_files(directory, file_count, file_size);
+	
+	// paths have to outlive the reader
+	s32 path_length = strlen(directory) + 20;
+	char *paths = mem_alloc(path_length*file_count);
+	char path[MAX_INPUT_LENGTH];
+	for (s32 i = 0; i < file_count; i++)
+	{
+		string_copyn(paths+(i*path_length), benchmark_file_name(path, directory, i), path_length-1);
+	}
+	
+	s32 thread_count = platform_get_cpu_count();
+	if (thread_count < 1) thread_count = 1;
+	
+	file_reader_backend backends[] = { FILE_READER_THREAD_POOL, FILE_READER_IO_URING };
+	for (s32 b = 0; b < sizeof(backends)/sizeof(file_reader_backend); b++)
+	{
+		u64 stamp = platform_get_time(TIME_FULL, TIME_US);
+		
+		file_reader *reader = file_reader_create_ex(thread_count, 0, backends[b]);
+		
+		// skip io_uring when it fell back, it would be measured twice
+		if (reader->backend != backends[b])
+		{
+			printf("benchmark=file_reads backend=io_uring available=0\n");
+			file_reader_destroy(reader);
+			continue;
+		}
+		
+		benchmark_read_args *args = mem_alloc(sizeof(benchmark_read_args)*thread_count);
+		thread *consumers = mem_alloc(sizeof(thread)*thread_count);
+		for (s32 i = 0; i < thread_count; i++)
+		{
+			args[i].reader = reader;
+			args[i].bytes_read = 0;
+			args[i].files_read = 0;
+			args[i].files_failed = 0;
+			consumers[i] = thread_start(benchmark_file_reads_consumer, &args[i]);
+		}
+		
+		for (s32 i = 0; i < file_count; i++)
+		{
+			file_reader_submit(reader, paths+(i*path_length), 0);
+		}
+		file_reader_finish_submitting(reader);
+		
+		u64 bytes_read = 0;
+		u64 files_read = 0;
+		u64 files_failed = 0;
+		for (s32 i = 0; i < thread_count; i++)
+		{
+			thread_join(&consumers[i]);
+			bytes_read += args[i].bytes_read;
+			files_read += args[i].files_read;
+			files_failed += args[i].files_failed;
+		}
+		
+		f32 elapsed_ms = timer_elapsed_ms(stamp);
+		printf("benchmark=file_reads backend=%s threads=%d files=%llu failed=%llu bytes=%llu elapsed_ms=%.2f files_per_s=%.0f mb_per_s=%.2f\n",
+			   reader->backend == FILE_READER_IO_URING ? "io_uring" : "thread_pool",
+			   thread_count, (unsigned long long)files_read, (unsigned long long)files_failed,
+			   (unsigned long long)bytes_read, elapsed_ms,
+			   files_read / (elapsed_ms / 1000.0f),
+			   (bytes_read / (1024.0f*1024.0f)) / (elapsed_ms / 1000.0f));
+		
+		file_reader_destroy(reader);
+		mem_free(consumers);
+		mem_free(args);
+	}
+	
+	mem_free(paths);
+}
+static u32 benchmark_random(u32 *seed)
+{
+	*seed = *seed * 1103515245 + 12345;
+	return (*seed >> 16) & 0x7FFF;
+}
+
+// deterministic english-like text with lines of 40-120 characters
+static char *benchmark_generate_text(s64 size, u32 seed)
+{
+	char *words[] = { "the", "of", "and", "search", "file", "result", "thread", "memory",
+		"window", "buffer", "return", "value", "static", "include", "error", "string",
+		"platform", "directory", "match", "line", "render", "input", "config", "data" };
+	s32 word_count = sizeof(words)/sizeof(char*);
+	
+	char *text = mem_alloc(size+1);
+	s64 length = 0;
+	s32 line_length = 0;
+	s32 line_limit = 40 + benchmark_random(&seed) % 80;
+	while (length < size)
+	{
+		char *word = words[benchmark_random(&seed) % word_count];
+		while (*word && length < size)
+		{
+			text[length++] = *word++;
+			line_length++;
+		}
+		
+		if (length < size)
+		{
+			if (line_length >= line_limit)
+			{
+				text[length++] = '\n';
+				line_length = 0;
+				line_limit = 40 + benchmark_random(&seed) % 80;
+			}
+			else
+			{
+				text[length++] = ' ';
+				line_length++;
+			}
+		}
+	}
+	text[length] = 0;
+	
+	return text;
+}
+
+static void benchmark_search_text(char *name, char *kernel, char *text, s64 text_length, char *query, bool use_wildcard_matcher, bool ignore_case)
+{
+	array matches = array_create(sizeof(text_match));
+	matches.reserve_jump = 1000;
+	
+	u64 stamp = platform_get_time(TIME_FULL, TIME_US);
+	if (use_wildcard_matcher)
+		string_contains_wildcard(text, query, &matches, 0, ignore_case);
+	else if (ignore_case)
+		string_contains_ignore_case(text, query, &matches, 0);
+	else
+		string_contains_ex(text, query, &matches, 0);
+	f32 elapsed_ms = timer_elapsed_ms(stamp);
+	
+	printf("benchmark=%s kernel=%s ignore_case=%d query=\"%s\" bytes=%lld matches=%u elapsed_ms=%.2f gb_per_s=%.3f\n",
+		   name, kernel, ignore_case, query, (long long)text_length, matches.length, elapsed_ms,
+		   (text_length / (1000.0f*1000.0f*1000.0f)) / (elapsed_ms / 1000.0f));
+	
+	array_destroy(&matches);
+}
+
+void benchmark_literal_search(s64 corpus_size)
+{
+	char *text = benchmark_generate_text(corpus_size, 1);
+	char *queries[] = { "e", "match", "directory buffer", "not in the corpus" };
+	text_search_kernel kernels[] = { TEXT_SEARCH_KERNEL_SCALAR, TEXT_SEARCH_KERNEL_SSE2, TEXT_SEARCH_KERNEL_AVX2 };
+	
+	for (s32 q = 0; q < sizeof(queries)/sizeof(char*); q++)
+	{
+		for (s32 ignore_case = 0; ignore_case < 2; ignore_case++)
+		{
+			benchmark_search_text("literal_search", "wildcard", text, corpus_size, queries[q], true, ignore_case);
+			
+			for (s32 k = 0; k < sizeof(kernels)/sizeof(text_search_kernel); k++)
+			{
+				text_search_set_kernel(kernels[k]);
+				if (text_search_active_kernel != kernels[k]) continue;
+				
+				benchmark_search_text("literal_search", text_search_kernel_name(kernels[k]), text, corpus_size, queries[q], false, ignore_case);
+			}
+		}
+	}
+	
+	text_search_set_kernel(TEXT_SEARCH_KERNEL_AUTO);
+	mem_free(text);
+}
+
+static void benchmark_search_needle(char *text_type, char *algorithm, text_search_needle *needle, char *text, s64 text_length)
+{
+	u64 stamp = platform_get_time(TIME_FULL, TIME_US);
+	
+	s64 match_count = 0;
+	s64 offset = 0;
+	while (offset < text_length)
+	{
+		s64 result = text_search_find_needle(needle, text+offset, text_length-offset);
+		if (result == -1) break;
+		
+		match_count++;
+		offset += result+1;
+	}
+	f32 elapsed_ms = timer_elapsed_ms(stamp);
+	
+	printf("benchmark=pattern_matrix text=%s algorithm=%s pattern_length=%d bytes=%lld matches=%lld elapsed_ms=%.2f gb_per_s=%.3f\n",
+		   text_type, algorithm, needle->length, (long long)text_length, (long long)match_count, elapsed_ms,
+		   (text_length / (1000.0f*1000.0f*1000.0f)) / (elapsed_ms / 1000.0f));
+}
+
+void benchmark_pattern_matrix(s64 corpus_size)
+{
+	char *text_types[] = { "english", "random", "dna", "repetitive" };
+	s32 pattern_lengths[] = { 2, 4, 8, 16, 32, 64, 128, 256 };
+	
+	char *needle_buffer = mem_alloc(256+1);
+	for (s32 t = 0; t < sizeof(text_types)/sizeof(char*); t++)
+	{
+		u32 seed = 7;
+		char *text;
+		if (t == 0)
+		{
+			text = benchmark_generate_text(corpus_size, 1);
+		}
+		else
+		{
+			text = mem_alloc(corpus_size+1);
+			for (s64 i = 0; i < corpus_size; i++)
+			{
+				if (t == 1) text[i] = 1 + benchmark_random(&seed) % 255;
+				if (t == 2) text[i] = "ACGT"[benchmark_random(&seed) % 4];
+				if (t == 3) text[i] = 'a';
+			}
+			text[corpus_size] = 0;
+		}
+		
+		for (s32 p = 0; p < sizeof(pattern_lengths)/sizeof(s32); p++)
+		{
+			s32 length = pattern_lengths[p];
+			
+			// needles are taken from a different part of the same kind of text,
+			// the repetitive text gets a needle that almost matches everywhere
+			if (t == 3)
+			{
+				memset(needle_buffer, 'a', length);
+				needle_buffer[length/2] = 'b';
+			}
+			else
+			{
+				s64 from = (benchmark_random(&seed) * 7919) % (corpus_size - length);
+				memcpy(needle_buffer, text+from, length);
+				needle_buffer[length-1] = t == 2 ? 'C' : 'e';
+			}
+			needle_buffer[length] = 0;
+			
+			text_search_needle needle = text_search_needle_create(needle_buffer, length);
+			text_search_algorithm chosen = needle.algorithm;
+			
+			needle.algorithm = TEXT_SEARCH_FIRST_LAST_FILTER;
+			benchmark_search_needle(text_types[t], "first_last_filter", &needle, text, corpus_size);
+			needle.algorithm = TEXT_SEARCH_TWO_WAY;
+			benchmark_search_needle(text_types[t], "two_way", &needle, text, corpus_size);
+			needle.algorithm = chosen;
+			benchmark_search_needle(text_types[t], chosen == TEXT_SEARCH_TWO_WAY ? "auto_two_way" : "auto_first_last_filter", &needle, text, corpus_size);
+			text_search_needle_destroy(&needle);
+		}
+		
+		mem_free(text);
+	}
+	mem_free(needle_buffer);
+}
+
+static void benchmark_generate_text_files(char *directory, s32 file_count, s32 file_size)
+{
+	char path[MAX_INPUT_LENGTH];
+	
+	if (platform_file_exists(benchmark_file_name(path, directory, file_count-1)) &&
+		platform_get_file_size(path) == file_size)
+		return;
+	
+	if (!platform_directory_exists(directory))
+		platform_create_directory(directory);
+	
+	for (s32 i = 0; i < file_count; i++)
+	{
+		char *text = benchmark_generate_text(file_size, i+1);
+		
+		// one file in a hundred contains the rare word
+		if (i % 100 == 0) memcpy(text + file_size/2, "zanzibar", 8);
+		
+		platform_write_file_content(benchmark_file_name(path, directory, i), "wb", text, file_size);
+		mem_free(text);
+	}
+}
+
+static void benchmark_trigram_search(array *files, trigram_index *index, char *query)
+{
+	u64 stamp = platform_get_time(TIME_FULL, TIME_US);
+	
+	trigram_index_query index_query = trigram_index_query_create(index, query, false);
+	
+	s32 thread_count = platform_get_cpu_count();
+	file_reader *reader = file_reader_create(thread_count, 0);
+	s32 candidate_count = 0;
+	for (s32 i = 0; i < files->length; i++)
+	{
+		char *path = ((found_file*)files->data)[i].path;
+		if (!trigram_index_may_match(index, &index_query, path)) continue;
+		
+		file_reader_submit(reader, path, 0);
+		candidate_count++;
+	}
+	file_reader_finish_submitting(reader);
+	
+	s32 match_count = 0;
+	file_read read;
+	while (file_reader_next(reader, &read))
+	{
+		if (read.content.content && string_contains_ex(read.content.content, query, 0, 0))
+			match_count++;
+		file_reader_release(reader, &read);
+	}
+	file_reader_destroy(reader);
+	trigram_index_query_destroy(&index_query);
+	
+	f32 elapsed_ms = timer_elapsed_ms(stamp);
+	printf("benchmark=trigram_index query=%s indexed=%d files=%d candidates=%d matches=%d elapsed_ms=%.2f\n",
+		   query, index->is_open, files->length, candidate_count, match_count, elapsed_ms);
+}
+
+void benchmark_trigram_index(char *directory, s32 file_count, s32 file_size)
+{
+	benchmark_generate_text_files(directory, file_count, file_size);
+	
+	char index_path[MAX_INPUT_LENGTH];
+	snprintf(index_path, MAX_INPUT_LENGTH, "%strigram.index", directory);
+	
+	u64 stamp = platform_get_time(TIME_FULL, TIME_US);
+	trigram_index_build *build = trigram_index_build_start(directory, "bench_*", false, 0, index_path);
+	while (!build->done) thread_sleep(1000);
+	s32 indexed_count = build->files_indexed;
+	bool built = trigram_index_build_finish(build);
+	printf("benchmark=trigram_index_build files=%d succeeded=%d elapsed_ms=%.2f index_bytes=%d\n",
+		   indexed_count, built, timer_elapsed_ms(stamp), platform_get_file_size(index_path));
+	
+	array files = array_create(sizeof(found_file));
+	files.reserve_jump = 1000;
+	memory_bucket bucket = memory_bucket_init(megabytes(1));
+	file_filter filter = file_filter_create("bench_*");
+	bool cancelled = false;
+	platform_list_files_block(&files, directory, &filter, false, &bucket, false, &cancelled, 0);
+	file_filter_destroy(&filter);
+	
+	char *queries[] = { "zanzibar", "search result", "platform*buffer", "xylophone" };
+	trigram_index no_index;
+	memset(&no_index, 0, sizeof(trigram_index));
+	trigram_index index = trigram_index_open(index_path);
+	for (s32 q = 0; q < sizeof(queries)/sizeof(char*); q++)
+	{
+		benchmark_trigram_search(&files, &no_index, queries[q]);
+		benchmark_trigram_search(&files, &index, queries[q]);
+	}
+	trigram_index_close(&index);
+	
+	memory_bucket_destroy(&bucket);
+	array_destroy(&files);
+}
+
+static void benchmark_search_regex(char *query, char *text, s64 text_length)
+{
+	array matches = array_create(sizeof(text_match));
+	matches.reserve_jump = 1000;
+	
+	u64 stamp = platform_get_time(TIME_FULL, TIME_US);
+	text_regex *regex = text_regex_create(query, false);
+	text_regex_search(regex, text, text_length, &matches, 0);
+	f32 elapsed_ms = timer_elapsed_ms(stamp);
+	
+	printf("benchmark=regex_search query=\"%s\" literal=\"%s\" bytes=%lld matches=%u elapsed_ms=%.2f gb_per_s=%.3f\n",
+		   query, regex->has_literal ? regex->literal_text : "", (long long)text_length, matches.length, elapsed_ms,
+		   (text_length / (1000.0f*1000.0f*1000.0f)) / (elapsed_ms / 1000.0f));
+	
+	text_regex_destroy(regex);
+	array_destroy(&matches);
+}
+
+void benchmark_regex_search(s64 corpus_size)
+{
+	char *text = benchmark_generate_text(corpus_size, 1);
+	
+	char *wildcard_queries[] = { "dir*buffer", "mat?h" };
+	for (s32 q = 0; q < sizeof(wildcard_queries)/sizeof(char*); q++)
+		benchmark_search_text("regex_search", "wildcard", text, corpus_size, wildcard_queries[q], true, false);
+	
+	char *queries[] = { "dir.*buffer", "mat.h", "match", "\\bmatch(es|ed)?\\b", "[a-z]+ing\\b", "^[a-z]+ [a-z]+$", "(e+e+)+x", "not in the (corpus|text)" };
+	for (s32 q = 0; q < sizeof(queries)/sizeof(char*); q++)
+		benchmark_search_regex(queries[q], text, corpus_size);
+	
+	mem_free(text);
+}
+
+benchmark_corpus benchmark_corpus_create(s32 depth, s32 fan_out, s32 files_per_directory, s32 min_file_size, s32 max_file_size, f32 matches_per_mb)
+{
+	benchmark_corpus corpus;
+	corpus.depth = depth;
+	corpus.fan_out = fan_out;
+	corpus.files_per_directory = files_per_directory;
+	corpus.min_file_size = min_file_size < 16 ? 16 : min_file_size;
+	corpus.max_file_size = max_file_size < corpus.min_file_size ? corpus.min_file_size : max_file_size;
+	corpus.matches_per_mb = matches_per_mb;
+	corpus.seed = 1;
+	
+	return corpus;
+}
+
+typedef struct t_benchmark_corpus_totals
+{
+	s32 file_count;
+	s32 dir_count;
+	u64 byte_count;
+	s64 match_count;
+} benchmark_corpus_totals;
+
+// picks a doubling of min_file_size first and a size within it second
+static s32 benchmark_corpus_file_size(benchmark_corpus *corpus, u32 *seed)
+{
+	s32 doublings = 0;
+	while (((s64)corpus->min_file_size << (doublings+1)) <= corpus->max_file_size) doublings++;
+	
+	s64 low = (s64)corpus->min_file_size << (benchmark_random(seed) % (doublings+1));
+	s64 high = low*2 > corpus->max_file_size ? corpus->max_file_size : low*2;
+	s64 range = high - low;
+	if (range <= 0) return low;
+	
+	u32 r = (benchmark_random(seed) << 15) | benchmark_random(seed);
+	return low + (r % range);
+}
+
+static void benchmark_corpus_directory(char *directory, benchmark_corpus *corpus, s32 level, u32 *seed, bool generate, benchmark_corpus_totals *totals)
+{
+	char *extensions[] = { "txt", "c", "h", "md", "log" };
+	s32 extension_count = sizeof(extensions)/sizeof(char*);
+	char path[MAX_INPUT_LENGTH];
+	
+	if (generate && !platform_directory_exists(directory))
+		platform_create_directory(directory);
+	totals->dir_count++;
+	
+	for (s32 i = 0; i < corpus->files_per_directory; i++)
+	{
+		s32 size = benchmark_corpus_file_size(corpus, seed);
+		
+		// the fraction of a match is a chance of one more
+		f32 expected = corpus->matches_per_mb * size / (1024.0f*1024.0f);
+		s32 match_count = (s32)expected;
+		if (benchmark_random(seed) / 32768.0f < expected - match_count) match_count++;
+		if (match_count > size / 16) match_count = size / 16;
+		
+		// every match gets its own slot so they can't overlap
+		s32 slot_size = match_count ? size / match_count : 0;
+		s32 *offsets = match_count ? mem_alloc(sizeof(s32)*match_count) : 0;
+		for (s32 m = 0; m < match_count; m++)
+		{
+			u32 r = (benchmark_random(seed) << 15) | benchmark_random(seed);
+			offsets[m] = m*slot_size + r % (slot_size - 8);
+		}
+		
+		if (generate)
+		{
+			char *text = benchmark_generate_text(size, totals->file_count+1);
+			for (s32 m = 0; m < match_count; m++)
+				memcpy(text + offsets[m], BENCHMARK_CORPUS_QUERY, 8);
+			
+			snprintf(path, MAX_INPUT_LENGTH, "%sbench_%06d.%s", directory, totals->file_count, extensions[totals->file_count % extension_count]);
+			platform_write_file_content(path, "wb", text, size);
+			mem_free(text);
+		}
+		if (offsets) mem_free(offsets);
+		
+		totals->file_count++;
+		totals->byte_count += size;
+		totals->match_count += match_count;
+	}
+	
+	if (level == corpus->depth) return;
+	for (s32 i = 0; i < corpus->fan_out; i++)
+	{
+#ifdef OS_LINUX
+		snprintf(path, MAX_INPUT_LENGTH, "%sdir_%d/", directory, i);
+#endif
+#ifdef OS_WIN
+		snprintf(path, MAX_INPUT_LENGTH, "%sdir_%d\\", directory, i);
+#endif
+		benchmark_corpus_directory(path, corpus, level+1, seed, generate, totals);
+	}
+}
+
+// the tree is generated again when corpus.txt in directory was written for other parameters
+static benchmark_corpus_totals benchmark_generate_corpus(char *name, char *directory, benchmark_corpus *corpus)
+{
+	char marker_path[MAX_INPUT_LENGTH];
+	snprintf(marker_path, MAX_INPUT_LENGTH, "%scorpus.txt", directory);
+	
+	char parameters[200];
+	snprintf(parameters, sizeof(parameters), "depth=%d fan_out=%d files_per_directory=%d min_file_size=%d max_file_size=%d matches_per_mb=%.3f seed=%u\n",
+			 corpus->depth, corpus->fan_out, corpus->files_per_directory, corpus->min_file_size,
+			 corpus->max_file_size, corpus->matches_per_mb, corpus->seed);
+	
+	file_content marker = platform_read_file_content(marker_path, "rb");
+	bool generate = !marker.content || marker.content_length != strlen(parameters) ||
+		memcmp(marker.content, parameters, marker.content_length) != 0;
+	platform_destroy_file_content(&marker);
+	
+	benchmark_corpus_totals totals;
+	memset(&totals, 0, sizeof(benchmark_corpus_totals));
+	u32 seed = corpus->seed;
+	
+	u64 stamp = platform_get_time(TIME_FULL, TIME_US);
+	benchmark_corpus_directory(directory, corpus, 0, &seed, generate, &totals);
+	if (generate) platform_write_file_content(marker_path, "wb", parameters, strlen(parameters));
+	
+	printf("benchmark=%s phase=generate generated=%d dirs=%d files=%d bytes=%llu matches=%lld elapsed_ms=%.2f\n",
+		   name, generate, totals.dir_count, totals.file_count, (unsigned long long)totals.byte_count,
+		   (long long)totals.match_count, timer_elapsed_ms(stamp));
+	
+	return totals;
+}
+
+typedef struct t_benchmark_search_args
+{
+	file_reader *reader;
+	search_info *info;
+	array latencies; // u32, microseconds of searching one file
+	u64 bytes_searched;
+	s32 files_searched;
+	s32 files_matched;
+	s64 match_count;
+} benchmark_search_args;
+
+static void *benchmark_search_consumer(void *args)
+{
+	benchmark_search_args *search = args;
+	
+	array matches = array_create(sizeof(text_match));
+	matches.reserve_jump = 1000;
+	bool cancelled = false;
+	
+	file_read read;
+	while (file_reader_next(search->reader, &read))
+	{
+		if (read.content.content)
+		{
+			u64 stamp = platform_get_time(TIME_FULL, TIME_US);
+			matches.length = 0;
+			if (text_search_content(&read.content, BENCHMARK_CORPUS_QUERY, 0, &matches, &cancelled, false, BINARY_FILES_SKIP, search->info))
+			{
+				search->files_matched++;
+				search->match_count += matches.length;
+			}
+			u32 latency = platform_get_time(TIME_FULL, TIME_US) - stamp;
+			array_push(&search->latencies, &latency);
+			
+			search->bytes_searched += read.content.content_length;
+			search->files_searched++;
+		}
+		file_reader_release(search->reader, &read);
+	}
+	
+	array_destroy(&matches);
+	return 0;
+}
+
+static s32 benchmark_compare_u32(const void *a, const void *b)
+{
+	u32 left = *(u32*)a;
+	u32 right = *(u32*)b;
+	return (left > right) - (left < right);
+}
+
+static u32 benchmark_percentile(array *sorted, s32 percentile)
+{
+	if (!sorted->length) return 0;
+	
+	s32 index = ((s64)sorted->length * percentile) / 100;
+	if (index >= sorted->length) index = sorted->length-1;
+	return *(u32*)array_at(sorted, index);
+}
+
+void benchmark_search_throughput(char *directory, benchmark_corpus corpus, s32 thread_count)
+{
+	if (thread_count < 1) thread_count = platform_get_cpu_count();
+	if (thread_count < 1) thread_count = 1;
+	
+	benchmark_corpus_totals totals = benchmark_generate_corpus("search_throughput", directory, &corpus);
+	
+	// walk
+	array files = array_create(sizeof(found_file));
+	files.reserve_jump = 1000;
+	memory_bucket bucket = memory_bucket_init(megabytes(1));
+	search_info info;
+	memset(&info, 0, sizeof(search_info));
+	bool cancelled = false;
+	
+	u64 stamp = platform_get_time(TIME_FULL, TIME_US);
+	file_filter walk_filter = file_filter_create("bench_*");
+	platform_list_files_block(&files, directory, &walk_filter, true, &bucket, false, &cancelled, &info);
+	file_filter_destroy(&walk_filter);
+	f32 elapsed_ms = timer_elapsed_ms(stamp);
+	
+	printf("benchmark=search_throughput phase=walk files=%u dirs=%llu elapsed_ms=%.2f files_per_s=%.0f peak_rss_kb=%llu\n",
+		   files.length, (unsigned long long)info.dir_count, elapsed_ms, files.length / (elapsed_ms / 1000.0f),
+		   (unsigned long long)(platform_get_peak_memory_usage() / 1024));
+	
+	// filter, the names are matched often enough to take measurable time
+	s32 filter_passes = 100;
+	s32 filter_matches = 0;
+	file_filter filter = file_filter_create(BENCHMARK_CORPUS_FILTER);
+	stamp = platform_get_time(TIME_FULL, TIME_US);
+	for (s32 p = 0; p < filter_passes; p++)
+	{
+		filter_matches = 0;
+		for (s32 i = 0; i < files.length; i++)
+		{
+			char *path = ((found_file*)files.data)[i].path;
+			char *name = path + strlen(path);
+			while (name > path && name[-1] != '/' && name[-1] != '\\') name--;
+			
+			char *matched_filter;
+			if (file_filter_matches(&filter, name, &matched_filter) != -1) filter_matches++;
+		}
+	}
+	elapsed_ms = timer_elapsed_ms(stamp);
+	file_filter_destroy(&filter);
+	
+	printf("benchmark=search_throughput phase=filter filter=\"%s\" files=%u passes=%d matched=%d elapsed_ms=%.2f files_per_s=%.0f peak_rss_kb=%llu\n",
+		   BENCHMARK_CORPUS_FILTER, files.length, filter_passes, filter_matches, elapsed_ms,
+		   ((f32)files.length * filter_passes) / (elapsed_ms / 1000.0f),
+		   (unsigned long long)(platform_get_peak_memory_usage() / 1024));
+	
+	// content search of every walked file
+	stamp = platform_get_time(TIME_FULL, TIME_US);
+	file_reader *reader = file_reader_create(thread_count, 0);
+	benchmark_search_args *args = mem_alloc(sizeof(benchmark_search_args)*thread_count);
+	thread *consumers = mem_alloc(sizeof(thread)*thread_count);
+	for (s32 i = 0; i < thread_count; i++)
+	{
+		memset(&args[i], 0, sizeof(benchmark_search_args));
+		args[i].reader = reader;
+		args[i].info = &info;
+		args[i].latencies = array_create(sizeof(u32));
+		args[i].latencies.reserve_jump = 1000;
+		consumers[i] = thread_start(benchmark_search_consumer, &args[i]);
+	}
+	
+	for (s32 i = 0; i < files.length; i++)
+	{
+		file_reader_submit(reader, ((found_file*)files.data)[i].path, 0);
+	}
+	file_reader_finish_submitting(reader);
+	
+	array latencies = array_create(sizeof(u32));
+	latencies.reserve_jump = files.length ? files.length : 1;
+	u64 bytes_searched = 0;
+	s32 files_searched = 0;
+	s32 files_matched = 0;
+	s64 match_count = 0;
+	for (s32 i = 0; i < thread_count; i++)
+	{
+		thread_join(&consumers[i]);
+		bytes_searched += args[i].bytes_searched;
+		files_searched += args[i].files_searched;
+		files_matched += args[i].files_matched;
+		match_count += args[i].match_count;
+		
+		for (s32 l = 0; l < args[i].latencies.length; l++)
+			array_push(&latencies, array_at(&args[i].latencies, l));
+		array_destroy(&args[i].latencies);
+	}
+	elapsed_ms = timer_elapsed_ms(stamp);
+	file_reader_destroy(reader);
+	
+	qsort(latencies.data, latencies.length, sizeof(u32), benchmark_compare_u32);
+	
+	printf("benchmark=search_throughput phase=search threads=%d query=%s files=%d bytes=%llu matched=%d matches=%lld expected_matches=%lld elapsed_ms=%.2f files_per_s=%.0f mb_per_s=%.2f p50_us=%u p99_us=%u peak_rss_kb=%llu\n",
+		   thread_count, BENCHMARK_CORPUS_QUERY, files_searched, (unsigned long long)bytes_searched,
+		   files_matched, (long long)match_count, (long long)totals.match_count, elapsed_ms,
+		   files_searched / (elapsed_ms / 1000.0f), (bytes_searched / (1024.0f*1024.0f)) / (elapsed_ms / 1000.0f),
+		   benchmark_percentile(&latencies, 50), benchmark_percentile(&latencies, 99),
+		   (unsigned long long)(platform_get_peak_memory_usage() / 1024));
+	
+	array_destroy(&latencies);
+	mem_free(consumers);
+	mem_free(args);
+	memory_bucket_destroy(&bucket);
+	array_destroy(&files);
+}
+void benchmark_file_schedule(char *directory, benchmark_corpus corpus, s32 thread_count)
+{
+	if (thread_count < 1) thread_count = platform_get_cpu_count();
+	if (thread_count < 1) thread_count = 1;
+	
+	benchmark_generate_corpus("file_schedule", directory, &corpus);
+	
+	array files = array_create(sizeof(found_file));
+	files.reserve_jump = 1000;
+	memory_bucket bucket = memory_bucket_init(megabytes(1));
+	file_filter filter = file_filter_create("bench_*");
+	bool cancelled = false;
+	platform_list_files_block(&files, directory, &filter, true, &bucket, false, &cancelled, 0);
+	file_filter_destroy(&filter);
+	
+	file_schedule_order orders[] = { FILE_SCHEDULE_LISTED, FILE_SCHEDULE_INODE, FILE_SCHEDULE_EXTENT };
+	for (s32 o = 0; o < sizeof(orders)/sizeof(file_schedule_order); o++)
+	{
+		for (s32 interleave = 0; interleave < 2; interleave++)
+		{
+			bool cold = true;
+			for (s32 i = 0; i < files.length; i++)
+			{
+				if (!platform_evict_file_cache(((found_file*)files.data)[i].path)) cold = false;
+			}
+			
+			u64 stamp = platform_get_time(TIME_FULL, TIME_US);
+			file_reader *reader = file_reader_create(thread_count, 0);
+			file_schedule schedule = file_schedule_create(orders[o], interleave, FILE_SCHEDULE_BATCH_SIZE);
+			
+			benchmark_read_args *args = mem_alloc(sizeof(benchmark_read_args)*thread_count);
+			thread *consumers = mem_alloc(sizeof(thread)*thread_count);
+			for (s32 i = 0; i < thread_count; i++)
+			{
+				memset(&args[i], 0, sizeof(benchmark_read_args));
+				args[i].reader = reader;
+				consumers[i] = thread_start(benchmark_file_reads_consumer, &args[i]);
+			}
+			
+			for (s32 i = 0; i < files.length; i++)
+			{
+				file_schedule_add(&schedule, reader, ((found_file*)files.data)[i].path, 0);
+				if (file_schedule_is_full(&schedule)) file_schedule_flush(&schedule, reader);
+			}
+			file_schedule_flush(&schedule, reader);
+			file_reader_finish_submitting(reader);
+			
+			u64 bytes_read = 0;
+			u64 files_read = 0;
+			for (s32 i = 0; i < thread_count; i++)
+			{
+				thread_join(&consumers[i]);
+				bytes_read += args[i].bytes_read;
+				files_read += args[i].files_read;
+			}
+			f32 elapsed_ms = timer_elapsed_ms(stamp);
+			
+			printf("benchmark=file_schedule order=%s interleave=%d cold=%d threads=%d files=%llu bytes=%llu lookup_ms=%.2f elapsed_ms=%.2f files_per_s=%.0f mb_per_s=%.2f\n",
+				   file_schedule_order_name(orders[o]), interleave, cold, thread_count,
+				   (unsigned long long)files_read, (unsigned long long)bytes_read, schedule.lookup_us / 1000.0f,
+				   elapsed_ms, files_read / (elapsed_ms / 1000.0f),
+				   (bytes_read / (1024.0f*1024.0f)) / (elapsed_ms / 1000.0f));
+			
+			file_reader_destroy(reader);
+			file_schedule_destroy(&schedule);
+			mem_free(consumers);
+			mem_free(args);
+		}
+	}
+	
+	memory_bucket_destroy(&bucket);
+	array_destroy(&files);
+}
\ No newline at end of file
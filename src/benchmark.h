@@ -0,0 +1,69 @@
+/* 
+*  BSD 2-Clause “Simplified” License
+*  Copyright (c) 2019, Aldrik Ramaekers, aldrik.ramaekers@protonmail.com
+*  All rights reserved.
+*/
+
+#ifndef INCLUDE_BENCHMARK
+#define INCLUDE_BENCHMARK
+
+// Benchmarks print one line per measurement in key=value form so results
+// can be compared between runs. Page cache is not dropped, run
+// "echo 3 > /proc/sys/vm/drop_caches" between runs for cold cache numbers.
+
+// generates file_count files of file_size bytes in directory (once) and reads
+// them with every file_reader backend.
+#define benchmark_small_file_reads(directory) benchmark_file_reads(directory, 100000, 4096)
+void benchmark_file_reads(char *directory, s32 file_count, s32 file_size);
+
+// searches a generated plain text corpus of corpus_size bytes with every literal
+// search kernel and with the wildcard matcher, with and without ignoring case,
+// reports GB/s.
+void benchmark_literal_search(s64 corpus_size);
+
+// searches needles of 2 to 256 bytes in english text, random bytes, a 4 letter
+// alphabet and a repetitive worst case with every literal search algorithm.
+void benchmark_pattern_matrix(s64 corpus_size);
+
+// generates file_count text files of file_size bytes in directory (once), which has
+// to end with a path separator, indexes them and compares searching every file
+// with searching the candidates of the trigram index.
+void benchmark_trigram_index(char *directory, s32 file_count, s32 file_size);
+
+// searches a generated plain text corpus with regular expressions with and without
+// a literal prefilter, next to the wildcard matcher for comparable queries, and
+// a pattern that takes exponential time in backtracking engines.
+void benchmark_regex_search(s64 corpus_size);
+
+// shape of a generated directory tree, the same values always give the same tree
+typedef struct t_benchmark_corpus
+{
+	s32 depth; // directory levels below the root
+	s32 fan_out; // subdirectories of every directory above the deepest level
+	s32 files_per_directory;
+	s32 min_file_size;
+	s32 max_file_size; // every doubling of the size has the same number of files
+	f32 matches_per_mb; // occurrences of BENCHMARK_CORPUS_QUERY
+	u32 seed;
+} benchmark_corpus;
+
+#define BENCHMARK_CORPUS_QUERY "zanzibar"
+#define BENCHMARK_CORPUS_FILTER "*.c,*.h"
+
+benchmark_corpus benchmark_corpus_create(s32 depth, s32 fan_out, s32 files_per_directory, s32 min_file_size, s32 max_file_size, f32 matches_per_mb);
+// 85 directories with 25 files of 512 bytes to 256kb each, about 90mb
+#define benchmark_corpus_default() benchmark_corpus_create(3, 4, 25, 512, kilobytes(256), 2.0f)
+
+// generates corpus in directory (once), which has to end with a path separator,
+// and measures the phases of a search separately: walking the tree, matching the
+// file names against BENCHMARK_CORPUS_FILTER and searching the content of every
+// file with thread_count threads (0 = number of cpus). reports files/s, mb/s,
+// p50/p99 search time per file and the peak resident set size after each phase.
+void benchmark_search_throughput(char *directory, benchmark_corpus corpus, s32 thread_count);
+
+// generates corpus in directory (once) and reads every file in each
+// file_schedule_order, with and without interleaving sizes. the cached content of
+// every file is dropped before each run, cold=0 is reported when that failed.
+void benchmark_file_schedule(char *directory, benchmark_corpus corpus, s32 thread_count);
+
+#endif
\ No newline at end of file
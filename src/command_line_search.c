@@ -0,0 +1,769 @@
+/* 
+*  BSD 2-Clause “Simplified” License
+*  Copyright (c) 2019, Aldrik Ramaekers, aldrik.ramaekers@protonmail.com
+*  All rights reserved.
+*/
+
+static void command_line_search_set_defaults(command_line_search_options *options)
+{
+	options->text_to_find = 0;
+	options->directory = 0;
+	options->file_filter = "*";
+	options->thread_count = platform_get_cpu_count();
+	if (options->thread_count < 1) options->thread_count = 1;
+	options->min_thread_count = 0;
+	options->max_file_size = 0;
+	options->memory_budget = 0;
+	options->recursive = true;
+	options->ignore_case = false;
+	options->is_regex = false;
+	options->respect_ignore_files = false;
+	options->deduplicate_files = false;
+	options->follow_symlinks = false;
+	options->one_file_system = false;
+	options->read_order = FILE_SCHEDULE_LISTED;
+	options->interleave_sizes = false;
+	options->binary_mode = BINARY_FILES_SKIP;
+	options->mode = SEARCH_MODE_MATCHES;
+	options->output_format = SEARCH_EXPORT_TEXT;
+	options->export_path = 0;
+	options->index_path = 0;
+	options->print_timings = false;
+	options->has_config = false;
+	options->directory_buffer[0] = 0;
+}
+
+static bool command_line_search_is_true(char *value)
+{
+	return strcmp(value, "1") == 0 || strcmp(value, "true") == 0 || strcmp(value, "yes") == 0;
+}
+
+static bool command_line_search_parse_binary_mode(char *value, binary_file_mode *mode)
+{
+	if (strcmp(value, "skip") == 0) *mode = BINARY_FILES_SKIP;
+	else if (strcmp(value, "raw") == 0) *mode = BINARY_FILES_RAW;
+	else if (strcmp(value, "text") == 0) *mode = BINARY_FILES_TEXT;
+	else
+	{
+		fprintf(stderr, "unknown binary file mode %s, use skip, raw or text\n", value);
+		return false;
+	}
+	return true;
+}
+
+static bool command_line_search_parse_mode(char *value, search_mode *mode)
+{
+	if (strcmp(value, "matches") == 0) *mode = SEARCH_MODE_MATCHES;
+	else if (strcmp(value, "files") == 0) *mode = SEARCH_MODE_FILES_WITH_MATCHES;
+	else if (strcmp(value, "count") == 0) *mode = SEARCH_MODE_COUNT;
+	else
+	{
+		fprintf(stderr, "unknown search mode %s, use matches, files or count\n", value);
+		return false;
+	}
+	return true;
+}
+
+static bool command_line_search_parse_order(char *value, file_schedule_order *order)
+{
+	if (!file_schedule_order_from_name(value, order))
+	{
+		fprintf(stderr, "unknown read order %s, use listed, inode or extent\n", value);
+		return false;
+	}
+	return true;
+}
+
+static bool command_line_search_load_config(command_line_search_options *options, char *path)
+{
+	// loading the config changes the working directory
+	char *full_path = platform_get_full_path(path);
+	if (!full_path[0] || !platform_file_exists(full_path))
+	{
+		fprintf(stderr, "config file %s does not exist\n", path);
+		mem_free(full_path);
+		return false;
+	}
+	options->config = settings_config_load_from_file(full_path);
+	options->has_config = true;
+	mem_free(full_path);
+	
+	settings_config *config = &options->config;
+	char *value;
+	if ((value = settings_config_get_string(config, "TEXT"))) options->text_to_find = value;
+	if ((value = settings_config_get_string(config, "DIRECTORY"))) options->directory = value;
+	if ((value = settings_config_get_string(config, "FILTER"))) options->file_filter = value;
+	if ((value = settings_config_get_string(config, "EXPORT"))) options->export_path = value;
+	if ((value = settings_config_get_string(config, "INDEX"))) options->index_path = value;
+	if ((value = settings_config_get_string(config, "RECURSIVE"))) options->recursive = command_line_search_is_true(value);
+	if ((value = settings_config_get_string(config, "IGNORE_CASE"))) options->ignore_case = command_line_search_is_true(value);
+	if ((value = settings_config_get_string(config, "REGEX"))) options->is_regex = command_line_search_is_true(value);
+	if ((value = settings_config_get_string(config, "IGNORE_FILES"))) options->respect_ignore_files = command_line_search_is_true(value);
+	if ((value = settings_config_get_string(config, "DEDUP"))) options->deduplicate_files = command_line_search_is_true(value);
+	if ((value = settings_config_get_string(config, "FOLLOW_SYMLINKS"))) options->follow_symlinks = command_line_search_is_true(value);
+	if ((value = settings_config_get_string(config, "ONE_FILE_SYSTEM"))) options->one_file_system = command_line_search_is_true(value);
+	if ((value = settings_config_get_string(config, "INTERLEAVE"))) options->interleave_sizes = command_line_search_is_true(value);
+	if ((value = settings_config_get_string(config, "ORDER")) && !command_line_search_parse_order(value, &options->read_order)) return false;
+	if ((value = settings_config_get_string(config, "TIMINGS"))) options->print_timings = command_line_search_is_true(value);
+	if ((value = settings_config_get_string(config, "FORMAT"))) options->output_format = strcmp(value, "json") == 0 ? SEARCH_EXPORT_JSON_LINES : SEARCH_EXPORT_TEXT;
+	if ((value = settings_config_get_string(config, "BINARY")) && !command_line_search_parse_binary_mode(value, &options->binary_mode)) return false;
+	if ((value = settings_config_get_string(config, "MODE")) && !command_line_search_parse_mode(value, &options->mode)) return false;
+	options->thread_count = settings_config_get_number_or_default(config, "THREADS", options->thread_count);
+	options->min_thread_count = settings_config_get_number_or_default(config, "MIN_THREADS", options->min_thread_count);
+	options->max_file_size = settings_config_get_number_or_default(config, "MAX_FILE_SIZE", options->max_file_size);
+	options->memory_budget = settings_config_get_number_or_default(config, "MEMORY_BUDGET", options->memory_budget);
+	
+	return true;
+}
+
+static bool command_line_search_takes_value(char *arg)
+{
+	char *options[] = { "--config", "--threads", "--filter", "--binary", "--max-filesize", "--export", "--index", "--order", "--min-threads", "--memory-budget" };
+	for (s32 i = 0; i < sizeof(options)/sizeof(char*); i++)
+	{
+		if (strcmp(arg, options[i]) == 0) return true;
+	}
+	return false;
+}
+
+// the walker changes the working directory, so every path is made absolute
+static bool command_line_search_resolve_directory(command_line_search_options *options)
+{
+	if (options->directory)
+	{
+		char *full_path = platform_get_full_path(options->directory);
+		string_copyn(options->directory_buffer, full_path, MAX_INPUT_LENGTH);
+		mem_free(full_path);
+	}
+	else if (!get_active_directory(options->directory_buffer))
+	{
+		options->directory_buffer[0] = 0;
+	}
+	
+	if (!options->directory_buffer[0] || !platform_directory_exists(options->directory_buffer))
+	{
+		fprintf(stderr, "directory %s does not exist\n", options->directory ? options->directory : ".");
+		return false;
+	}
+	
+	s32 length = strlen(options->directory_buffer);
+	char last = options->directory_buffer[length-1];
+	if (last != '/' && last != '\\')
+	{
+#ifdef OS_LINUX
+		string_appendn(options->directory_buffer, "/", MAX_INPUT_LENGTH);
+#endif
+#ifdef OS_WIN
+		string_appendn(options->directory_buffer, "\\", MAX_INPUT_LENGTH);
+#endif
+	}
+	options->directory = options->directory_buffer;
+	return true;
+}
+
+bool command_line_search_parse(command_line_search_options *options, s32 argc, char **argv)
+{
+	command_line_search_set_defaults(options);
+	
+	// the config is loaded first so arguments override it
+	for (s32 i = 1; i < argc-1; i++)
+	{
+		if (strcmp(argv[i], "--") == 0) break;
+		if (strcmp(argv[i], "--config") == 0 && !command_line_search_load_config(options, argv[i+1])) return false;
+	}
+	
+	s32 positional_count = 0;
+	bool options_ended = false;
+	for (s32 i = 1; i < argc; i++)
+	{
+		char *arg = argv[i];
+		
+		if (options_ended || arg[0] != '-' || !arg[1])
+		{
+			if (positional_count == 0) options->text_to_find = arg;
+			else if (positional_count == 1) options->directory = arg;
+			else
+			{
+				fprintf(stderr, "unexpected argument %s\n", arg);
+				return false;
+			}
+			positional_count++;
+		}
+		else if (strcmp(arg, "--") == 0) options_ended = true;
+		else if (command_line_search_takes_value(arg))
+		{
+			if (i+1 == argc)
+			{
+				fprintf(stderr, "%s needs a value\n", arg);
+				return false;
+			}
+			char *value = argv[++i];
+			
+			if (strcmp(arg, "--threads") == 0) options->thread_count = string_to_s32(value);
+			else if (strcmp(arg, "--min-threads") == 0) options->min_thread_count = string_to_s32(value);
+			else if (strcmp(arg, "--filter") == 0) options->file_filter = value;
+			else if (strcmp(arg, "--max-filesize") == 0) options->max_file_size = string_to_s32(value);
+			else if (strcmp(arg, "--memory-budget") == 0) options->memory_budget = string_to_s64(value);
+			else if (strcmp(arg, "--export") == 0) options->export_path = value;
+			else if (strcmp(arg, "--index") == 0) options->index_path = value;
+			else if (strcmp(arg, "--binary") == 0 && !command_line_search_parse_binary_mode(value, &options->binary_mode)) return false;
+			else if (strcmp(arg, "--order") == 0 && !command_line_search_parse_order(value, &options->read_order)) return false;
+		}
+		else if (strcmp(arg, "-i") == 0 || strcmp(arg, "--ignore-case") == 0) options->ignore_case = true;
+		else if (strcmp(arg, "-e") == 0 || strcmp(arg, "--regex") == 0) options->is_regex = true;
+		else if (strcmp(arg, "-l") == 0 || strcmp(arg, "--files-with-matches") == 0) options->mode = SEARCH_MODE_FILES_WITH_MATCHES;
+		else if (strcmp(arg, "-c") == 0 || strcmp(arg, "--count") == 0) options->mode = SEARCH_MODE_COUNT;
+		else if (strcmp(arg, "--no-recursive") == 0) options->recursive = false;
+		else if (strcmp(arg, "--ignore-files") == 0) options->respect_ignore_files = true;
+		else if (strcmp(arg, "--no-ignore") == 0) options->respect_ignore_files = false;
+		else if (strcmp(arg, "--dedup") == 0) options->deduplicate_files = true;
+		else if (strcmp(arg, "-L") == 0 || strcmp(arg, "--follow") == 0) options->follow_symlinks = true;
+		else if (strcmp(arg, "--one-file-system") == 0) options->one_file_system = true;
+		else if (strcmp(arg, "--interleave") == 0) options->interleave_sizes = true;
+		else if (strcmp(arg, "--json") == 0) options->output_format = SEARCH_EXPORT_JSON_LINES;
+		else if (strcmp(arg, "--timings") == 0) options->print_timings = true;
+		else
+		{
+			fprintf(stderr, "unknown option %s\n", arg);
+			return false;
+		}
+	}
+	
+	if (!options->text_to_find || !options->text_to_find[0])
+	{
+		fprintf(stderr, "usage: %s [options] text_to_find [directory]\n", argc ? argv[0] : "search");
+		return false;
+	}
+	if (options->thread_count < 1)
+	{
+		fprintf(stderr, "--threads has to be at least 1\n");
+		return false;
+	}
+	if (options->memory_budget < 0)
+	{
+		fprintf(stderr, "--memory-budget can't be negative\n");
+		return false;
+	}
+	if (!options->min_thread_count) options->min_thread_count = options->thread_count;
+	if (options->min_thread_count < 1 || options->min_thread_count > options->thread_count)
+	{
+		fprintf(stderr, "--min-threads has to be between 1 and --threads\n");
+		return false;
+	}
+	
+	return command_line_search_resolve_directory(options);
+}
+
+void command_line_search_options_destroy(command_line_search_options *options)
+{
+	if (options->has_config) settings_config_destroy(&options->config);
+	options->has_config = false;
+}
+
+static char *command_line_search_error_text(s16 file_error)
+{
+	switch (file_error)
+	{
+		case FILE_ERROR_TOO_MANY_OPEN_FILES_PROCESS:
+		case FILE_ERROR_TOO_MANY_OPEN_FILES_SYSTEM: return "Too many open files";
+		case FILE_ERROR_NO_ACCESS: return "Permission denied";
+		case FILE_ERROR_NOT_FOUND: return "No such file or directory";
+		case FILE_ERROR_CONNECTION_ABORTED: return "Connection aborted";
+		case FILE_ERROR_CONNECTION_REFUSED: return "Connection refused";
+		case FILE_ERROR_NETWORK_DOWN: return "Network is down";
+		case FILE_ERROR_REMOTE_IO_ERROR: return "Remote I/O error";
+		case FILE_ERROR_STALE: return "Stale file handle";
+		case FILE_ERROR_TOO_BIG: return "File too large";
+		default: return "Input/output error";
+	}
+}
+
+// length of the part of the line that is written to the output
+static s32 command_line_search_line_length(char *line, char *text_end)
+{
+	s64 length = text_end - line;
+	char *newline = memchr(line, '\n', length);
+	if (newline) length = newline - line;
+	if (length && line[length-1] == '\r') length--;
+	
+	// cut at the start of a codepoint
+	if (length > COMMAND_LINE_SEARCH_MAX_LINE_LENGTH)
+	{
+		length = COMMAND_LINE_SEARCH_MAX_LINE_LENGTH;
+		while (length && (line[length] & 0xC0) == 0x80) length--;
+	}
+	
+	return length;
+}
+
+static void command_line_search_help_split(command_line_search *search)
+{
+	mutex_lock(&search->split_mutex);
+	text_search_split *split = search->split;
+	if (split) __atomic_fetch_add(&search->split_helpers, 1, __ATOMIC_RELAXED);
+	mutex_unlock(&search->split_mutex);
+	
+	if (!split) return;
+	
+	s32 range;
+	while ((range = text_search_split_claim(split)) != -1)
+		text_search_split_search(split, range);
+	
+	__atomic_fetch_sub(&search->split_helpers, 1, __ATOMIC_RELEASE);
+}
+
+// one split is shared at a time, other large files are searched by their own thread
+static bool command_line_search_split(command_line_search *search, text_search_split *split, array *text_matches, s64 *match_count)
+{
+	mutex_lock(&search->split_mutex);
+	bool shared = !search->split;
+	if (shared) search->split = split;
+	mutex_unlock(&search->split_mutex);
+	
+	s32 range;
+	while ((range = text_search_split_claim(split)) != -1)
+		text_search_split_search(split, range);
+	
+	// helpers claim once more after the last range, the split has to stay alive
+	if (shared)
+	{
+		mutex_lock(&search->split_mutex);
+		search->split = 0;
+		mutex_unlock(&search->split_mutex);
+		
+		while (__atomic_load_n(&search->split_helpers, __ATOMIC_ACQUIRE))
+			thread_sleep(TEXT_SEARCH_SPLIT_WAIT_US);
+	}
+	
+	return text_search_split_finish(split, text_matches, match_count);
+}
+
+static void command_line_search_file(command_line_search *search, found_file *file, file_content *content, array *text_matches, array *file_matches)
+{
+	search_result *result = &search->result;
+	command_line_search_options *options = search->options;
+	
+	file_match match;
+	match.file = *file;
+	match.file_error = content->file_error;
+	match.file_size = content->content_length;
+	match.line_nr = 0;
+	match.line_length = 0;
+	match.line_offset = -1;
+	match.match_count = 0;
+	match.word_match_offset = 0;
+	match.word_match_length = 0;
+	match.word_match_offset_x = 0;
+	match.word_match_width = 0;
+	match.line_copy = 0;
+	
+	if (match.file_error || !content->content)
+	{
+		if (!match.file_error) match.file_error = FILE_ERROR_GENERIC;
+		match_channel_send(&result->pending_matches, &match, 1, &result->cancel_search);
+		return;
+	}
+	
+	__atomic_fetch_add(&search->bytes_searched, content->content_length, __ATOMIC_RELAXED);
+	__atomic_fetch_add(&result->files_searched, 1, __ATOMIC_RELAXED);
+	
+	text_matches->length = 0;
+	file_matches->length = 0;
+	
+	// only SEARCH_MODE_MATCHES keeps the matches, the other modes send one record per file
+	s64 match_count = 0;
+	s64 *count = options->mode == SEARCH_MODE_COUNT ? &match_count : 0;
+	if (options->mode != SEARCH_MODE_MATCHES) text_matches = 0;
+	
+	bool found;
+	text_search_split *split;
+	if (text_gzip_is_gzip(content))
+		found = text_gzip_search(content, options->text_to_find, result->regex, text_matches, count, &result->cancel_search, options->ignore_case, options->binary_mode, &result->search_info, &result->mem_bucket);
+	else if ((split = text_search_split_create(content, options->text_to_find, result->regex, &result->cancel_search, options->ignore_case, options->binary_mode, options->mode)))
+		found = command_line_search_split(search, split, text_matches, count);
+	else if (count)
+	{
+		match_count = text_search_count_content(content, options->text_to_find, result->regex, &result->cancel_search, options->ignore_case, options->binary_mode, &result->search_info);
+		found = match_count > 0;
+	}
+	else
+		found = text_search_content(content, options->text_to_find, result->regex, text_matches, &result->cancel_search, options->ignore_case, options->binary_mode, &result->search_info);
+	
+	if (!found) return;
+	__atomic_fetch_add(&result->files_matched, 1, __ATOMIC_RELAXED);
+	
+	if (!text_matches)
+	{
+		match.match_count = match_count;
+		match_channel_send(&result->pending_matches, &match, 1, &result->cancel_search);
+		return;
+	}
+	
+	// only the position of the line is kept, the output reads it back from the file.
+	// matches on the same line share the length
+	char *text_start = content->content;
+	char *text_end = text_start + content->content_length;
+	char *last_line = 0;
+	s32 last_length = 0;
+	for (s32 i = 0; i < text_matches->length; i++)
+	{
+		text_match *text = array_at(text_matches, i);
+		match.line_nr = text->line_nr;
+		match.word_match_offset = text->word_offset;
+		match.word_match_length = text->word_match_len;
+		
+		if (text->line_start != last_line)
+		{
+			last_line = text->line_start;
+			if (text->line_info) last_length = strlen(text->line_info);
+			else if (text->line_nr) last_length = command_line_search_line_length(text->line_start, text_end);
+			else last_length = 0;
+		}
+		
+		// gzip matches come with a copy, raw binary matches have no line
+		match.line_copy = text->line_info;
+		match.line_offset = text->line_info || !text->line_nr ? -1 : text->line_start - text_start;
+		match.line_length = last_length;
+		
+		array_push(file_matches, &match);
+	}
+	
+	match_channel_send(&result->pending_matches, file_matches->data, file_matches->length, &result->cancel_search);
+}
+
+static void *command_line_search_thread(void *arg)
+{
+	command_line_search_worker *worker = arg;
+	command_line_search *search = worker->search;
+	
+	array text_matches = array_create(sizeof(text_match));
+	text_matches.reserve_jump = 1024;
+	array file_matches = array_create(sizeof(file_match));
+	file_matches.reserve_jump = 1024;
+	
+	file_read read;
+	while (!__atomic_load_n(&search->reader_done, __ATOMIC_ACQUIRE))
+	{
+		if (!worker_control_is_active(&search->workers, worker->index))
+		{
+			thread_sleep(WORKER_CONTROL_PARK_US);
+			continue;
+		}
+		
+		u64 stamp = platform_get_time(TIME_FULL, TIME_US);
+		if (!file_reader_next(search->reader, &read))
+		{
+			__atomic_store_n(&search->reader_done, true, __ATOMIC_RELEASE);
+			break;
+		}
+		u64 read_stamp = platform_get_time(TIME_FULL, TIME_US);
+		worker_control_add_blocked(&search->workers, worker->index, read_stamp - stamp);
+		
+		found_file file;
+		file.path = read.path;
+		file.matched_filter = read.data;
+		command_line_search_file(search, &file, &read.content, &text_matches, &file_matches);
+		worker_control_add_busy(&search->workers, worker->index, platform_get_time(TIME_FULL, TIME_US) - read_stamp, read.content.content_length);
+		file_reader_release(search->reader, &read);
+	}
+	__atomic_fetch_sub(&search->searching_count, 1, __ATOMIC_RELEASE);
+	
+	// the last large file is searched by every thread that has nothing left to do
+	while (__atomic_load_n(&search->searching_count, __ATOMIC_ACQUIRE))
+	{
+		command_line_search_help_split(search);
+		thread_sleep(TEXT_SEARCH_SPLIT_WAIT_US);
+	}
+	
+	array_destroy(&file_matches);
+	array_destroy(&text_matches);
+	return 0;
+}
+
+static bool command_line_search_is_json_path(char *path)
+{
+	s32 length = strlen(path);
+	return length >= 5 && strcmp(path + length - 5, ".json") == 0;
+}
+
+s32 command_line_search_run(command_line_search_options *options)
+{
+	u64 start_time = platform_get_time(TIME_FULL, TIME_US);
+	
+	command_line_search *search = mem_alloc(sizeof(command_line_search));
+	memset(search, 0, sizeof(command_line_search));
+	search->options = options;
+	search->split_mutex = mutex_create();
+	search->searching_count = options->thread_count;
+	
+	search_result *result = &search->result;
+	result->is_command_line_search = true;
+	result->start_time = start_time;
+	result->files = array_create(sizeof(found_file));
+	result->files.reserve_jump = 1024;
+	result->matches = match_list_create();
+	result->pending_matches = match_channel_create(MATCH_CHANNEL_CAPACITY);
+	result->mem_bucket = memory_bucket_init(megabytes(1));
+	result->directory_to_search = options->directory;
+	result->file_filter = options->file_filter;
+	result->text_to_find = options->text_to_find;
+	result->export_path = options->export_path;
+	result->max_thread_count = options->thread_count;
+	result->min_thread_count = options->min_thread_count;
+	result->active_thread_count = options->thread_count;
+	result->max_file_size = options->max_file_size;
+	result->memory_budget = options->memory_budget;
+	result->is_recursive = options->recursive;
+	result->binary_mode = options->binary_mode;
+	result->mode = options->mode;
+	result->is_regex = options->is_regex;
+	result->respect_ignore_files = options->respect_ignore_files;
+	result->follow_symlinks = options->follow_symlinks;
+	result->one_file_system = options->one_file_system;
+	result->deduplicate_files = options->deduplicate_files || options->follow_symlinks || options->one_file_system;
+	
+	s32 exit_code = 1;
+	search_export *output = 0;
+	search_export *exporter = 0;
+	thread *threads = 0;
+	command_line_search_worker *workers = 0;
+	
+	if (options->is_regex)
+	{
+		result->regex = text_regex_create(options->text_to_find, options->ignore_case);
+		if (result->regex->error)
+		{
+			fprintf(stderr, "invalid regular expression: %s\n", result->regex->error);
+			exit_code = 2;
+			goto done;
+		}
+	}
+	
+	// the index only knows literal parts of wildcard queries
+	if (options->index_path)
+	{
+		char *full_path = platform_get_full_path(options->index_path);
+		search->index = trigram_index_open(full_path);
+		mem_free(full_path);
+		
+		if (!search->index.is_open)
+			fprintf(stderr, "index %s could not be opened, every file is searched\n", options->index_path);
+		else if (!options->is_regex)
+			search->index_query = trigram_index_query_create(&search->index, options->text_to_find, options->ignore_case);
+	}
+	bool use_index = search->index.is_open && !options->is_regex;
+	
+	if (options->export_path)
+	{
+		char *full_path = platform_get_full_path(options->export_path);
+		exporter = search_export_start(full_path[0] ? full_path : options->export_path, command_line_search_is_json_path(options->export_path) ? SEARCH_EXPORT_JSON_LINES : SEARCH_EXPORT_BINARY, options->mode, &result->matches);
+		mem_free(full_path);
+		
+		if (search_export_is_done(exporter))
+		{
+			fprintf(stderr, "%s could not be created\n", options->export_path);
+			exit_code = 2;
+			goto done;
+		}
+	}
+	output = search_export_start_stream(stdout, options->output_format, options->mode, &result->matches);
+	
+	if (options->respect_ignore_files) result->search_info.ignore = file_ignore_create(options->directory);
+	if (result->deduplicate_files) result->search_info.dedup = file_dedup_create(result->follow_symlinks, result->one_file_system);
+	
+	search->reader = file_reader_create(options->thread_count, options->max_file_size);
+	file_reader_set_memory_budget(search->reader, options->memory_budget);
+	search->workers = worker_control_create(options->min_thread_count, options->thread_count);
+	search->schedule = file_schedule_create(options->read_order, options->interleave_sizes, FILE_SCHEDULE_BATCH_SIZE);
+	threads = mem_alloc(sizeof(thread)*options->thread_count);
+	workers = mem_alloc(sizeof(command_line_search_worker)*options->thread_count);
+	for (s32 i = 0; i < options->thread_count; i++)
+	{
+		workers[i].search = search;
+		workers[i].index = i;
+		threads[i] = thread_start(command_line_search_thread, &workers[i]);
+	}
+	
+	platform_list_files(&result->files, options->directory, options->file_filter, options->recursive, &result->mem_bucket, &result->cancel_search, &result->done_finding_files, &result->search_info);
+	
+	u64 walk_us = 0;
+	u32 submitted = 0;
+	u32 reported = 0;
+	bool submitting = true;
+	for (;;)
+	{
+		bool idle = true;
+		
+		// the walker sets done_finding_files while holding the mutex of the list
+		if (submitting)
+		{
+			mutex_lock(&result->files.mutex);
+			bool walk_done = result->done_finding_files;
+			for (; submitted < result->files.length && !file_schedule_is_full(&search->schedule); submitted++)
+			{
+				found_file *file = array_at(&result->files, submitted);
+				idle = false;
+				
+				if (use_index && !trigram_index_may_match(&search->index, &search->index_query, file->path))
+				{
+					search->index_skip_count++;
+					continue;
+				}
+				file_schedule_add(&search->schedule, search->reader, file->path, file->matched_filter);
+			}
+			walk_done = walk_done && submitted == result->files.length;
+			mutex_unlock(&result->files.mutex);
+			
+			// a partial batch is better than threads waiting for files
+			if (walk_done || file_schedule_is_full(&search->schedule) || !file_reader_pending_count(search->reader))
+				file_schedule_flush(&search->schedule, search->reader);
+			
+			if (walk_done)
+			{
+				file_reader_finish_submitting(search->reader);
+				submitting = false;
+				walk_us = platform_get_time(TIME_FULL, TIME_US) - start_time;
+			}
+		}
+		
+		if (match_channel_drain(&result->pending_matches, &result->matches, MATCH_CHANNEL_FRAME_LIMIT))
+			idle = false;
+		
+		// the json output has the errors in it, text output is meant to look like grep
+		u32 length = match_list_length(&result->matches);
+		for (; reported < length; reported++)
+		{
+			file_match *match = match_list_at(&result->matches, reported);
+			if (!match->file_error)
+			{
+				result->match_count += options->mode == SEARCH_MODE_COUNT ? match->match_count : 1;
+				continue;
+			}
+			
+			// files over the size limit are skipped on purpose
+			if (match->file_error != FILE_ERROR_TOO_BIG) search->error_count++;
+			if (options->output_format == SEARCH_EXPORT_TEXT)
+				fprintf(stderr, "%s: %s\n", match->file.path, command_line_search_error_text(match->file_error));
+		}
+		
+		// nothing more can be kept, the search stops with the matches it has
+		if (match_list_is_full(&result->matches))
+		{
+			fprintf(stderr, "out of space for matches, the search stopped after %u results\n", length);
+			search->error_count++;
+			result->cancel_search = true;
+			__atomic_store_n(&search->reader_done, true, __ATOMIC_RELEASE);
+			if (submitting) file_reader_finish_submitting(search->reader);
+			
+			// the walker writes into result->files until it sees the cancel
+			for (bool walk_done = false; !walk_done;)
+			{
+				mutex_lock(&result->files.mutex);
+				walk_done = result->done_finding_files;
+				mutex_unlock(&result->files.mutex);
+				if (!walk_done) thread_sleep(COMMAND_LINE_SEARCH_POLL_US);
+			}
+			break;
+		}
+		
+		// matches are sent before a thread stops searching
+		if (!submitting && !__atomic_load_n(&search->searching_count, __ATOMIC_ACQUIRE) && !match_channel_pending(&result->pending_matches))
+			break;
+		
+		worker_control_update(&search->workers);
+		result->active_thread_count = search->workers.active_count;
+		
+		if (idle) thread_sleep(COMMAND_LINE_SEARCH_POLL_US);
+	}
+	u64 search_us = platform_get_time(TIME_FULL, TIME_US) - start_time;
+	
+	for (s32 i = 0; i < options->thread_count; i++)
+	{
+		thread_join(&threads[i]);
+	}
+	result->done_finding_matches = true;
+	result->found_file_matches = result->files_matched > 0;
+	result->match_found = result->match_count > 0;
+	
+	search_export_finish(output);
+	if (!search_export_destroy(output)) search->error_count++;
+	output = 0;
+	if (exporter)
+	{
+		search_export_finish(exporter);
+		if (!search_export_destroy(exporter))
+		{
+			fprintf(stderr, "%s could not be written\n", options->export_path);
+			search->error_count++;
+		}
+		exporter = 0;
+	}
+	u64 total_us = platform_get_time(TIME_FULL, TIME_US) - start_time;
+	
+	if (options->print_timings)
+	{
+		search_info *info = &result->search_info;
+		file_dedup *dedup = info->dedup;
+		fprintf(stderr, "search=command_line threads=%d files=%llu dirs=%llu candidates=%u index_skipped=%d searched=%d matched=%d matches=%lld errors=%d bytes=%llu binary_skipped=%llu ignored_dirs=%llu ignored_files=%llu duplicate_dirs=%llu duplicate_files=%llu other_file_system_dirs=%llu order=%s lookup_ms=%.2f min_threads=%d active_threads_lowest=%d active_threads_highest=%d active_threads_average=%.2f active_thread_changes=%d memory_budget=%lld peak_buffer_bytes=%lld budget_waits=%u walk_ms=%.2f search_ms=%.2f output_ms=%.2f total_ms=%.2f\n",
+				options->thread_count, (unsigned long long)info->file_count, (unsigned long long)info->dir_count,
+				result->files.length, search->index_skip_count, result->files_searched, result->files_matched,
+				(long long)result->match_count, search->error_count, (unsigned long long)search->bytes_searched,
+				(unsigned long long)info->binary_skip_count, (unsigned long long)info->ignored_dir_count,
+				(unsigned long long)info->ignored_file_count, (unsigned long long)(dedup ? dedup->duplicate_dir_count : 0),
+				(unsigned long long)(dedup ? dedup->duplicate_file_count : 0),
+				(unsigned long long)(dedup ? dedup->other_file_system_count : 0),
+				file_schedule_order_name(options->read_order), search->schedule.lookup_us / 1000.0f,
+				options->min_thread_count, search->workers.lowest_count, search->workers.highest_count,
+				worker_control_average_count(&search->workers), search->workers.change_count,
+				(long long)options->memory_budget, (long long)search->reader->peak_memory_used,
+				search->reader->budget_wait_count, walk_us / 1000.0f, search_us / 1000.0f,
+				(total_us - search_us) / 1000.0f, total_us / 1000.0f);
+	}
+	
+	if (search->error_count) exit_code = 2;
+	else if (result->match_count) exit_code = 0;
+	
+	done:
+	if (output)
+	{
+		search_export_cancel(output);
+		search_export_destroy(output);
+	}
+	if (exporter)
+	{
+		search_export_cancel(exporter);
+		search_export_destroy(exporter);
+	}
+	if (threads) mem_free(threads);
+	if (workers) mem_free(workers);
+	if (search->reader)
+	{
+		file_reader_destroy(search->reader);
+		file_schedule_destroy(&search->schedule);
+		worker_control_destroy(&search->workers);
+	}
+	if (search->index_query.candidates) trigram_index_query_destroy(&search->index_query);
+	if (search->index.is_open) trigram_index_close(&search->index);
+	if (result->search_info.ignore) file_ignore_destroy(result->search_info.ignore);
+	if (result->search_info.dedup) file_dedup_destroy(result->search_info.dedup);
+	if (result->regex) text_regex_destroy(result->regex);
+	match_channel_destroy(&result->pending_matches);
+	match_list_destroy(&result->matches);
+	memory_bucket_destroy(&result->mem_bucket);
+	array_destroy(&result->files);
+	mutex_destroy(&search->split_mutex);
+	mem_free(search);
+	
+	return exit_code;
+}
+
+s32 command_line_search_main(s32 argc, char **argv)
+{
+	command_line_search_options options;
+	s32 exit_code = 2;
+	if (command_line_search_parse(&options, argc, argv))
+		exit_code = command_line_search_run(&options);
+	
+	command_line_search_options_destroy(&options);
+	return exit_code;
+}
\ No newline at end of file
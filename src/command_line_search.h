@@ -0,0 +1,126 @@
+/* 
+*  BSD 2-Clause “Simplified” License
+*  Copyright (c) 2019, Aldrik Ramaekers, aldrik.ramaekers@protonmail.com
+*  All rights reserved.
+*/
+
+#ifndef INCLUDE_COMMAND_LINE_SEARCH
+#define INCLUDE_COMMAND_LINE_SEARCH
+
+// the main thread waits this long when no files were found and no matches arrived
+#define COMMAND_LINE_SEARCH_POLL_US 1000
+// only the start of longer lines is written to the output
+#define COMMAND_LINE_SEARCH_MAX_LINE_LENGTH (kilobytes(64))
+
+// Headless search, no window or display connection is needed and platform_init
+// does not have to be called. The directory is walked on one thread while
+// thread_count threads search the files the file_reader has read, matches go
+// through the match channel into the match list and are written to stdout by a
+// search_export thread as they are found.
+typedef struct t_command_line_search_options
+{
+	char *text_to_find;
+	char *directory; // ends with a path separator
+	char *file_filter;
+	s32 thread_count;
+	s32 min_thread_count; // below thread_count the active threads are adapted at runtime
+	s32 max_file_size; // bytes, 0 = no limit
+	s64 memory_budget; // bytes of file content in memory at once, 0 = no limit
+	bool recursive;
+	bool ignore_case;
+	bool is_regex;
+	bool respect_ignore_files;
+	bool deduplicate_files; // hard links and bind mounts are searched once
+	bool follow_symlinks; // implies deduplicate_files so links can't make the walk loop
+	bool one_file_system; // implies deduplicate_files
+	file_schedule_order read_order;
+	bool interleave_sizes;
+	binary_file_mode binary_mode;
+	search_mode mode;
+	search_export_format output_format; // SEARCH_EXPORT_TEXT or SEARCH_EXPORT_JSON_LINES
+	char *export_path; // also exported to this file, json lines when it ends with .json
+	char *index_path; // trigram index of the directory, 0 when not used
+	bool print_timings; // counters and per phase timings are written to stderr
+	
+	settings_config config; // option strings can point into it
+	bool has_config;
+	char directory_buffer[MAX_INPUT_LENGTH];
+} command_line_search_options;
+
+typedef struct t_command_line_search
+{
+	command_line_search_options *options;
+	search_result result;
+	file_reader *reader;
+	file_schedule schedule; // between the walker and the reader
+	trigram_index index;
+	trigram_index_query index_query;
+	
+	// a large file that is split into ranges, threads without work help searching it
+	mutex split_mutex;
+	text_search_split *split;
+	s32 split_helpers;
+	
+	s32 searching_count; // search threads that still get files from the reader
+	worker_control workers; // which search threads take files
+	bool reader_done; // set when the reader handed out every file, parked threads stop
+	u64 bytes_searched;
+	s32 error_count;
+	s32 index_skip_count; // files the trigram index ruled out
+} command_line_search;
+
+typedef struct t_command_line_search_worker
+{
+	command_line_search *search;
+	s32 index;
+} command_line_search_worker;
+
+// usage: [options] text_to_find [directory]
+//   --config <path>        settings file with the keys TEXT, DIRECTORY, FILTER,
+//                          THREADS, MIN_THREADS, MAX_FILE_SIZE, MEMORY_BUDGET,
+//                          RECURSIVE, IGNORE_CASE, REGEX, IGNORE_FILES, DEDUP,
+//                          FOLLOW_SYMLINKS, ONE_FILE_SYSTEM, ORDER, INTERLEAVE,
+//                          BINARY, MODE, FORMAT, EXPORT, INDEX and TIMINGS,
+//                          arguments override them
+//   --threads <count>      search threads, the number of cpus by default
+//   --min-threads <count>  lets the number of active search threads change between
+//                          this and --threads depending on how busy they are
+//   --filter <globs>       comma separated file name globs, * by default
+//   -i, --ignore-case
+//   -e, --regex            text_to_find is a regular expression
+//   -l, --files-with-matches
+//                          only the paths of files that match, a file is searched
+//                          up to its first match
+//   -c, --count            path:count of files that match, matches are counted
+//                          without saving them
+//   --no-recursive
+//   --ignore-files         skip what .gitignore and .ignore files list, every file
+//                          is searched by default
+//   --no-ignore            don't read .gitignore and .ignore files, for a config
+//                          with IGNORE_FILES set
+//   --dedup                search every directory and file once, by device and inode
+//   -L, --follow           follow symbolic links
+//   --one-file-system      don't walk into directories on other file systems
+//   --order <order>        listed (default), inode or extent, the order files are read in
+//   --interleave           spread large files over the small ones
+//   --binary <mode>        skip (default), raw or text
+//   --max-filesize <bytes>
+//   --memory-budget <bytes> files wait to be read until their content fits next to
+//                          the files being searched, larger files are read alone
+//   --json                 json lines instead of grep style text
+//   --export <path>
+//   --index <path>
+//   --timings
+// prints the problem to stderr and returns false when the arguments are invalid.
+bool command_line_search_parse(command_line_search_options *options, s32 argc, char **argv);
+void command_line_search_options_destroy(command_line_search_options *options);
+
+// returns an exit code like grep: 0 when something matched, 1 when nothing
+// matched and 2 when a file or the export could not be read or written.
+s32 command_line_search_run(command_line_search_options *options);
+
+// parses argv and runs the search, for the main function of a program that is
+// started without a display.
+s32 command_line_search_main(s32 argc, char **argv);
+
+#endif
\ No newline at end of file
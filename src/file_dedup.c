@@ -0,0 +1,109 @@
+/* 
+*  BSD 2-Clause “Simplified” License
+*  Copyright (c) 2019, Aldrik Ramaekers, aldrik.ramaekers@protonmail.com
+*  All rights reserved.
+*/
+
+file_dedup *file_dedup_create(bool follow_symlinks, bool one_file_system)
+{
+	file_dedup *dedup = mem_alloc(sizeof(file_dedup));
+	memset(dedup, 0, sizeof(file_dedup));
+	dedup->capacity = FILE_DEDUP_INITIAL_CAPACITY;
+	dedup->slots = mem_alloc(sizeof(file_identity)*dedup->capacity);
+	memset(dedup->slots, 0, sizeof(file_identity)*dedup->capacity);
+	dedup->follow_symlinks = follow_symlinks;
+	dedup->one_file_system = one_file_system;
+	
+	return dedup;
+}
+
+void file_dedup_destroy(file_dedup *dedup)
+{
+	mem_free(dedup->slots);
+	mem_free(dedup);
+}
+
+static u32 file_dedup_hash(file_identity identity)
+{
+	u64 hash = (identity.inode ^ (identity.device * 0x9E3779B97F4A7C15ULL)) * 0xBF58476D1CE4E5B9ULL;
+	return (u32)(hash >> 32);
+}
+
+static void file_dedup_grow(file_dedup *dedup)
+{
+	file_identity *old_slots = dedup->slots;
+	u32 old_capacity = dedup->capacity;
+	
+	dedup->capacity *= 2;
+	dedup->slots = mem_alloc(sizeof(file_identity)*dedup->capacity);
+	memset(dedup->slots, 0, sizeof(file_identity)*dedup->capacity);
+	
+	u32 mask = dedup->capacity-1;
+	for (u32 i = 0; i < old_capacity; i++)
+	{
+		file_identity identity = old_slots[i];
+		if (!identity.device && !identity.inode) continue;
+		
+		u32 index = file_dedup_hash(identity) & mask;
+		while (dedup->slots[index].device || dedup->slots[index].inode) index = (index+1) & mask;
+		dedup->slots[index] = identity;
+	}
+	
+	mem_free(old_slots);
+}
+
+bool file_dedup_insert(file_dedup *dedup, file_identity identity)
+{
+	// can't be told apart from an empty slot, never treated as a duplicate
+	if (!identity.device && !identity.inode) return true;
+	
+	// at most half full so probe sequences stay short
+	if ((dedup->count+1)*2 > dedup->capacity) file_dedup_grow(dedup);
+	
+	u32 mask = dedup->capacity-1;
+	u32 index = file_dedup_hash(identity) & mask;
+	while (dedup->slots[index].device || dedup->slots[index].inode)
+	{
+		if (dedup->slots[index].device == identity.device && dedup->slots[index].inode == identity.inode)
+			return false;
+		index = (index+1) & mask;
+	}
+	
+	dedup->slots[index] = identity;
+	dedup->count++;
+	return true;
+}
+
+void file_dedup_set_root(file_dedup *dedup, file_identity identity)
+{
+	dedup->has_root = true;
+	dedup->root_device = identity.device;
+	dedup->device = identity.device;
+	file_dedup_insert(dedup, identity);
+}
+
+bool file_dedup_visit_directory(file_dedup *dedup, file_identity identity)
+{
+	if (dedup->one_file_system && identity.device != dedup->root_device)
+	{
+		dedup->other_file_system_count++;
+		return false;
+	}
+	
+	if (!file_dedup_insert(dedup, identity))
+	{
+		dedup->duplicate_dir_count++;
+		return false;
+	}
+	return true;
+}
+
+bool file_dedup_visit_file(file_dedup *dedup, file_identity identity)
+{
+	if (!file_dedup_insert(dedup, identity))
+	{
+		dedup->duplicate_file_count++;
+		return false;
+	}
+	return true;
+}
\ No newline at end of file
@@ -0,0 +1,56 @@
+/* 
+*  BSD 2-Clause “Simplified” License
+*  Copyright (c) 2019, Aldrik Ramaekers, aldrik.ramaekers@protonmail.com
+*  All rights reserved.
+*/
+
+#ifndef INCLUDE_FILE_DEDUP
+#define INCLUDE_FILE_DEDUP
+
+#define FILE_DEDUP_INITIAL_CAPACITY 4096
+
+// device and inode on linux, volume serial number and file index on windows
+typedef struct t_file_identity
+{
+	u64 device;
+	u64 inode;
+} file_identity;
+
+// Set of the directories and files the walker has visited, so bind mounts,
+// hard links and followed symbolic links are walked and searched once and a
+// link to a parent directory can't make the walk loop. Open addressing with
+// linear probing, an identity of zeroes marks an empty slot. It is only used by
+// the walker thread and has no lock.
+typedef struct t_file_dedup
+{
+	file_identity *slots;
+	u32 capacity; // power of two
+	u32 count;
+	
+	bool follow_symlinks; // links to directories and files are walked instead of skipped
+	bool one_file_system; // directories on another device than the walked directory are skipped
+	bool has_root;
+	u64 root_device;
+	u64 device; // of the directory being walked
+	
+	u64 duplicate_dir_count;
+	u64 duplicate_file_count;
+	u64 other_file_system_count; // directories skipped because of one_file_system
+} file_dedup;
+
+file_dedup *file_dedup_create(bool follow_symlinks, bool one_file_system);
+void file_dedup_destroy(file_dedup *dedup);
+
+// called by the walker with the identity of the directory it starts in
+void file_dedup_set_root(file_dedup *dedup, file_identity identity);
+
+// returns false when the directory was visited before or is on another file
+// system while one_file_system is set.
+bool file_dedup_visit_directory(file_dedup *dedup, file_identity identity);
+// returns false when the file was visited before.
+bool file_dedup_visit_file(file_dedup *dedup, file_identity identity);
+
+// adds identity to the set, returns false when it was there already
+bool file_dedup_insert(file_dedup *dedup, file_identity identity);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,513 @@
+/* 
+*  BSD 2-Clause “Simplified” License
+*  Copyright (c) 2019, Aldrik Ramaekers, aldrik.ramaekers@protonmail.com
+*  All rights reserved.
+*/
+
+// reads one element of the pattern, a '*' or the bytes accepted by one state
+static char *file_filter_glob_element(char *ch, bool ignore_syntax, u64 set[4], bool *is_star)
+{
+	memset(set, 0, sizeof(u64)*4);
+	*is_star = (*ch == '*');
+	if (*is_star) return ch+1;
+	
+	if (*ch == '?')
+	{
+		// '?' needs one byte, the terminating zero is never read
+		memset(set, 0xFF, sizeof(u64)*4);
+		set[0] &= ~1ull;
+		return ch+1;
+	}
+	
+	if (ignore_syntax && *ch == '\\' && ch[1])
+	{
+		ch++;
+	}
+	else if (ignore_syntax && *ch == '[')
+	{
+		char *end = ch+1;
+		if (*end == '!' || *end == '^') end++;
+		if (*end == ']') end++;
+		while (*end && *end != ']')
+		{
+			if (*end == '\\' && end[1]) end++;
+			end++;
+		}
+		
+		// without a closing bracket the '[' is a normal character
+		if (*end == ']')
+		{
+			char *cursor = ch+1;
+			bool negated = (*cursor == '!' || *cursor == '^');
+			if (negated) cursor++;
+			
+			while (cursor < end)
+			{
+				if (*cursor == '\\' && cursor+1 < end) cursor++;
+				u8 range_first = *cursor++;
+				u8 range_last = range_first;
+				if (cursor+1 < end && *cursor == '-')
+				{
+					cursor++;
+					if (*cursor == '\\' && cursor+1 < end) cursor++;
+					range_last = *cursor++;
+				}
+				for (s32 c = range_first; c <= range_last; c++) set[c/64] |= 1ull << (c%64);
+			}
+			
+			if (negated)
+			{
+				for (s32 i = 0; i < 4; i++) set[i] = ~set[i];
+				set[0] &= ~1ull;
+			}
+			return end+1;
+		}
+	}
+	
+	set[(u8)*ch/64] |= 1ull << ((u8)*ch%64);
+	return ch+1;
+}
+
+file_filter_glob file_filter_glob_create_ex(char *pattern, bool ignore_syntax)
+{
+	file_filter_glob glob;
+	glob.pattern_length = strlen(pattern);
+	glob.pattern = mem_alloc(glob.pattern_length+1);
+	string_copyn(glob.pattern, pattern, glob.pattern_length+1);
+	
+	u64 set[4];
+	bool is_star;
+	s32 state_count = 1;
+	for (char *ch = pattern; *ch;)
+	{
+		ch = file_filter_glob_element(ch, ignore_syntax, set, &is_star);
+		if (!is_star) state_count++;
+	}
+	
+	glob.word_count = (state_count+63)/64;
+	glob.char_masks = mem_alloc(sizeof(u64)*256*glob.word_count);
+	glob.star_mask = mem_alloc(sizeof(u64)*glob.word_count);
+	memset(glob.char_masks, 0, sizeof(u64)*256*glob.word_count);
+	memset(glob.star_mask, 0, sizeof(u64)*glob.word_count);
+	
+	s32 state = 0;
+	for (char *ch = pattern; *ch;)
+	{
+		ch = file_filter_glob_element(ch, ignore_syntax, set, &is_star);
+		if (is_star)
+		{
+			glob.star_mask[state/64] |= 1ull << (state%64);
+			continue;
+		}
+		
+		state++;
+		u64 bit = 1ull << (state%64);
+		s32 word = state/64;
+		for (s32 c = 1; c < 256; c++)
+		{
+			if (set[c/64] & (1ull << (c%64)))
+				glob.char_masks[c*glob.word_count+word] |= bit;
+		}
+	}
+	glob.accept_mask = 1ull << (state%64);
+	
+	return glob;
+}
+
+static bool file_filter_glob_matches_wide(file_filter_glob *glob, u8 *string)
+{
+	s32 word_count = glob->word_count;
+	u64 states[word_count];
+	memset(states, 0, sizeof(states));
+	states[0] = 1;
+	
+	for (; *string; string++)
+	{
+		u64 *mask = glob->char_masks + (*string)*word_count;
+		u64 carry = 0;
+		u64 alive = 0;
+		for (s32 i = 0; i < word_count; i++)
+		{
+			u64 current = states[i];
+			states[i] = (((current << 1) | carry) & mask[i]) | (current & glob->star_mask[i]);
+			carry = current >> 63;
+			alive |= states[i];
+		}
+		
+		if (!alive) return false;
+	}
+	
+	return (states[word_count-1] & glob->accept_mask) != 0;
+}
+
+bool file_filter_glob_matches(file_filter_glob *glob, char *string)
+{
+	if (glob->word_count > 1)
+		return file_filter_glob_matches_wide(glob, (u8*)string);
+	
+	u64 star = glob->star_mask[0];
+	u64 states = 1;
+	for (u8 *ch = (u8*)string; *ch; ch++)
+	{
+		states = ((states << 1) & glob->char_masks[*ch]) | (states & star);
+		if (!states) return false;
+	}
+	
+	return (states & glob->accept_mask) != 0;
+}
+
+void file_filter_glob_destroy(file_filter_glob *glob)
+{
+	mem_free(glob->pattern);
+	mem_free(glob->char_masks);
+	mem_free(glob->star_mask);
+}
+
+static u32 file_filter_hash(char *text, s32 length)
+{
+	// fnv-1a
+	u32 hash = 2166136261u;
+	for (s32 i = 0; i < length; i++)
+	{
+		hash ^= (u8)text[i];
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+static file_filter_kind file_filter_classify(char *pattern, char **literal, s32 *literal_length)
+{
+	char *start = pattern;
+	while (*start == '*') start++;
+	
+	char *end = start;
+	while (*end && *end != '*' && *end != '?') end++;
+	
+	char *rest = end;
+	while (*rest == '*') rest++;
+	
+	bool leading_star = start != pattern;
+	bool trailing_star = rest != end;
+	*literal = start;
+	*literal_length = end - start;
+	
+	if (*rest) return FILE_FILTER_GLOB;
+	if (*literal_length == 0) return leading_star ? FILE_FILTER_MATCH_ALL : FILE_FILTER_EXACT;
+	if (leading_star && trailing_star) return FILE_FILTER_CONTAINS;
+	if (leading_star) return *start == '.' ? FILE_FILTER_EXTENSION : FILE_FILTER_SUFFIX;
+	if (trailing_star) return FILE_FILTER_PREFIX;
+	return FILE_FILTER_EXACT;
+}
+
+static void file_filter_build_extensions(file_filter *filter, array *extensions)
+{
+	filter->extensions = 0;
+	filter->extension_table_size = 0;
+	filter->extension_max_dots = 0;
+	if (!extensions->length) return;
+	
+	s32 size = 16;
+	while (size < extensions->length*2) size *= 2;
+	filter->extension_table_size = size;
+	filter->extensions = mem_alloc(sizeof(file_filter_extension)*size);
+	memset(filter->extensions, 0, sizeof(file_filter_extension)*size);
+	
+	for (s32 i = 0; i < extensions->length; i++)
+	{
+		file_filter_extension *extension = array_at(extensions, i);
+		
+		s32 dots = 0;
+		for (s32 x = 0; x < extension->length; x++)
+			if (extension->suffix[x] == '.') dots++;
+		if (dots > filter->extension_max_dots) filter->extension_max_dots = dots;
+		
+		u32 slot = file_filter_hash(extension->suffix, extension->length) & (size-1);
+		while (filter->extensions[slot].suffix)
+		{
+			file_filter_extension *existing = &filter->extensions[slot];
+			// duplicates keep the first pattern, it is the one that is reported
+			if (existing->length == extension->length &&
+				memcmp(existing->suffix, extension->suffix, extension->length) == 0)
+				break;
+			slot = (slot+1) & (size-1);
+		}
+		if (!filter->extensions[slot].suffix)
+			filter->extensions[slot] = *extension;
+	}
+}
+
+static void file_filter_build_automaton(file_filter *filter)
+{
+	filter->state_count = 0;
+	filter->class_count = 0;
+	filter->transitions = 0;
+	filter->state_literals = 0;
+	filter->output_links = 0;
+	memset(filter->byte_class, 0, sizeof(filter->byte_class));
+	if (!filter->literals.length) return;
+	
+	file_filter_literal *literals = filter->literals.data;
+	
+	// bytes that are not in any literal share class 0
+	s32 class_count = 1;
+	s32 max_states = 1;
+	for (s32 i = 0; i < filter->literals.length; i++)
+	{
+		max_states += literals[i].length;
+		for (s32 x = 0; x < literals[i].length; x++)
+		{
+			u8 ch = literals[i].text[x];
+			if (!filter->byte_class[ch]) filter->byte_class[ch] = class_count++;
+		}
+	}
+	
+	s32 *transitions = mem_alloc(sizeof(s32)*max_states*class_count);
+	s32 *state_literals = mem_alloc(sizeof(s32)*max_states);
+	for (s32 i = 0; i < max_states*class_count; i++) transitions[i] = -1;
+	for (s32 i = 0; i < max_states; i++) state_literals[i] = -1;
+	
+	// trie
+	s32 state_count = 1;
+	for (s32 i = 0; i < filter->literals.length; i++)
+	{
+		s32 state = 0;
+		for (s32 x = 0; x < literals[i].length; x++)
+		{
+			s32 *next = &transitions[state*class_count + filter->byte_class[(u8)literals[i].text[x]]];
+			if (*next == -1) *next = state_count++;
+			state = *next;
+		}
+		literals[i].next = state_literals[state];
+		state_literals[state] = i;
+	}
+	
+	// failure links in breadth first order, missing transitions are replaced
+	// by the transition of the failure state so matching never backtracks.
+	s32 *failure = mem_alloc(sizeof(s32)*state_count);
+	s32 *queue = mem_alloc(sizeof(s32)*state_count);
+	s32 *output_links = mem_alloc(sizeof(s32)*state_count);
+	s32 queue_start = 0;
+	s32 queue_end = 0;
+	failure[0] = 0;
+	output_links[0] = -1;
+	queue[queue_end++] = 0;
+	while (queue_start < queue_end)
+	{
+		s32 state = queue[queue_start++];
+		for (s32 c = 0; c < class_count; c++)
+		{
+			s32 *next = &transitions[state*class_count + c];
+			s32 fallback = state == 0 ? 0 : transitions[failure[state]*class_count + c];
+			if (*next == -1)
+			{
+				*next = fallback;
+				continue;
+			}
+			
+			s32 child = *next;
+			failure[child] = fallback;
+			output_links[child] = state_literals[fallback] != -1 ? fallback : output_links[fallback];
+			queue[queue_end++] = child;
+		}
+	}
+	mem_free(failure);
+	mem_free(queue);
+	
+	filter->state_count = state_count;
+	filter->class_count = class_count;
+	filter->transitions = transitions;
+	filter->state_literals = state_literals;
+	filter->output_links = output_links;
+}
+
+file_filter file_filter_create(char *filter)
+{
+	file_filter result;
+	result.patterns = array_create(sizeof(file_filter_pattern));
+	result.literals = array_create(sizeof(file_filter_literal));
+	result.glob_indices = array_create(sizeof(s32));
+	result.match_all_index = -1;
+	
+	array filters = get_filters(filter);
+	for (s32 i = 0; i < filters.length; i++)
+	{
+		char *text = array_at(&filters, i);
+		
+		file_filter_pattern pattern;
+		pattern.length = strlen(text);
+		pattern.text = mem_alloc(pattern.length+1);
+		string_copyn(pattern.text, text, pattern.length+1);
+		array_push(&result.patterns, &pattern);
+	}
+	array_destroy(&filters);
+	
+	array extensions = array_create(sizeof(file_filter_extension));
+	for (s32 i = 0; i < result.patterns.length; i++)
+	{
+		file_filter_pattern *pattern = array_at(&result.patterns, i);
+		
+		char *literal;
+		s32 literal_length;
+		pattern->kind = file_filter_classify(pattern->text, &literal, &literal_length);
+		
+		switch(pattern->kind)
+		{
+			case FILE_FILTER_MATCH_ALL:
+			if (result.match_all_index == -1) result.match_all_index = i;
+			break;
+			
+			case FILE_FILTER_EXTENSION:
+			{
+				file_filter_extension extension = {literal, literal_length, i};
+				array_push(&extensions, &extension);
+			}
+			break;
+			
+			case FILE_FILTER_GLOB:
+			pattern->glob = file_filter_glob_create(pattern->text);
+			array_push(&result.glob_indices, &i);
+			break;
+			
+			default:
+			// names are never empty
+			if (literal_length)
+			{
+				file_filter_literal entry = {literal, i, literal_length, -1};
+				array_push(&result.literals, &entry);
+			}
+			break;
+		}
+	}
+	
+	file_filter_build_extensions(&result, &extensions);
+	array_destroy(&extensions);
+	file_filter_build_automaton(&result);
+	
+	return result;
+}
+
+static s32 file_filter_find_extension(file_filter *filter, char *string, s32 length)
+{
+	s32 best = -1;
+	s32 dots = 0;
+	u32 mask = filter->extension_table_size-1;
+	
+	// a suffix with n dots can only start at one of the last n dots of the name
+	for (s32 i = length-1; i >= 0 && dots < filter->extension_max_dots; i--)
+	{
+		if (string[i] != '.') continue;
+		dots++;
+		
+		s32 suffix_length = length-i;
+		u32 slot = file_filter_hash(string+i, suffix_length) & mask;
+		while (filter->extensions[slot].suffix)
+		{
+			file_filter_extension *extension = &filter->extensions[slot];
+			if (extension->length == suffix_length &&
+				memcmp(extension->suffix, string+i, suffix_length) == 0)
+			{
+				if (best == -1 || extension->pattern_index < best)
+					best = extension->pattern_index;
+				break;
+			}
+			slot = (slot+1) & mask;
+		}
+	}
+	
+	return best;
+}
+
+static s32 file_filter_find_literal(file_filter *filter, char *string, s32 length, s32 best)
+{
+	file_filter_pattern *patterns = filter->patterns.data;
+	file_filter_literal *literals = filter->literals.data;
+	s32 class_count = filter->class_count;
+	
+	s32 state = 0;
+	for (s32 i = 0; i < length; i++)
+	{
+		state = filter->transitions[state*class_count + filter->byte_class[(u8)string[i]]];
+		
+		s32 output = filter->state_literals[state] != -1 ? state : filter->output_links[state];
+		for (; output != -1; output = filter->output_links[output])
+		{
+			for (s32 l = filter->state_literals[output]; l != -1; l = literals[l].next)
+			{
+				file_filter_literal *literal = &literals[l];
+				if (best != -1 && literal->pattern_index >= best) continue;
+				
+				bool at_start = (i+1 == literal->length);
+				bool at_end = (i == length-1);
+				
+				bool matches = false;
+				switch(patterns[literal->pattern_index].kind)
+				{
+					case FILE_FILTER_CONTAINS: matches = true; break;
+					case FILE_FILTER_PREFIX: matches = at_start; break;
+					case FILE_FILTER_SUFFIX: matches = at_end; break;
+					case FILE_FILTER_EXACT: matches = at_start && at_end; break;
+					default: break;
+				}
+				
+				if (matches) best = literal->pattern_index;
+			}
+		}
+	}
+	
+	return best;
+}
+
+s32 file_filter_matches(file_filter *filter, char *string, char **matched_filter)
+{
+	s32 length = strlen(string);
+	s32 best = filter->match_all_index;
+	
+	if (best != 0 && filter->extension_table_size)
+	{
+		s32 index = file_filter_find_extension(filter, string, length);
+		if (index != -1 && (best == -1 || index < best)) best = index;
+	}
+	
+	if (best != 0 && filter->state_count)
+		best = file_filter_find_literal(filter, string, length, best);
+	
+	// globs are only tried when they come before the best match so far
+	file_filter_pattern *patterns = filter->patterns.data;
+	s32 *glob_indices = filter->glob_indices.data;
+	for (s32 i = 0; i < filter->glob_indices.length; i++)
+	{
+		s32 index = glob_indices[i];
+		if (best != -1 && index >= best) break;
+		
+		if (file_filter_glob_matches(&patterns[index].glob, string))
+		{
+			best = index;
+			break;
+		}
+	}
+	
+	if (best == -1) return -1;
+	
+	*matched_filter = patterns[best].text;
+	return patterns[best].length;
+}
+
+void file_filter_destroy(file_filter *filter)
+{
+	for (s32 i = 0; i < filter->patterns.length; i++)
+	{
+		file_filter_pattern *pattern = array_at(&filter->patterns, i);
+		if (pattern->kind == FILE_FILTER_GLOB)
+			file_filter_glob_destroy(&pattern->glob);
+		mem_free(pattern->text);
+	}
+	
+	mem_free(filter->extensions);
+	mem_free(filter->transitions);
+	mem_free(filter->state_literals);
+	mem_free(filter->output_links);
+	
+	array_destroy(&filter->patterns);
+	array_destroy(&filter->literals);
+	array_destroy(&filter->glob_indices);
+}
\ No newline at end of file
@@ -0,0 +1,96 @@
+/* 
+*  BSD 2-Clause “Simplified” License
+*  Copyright (c) 2019, Aldrik Ramaekers, aldrik.ramaekers@protonmail.com
+*  All rights reserved.
+*/
+
+#ifndef INCLUDE_FILE_FILTER
+#define INCLUDE_FILE_FILTER
+
+// glob with '*' (any sequence) and '?' (any byte) compiled to a bit-parallel
+// nfa, state i is set when the first i non-star characters are matched.
+// matching is linear in the length of the name, no matter how many '*' there are.
+typedef struct t_file_filter_glob
+{
+	char *pattern;
+	s32 pattern_length;
+	s32 word_count; // u64 words per state set
+	u64 *char_masks; // per byte, the states that can be entered by reading it
+	u64 *star_mask; // states that loop on any byte
+	u64 accept_mask; // final state, in the last word
+} file_filter_glob;
+
+typedef enum t_file_filter_kind
+{
+	FILE_FILTER_MATCH_ALL, // *
+	FILE_FILTER_EXTENSION, // *.ext, looked up in the extension table
+	FILE_FILTER_EXACT, // name
+	FILE_FILTER_PREFIX, // name*
+	FILE_FILTER_SUFFIX, // *name
+	FILE_FILTER_CONTAINS, // *name*
+	FILE_FILTER_GLOB, // anything else, needs the glob matcher
+} file_filter_kind;
+
+typedef struct t_file_filter_pattern
+{
+	char *text;
+	s32 length;
+	file_filter_kind kind;
+	file_filter_glob glob; // only for FILE_FILTER_GLOB
+} file_filter_pattern;
+
+typedef struct t_file_filter_extension
+{
+	char *suffix; // including the dot
+	s32 length;
+	s32 pattern_index;
+} file_filter_extension;
+
+// literal of an exact/prefix/suffix/contains pattern in the aho-corasick automaton
+typedef struct t_file_filter_literal
+{
+	char *text; // points into the pattern text
+	s32 pattern_index;
+	s32 length;
+	s32 next; // next literal ending in the same state, -1 if none
+} file_filter_literal;
+
+typedef struct t_file_filter
+{
+	array patterns; // file_filter_pattern, in the order they were given
+	s32 match_all_index; // first '*' pattern, -1 if none
+	
+	// open addressing table of *.ext suffixes
+	file_filter_extension *extensions;
+	s32 extension_table_size; // power of 2, 0 when empty
+	s32 extension_max_dots; // most dots in any suffix
+	
+	// aho-corasick automaton over all literals, transitions are full so
+	// matching is one table lookup per byte of the name.
+	array literals; // file_filter_literal
+	s32 state_count;
+	s32 class_count;
+	u8 byte_class[256];
+	s32 *transitions; // state_count*class_count
+	s32 *state_literals; // first literal ending in each state, -1 if none
+	s32 *output_links; // closest state on the failure chain with literals, -1 if none
+	
+	array glob_indices; // s32, patterns that need the glob matcher, ascending
+} file_filter;
+
+// ignore_syntax adds the parts of .gitignore globs that work on a single path
+// segment: [abc], [a-z], [!abc] and backslash escapes.
+file_filter_glob file_filter_glob_create_ex(char *pattern, bool ignore_syntax);
+#define file_filter_glob_create(_pattern) file_filter_glob_create_ex(_pattern, false)
+bool file_filter_glob_matches(file_filter_glob *glob, char *string);
+void file_filter_glob_destroy(file_filter_glob *glob);
+
+// filter is a comma separated list of globs, see get_filters.
+// file_filter_matches returns the length of the first glob that matches string and
+// stores it in matched_filter, or -1 when nothing matches. patterns are split by
+// kind so the cost per name barely grows with the number of patterns.
+file_filter file_filter_create(char *filter);
+s32 file_filter_matches(file_filter *filter, char *string, char **matched_filter);
+void file_filter_destroy(file_filter *filter);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,277 @@
+/* 
+*  BSD 2-Clause “Simplified” License
+*  Copyright (c) 2019, Aldrik Ramaekers, aldrik.ramaekers@protonmail.com
+*  All rights reserved.
+*/
+
+static bool file_ignore_is_separator(char ch)
+{
+	return ch == '/' || ch == '\\';
+}
+
+static void file_ignore_add_rule(file_ignore_layer *layer, char *pattern)
+{
+	file_ignore_rule rule;
+	rule.negated = false;
+	rule.directory_only = false;
+	rule.anchored = false;
+	
+	if (*pattern == '!')
+	{
+		rule.negated = true;
+		pattern++;
+	}
+	
+	s32 length = strlen(pattern);
+	if (length && pattern[length-1] == '/')
+	{
+		rule.directory_only = true;
+		pattern[--length] = 0;
+	}
+	if (*pattern == '/')
+	{
+		rule.anchored = true;
+		pattern++;
+	}
+	if (!*pattern) return;
+	if (strchr(pattern, '/')) rule.anchored = true;
+	
+	rule.segment_count = 1;
+	for (char *ch = pattern; *ch; ch++)
+	{
+		if (*ch == '/') rule.segment_count++;
+	}
+	rule.segments = mem_alloc(sizeof(file_ignore_segment)*rule.segment_count);
+	
+	s32 count = 0;
+	char *start = pattern;
+	while (start)
+	{
+		char *end = strchr(start, '/');
+		if (end) *end = 0;
+		
+		// a//b is the same as a/b
+		if (*start)
+		{
+			file_ignore_segment *segment = &rule.segments[count++];
+			segment->any_depth = strcmp(start, "**") == 0;
+			segment->glob = file_filter_glob_create_ex(start, true);
+		}
+		start = end ? end+1 : 0;
+	}
+	rule.segment_count = count;
+	
+	if (count)
+		array_push(&layer->rules, &rule);
+	else
+		mem_free(rule.segments);
+}
+
+void file_ignore_parse(file_ignore_layer *layer, char *content)
+{
+	char line[MAX_INPUT_LENGTH];
+	
+	char *ch = content;
+	while (*ch)
+	{
+		s32 length = 0;
+		while (*ch && *ch != '\n')
+		{
+			if (length < MAX_INPUT_LENGTH-1) line[length++] = *ch;
+			ch++;
+		}
+		if (*ch) ch++;
+		
+		// trailing spaces are removed unless they are escaped
+		while (length && (line[length-1] == '\r' || line[length-1] == ' ' || line[length-1] == '\t'))
+		{
+			if (length > 1 && line[length-2] == '\\') break;
+			length--;
+		}
+		line[length] = 0;
+		
+		if (!length || line[0] == '#') continue;
+		file_ignore_add_rule(layer, line);
+	}
+}
+
+static void file_ignore_destroy_layer(file_ignore_layer *layer)
+{
+	for (s32 i = 0; i < layer->rules.length; i++)
+	{
+		file_ignore_rule *rule = array_at(&layer->rules, i);
+		for (s32 s = 0; s < rule->segment_count; s++)
+		{
+			file_filter_glob_destroy(&rule->segments[s].glob);
+		}
+		mem_free(rule->segments);
+	}
+	array_destroy(&layer->rules);
+}
+
+static void file_ignore_load(file_ignore *ignore, char *directory)
+{
+	file_ignore_layer layer;
+	layer.depth = ignore->names.length;
+	layer.rules = array_create(sizeof(file_ignore_rule));
+	
+	// .ignore is read last so its rules win, like other search tools do
+	char *file_names[] = { ".gitignore", ".ignore" };
+	for (s32 i = 0; i < 2; i++)
+	{
+		snprintf(ignore->path, MAX_INPUT_LENGTH, "%s%s", directory, file_names[i]);
+		file_content content = platform_read_file_content(ignore->path, "rb");
+		if (content.content)
+		{
+			file_ignore_parse(&layer, content.content);
+			platform_destroy_file_content(&content);
+		}
+	}
+	
+	if (layer.rules.length)
+		array_push(&ignore->layers, &layer);
+	else
+		array_destroy(&layer.rules);
+}
+
+static bool file_ignore_has_git(char *directory, s32 length)
+{
+	char path[MAX_INPUT_LENGTH];
+	snprintf(path, MAX_INPUT_LENGTH, "%.*s.git", length, directory);
+	
+	// a directory, or a file in worktrees and submodules
+	file_info info;
+	return platform_get_file_info(path, &info);
+}
+
+file_ignore *file_ignore_create(char *directory)
+{
+	file_ignore *ignore = mem_alloc(sizeof(file_ignore));
+	ignore->names = array_create(sizeof(char*));
+	ignore->layers = array_create(sizeof(file_ignore_layer));
+	
+	// find the repository root, its length includes the separator
+	s32 length = strlen(directory);
+	s32 root_length = length;
+	while (root_length && !file_ignore_has_git(directory, root_length))
+	{
+		root_length--;
+		while (root_length && !file_ignore_is_separator(directory[root_length-1])) root_length--;
+	}
+	if (!root_length) root_length = length;
+	
+	char parent[MAX_INPUT_LENGTH];
+	snprintf(parent, MAX_INPUT_LENGTH, "%.*s", root_length, directory);
+	file_ignore_load(ignore, parent);
+	
+	// the directories between the root and the walked directory
+	s32 start = root_length;
+	for (s32 i = root_length; i < length; i++)
+	{
+		if (!file_ignore_is_separator(directory[i])) continue;
+		
+		char name[MAX_INPUT_LENGTH];
+		snprintf(name, MAX_INPUT_LENGTH, "%.*s", i-start, directory+start);
+		snprintf(parent, MAX_INPUT_LENGTH, "%.*s", i+1, directory);
+		start = i+1;
+		
+		if (*name) file_ignore_enter(ignore, parent, name);
+	}
+	
+	return ignore;
+}
+
+void file_ignore_destroy(file_ignore *ignore)
+{
+	while (ignore->names.length) file_ignore_leave(ignore);
+	for (s32 i = 0; i < ignore->layers.length; i++)
+	{
+		file_ignore_destroy_layer(array_at(&ignore->layers, i));
+	}
+	array_destroy(&ignore->layers);
+	array_destroy(&ignore->names);
+	mem_free(ignore);
+}
+
+void file_ignore_enter(file_ignore *ignore, char *directory, char *name)
+{
+	s32 length = strlen(name);
+	char *copy = mem_alloc(length+1);
+	string_copyn(copy, name, length+1);
+	array_push(&ignore->names, &copy);
+	
+	file_ignore_load(ignore, directory);
+}
+
+void file_ignore_leave(file_ignore *ignore)
+{
+	assert(ignore->names.length);
+	
+	while (ignore->layers.length)
+	{
+		file_ignore_layer *layer = array_at(&ignore->layers, ignore->layers.length-1);
+		if (layer->depth < ignore->names.length) break;
+		
+		file_ignore_destroy_layer(layer);
+		ignore->layers.length--;
+	}
+	
+	char **names = ignore->names.data;
+	mem_free(names[ignore->names.length-1]);
+	ignore->names.length--;
+}
+
+// path is names followed by name
+static bool file_ignore_match_path(file_ignore_segment *segments, s32 segment_count, char **names, s32 name_count, char *name, s32 path_index)
+{
+	s32 path_length = name_count+1;
+	for (s32 i = 0; i < segment_count; i++)
+	{
+		file_ignore_segment *segment = &segments[i];
+		if (segment->any_depth)
+		{
+			// a/** only matches what is inside a
+			if (i == segment_count-1) return path_index < path_length;
+			
+			for (s32 skip = path_index; skip < path_length; skip++)
+			{
+				if (file_ignore_match_path(segments+i+1, segment_count-i-1, names, name_count, name, skip))
+					return true;
+			}
+			return false;
+		}
+		
+		if (path_index >= path_length) return false;
+		char *part = path_index < name_count ? names[path_index] : name;
+		if (!file_filter_glob_matches(&segment->glob, part)) return false;
+		path_index++;
+	}
+	
+	return path_index == path_length;
+}
+
+bool file_ignore_matches(file_ignore *ignore, char *name, bool is_directory)
+{
+	if (is_directory && strcmp(name, ".git") == 0) return true;
+	
+	char **names = ignore->names.data;
+	for (s32 l = ignore->layers.length-1; l >= 0; l--)
+	{
+		file_ignore_layer *layer = array_at(&ignore->layers, l);
+		for (s32 r = layer->rules.length-1; r >= 0; r--)
+		{
+			file_ignore_rule *rule = array_at(&layer->rules, r);
+			if (rule->directory_only && !is_directory) continue;
+			
+			bool matched;
+			if (rule->anchored)
+				matched = file_ignore_match_path(rule->segments, rule->segment_count, names+layer->depth, ignore->names.length-layer->depth, name, 0);
+			else
+				matched = file_filter_glob_matches(&rule->segments[0].glob, name);
+			
+			if (matched) return !rule->negated;
+		}
+	}
+	
+	return false;
+}
\ No newline at end of file
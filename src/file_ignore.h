@@ -0,0 +1,60 @@
+/* 
+*  BSD 2-Clause “Simplified” License
+*  Copyright (c) 2019, Aldrik Ramaekers, aldrik.ramaekers@protonmail.com
+*  All rights reserved.
+*/
+
+#ifndef INCLUDE_FILE_IGNORE
+#define INCLUDE_FILE_IGNORE
+
+// Rules from .gitignore and .ignore files, used by the directory walker to skip
+// whole subtrees. Each rule is split on '/' and every segment is compiled with the
+// glob engine, '**' segments match any number of directories. Rules in deeper
+// files and later lines win, '!' rules include a path again.
+typedef struct t_file_ignore_segment
+{
+	file_filter_glob glob;
+	bool any_depth; // **
+} file_ignore_segment;
+
+typedef struct t_file_ignore_rule
+{
+	bool negated; // !pattern
+	bool directory_only; // pattern/
+	bool anchored; // has a '/' before the end, matched from the directory of the file
+	s32 segment_count;
+	file_ignore_segment *segments;
+} file_ignore_rule;
+
+// rules of one directory
+typedef struct t_file_ignore_layer
+{
+	s32 depth; // number of directory names above the layer's directory
+	array rules; // file_ignore_rule
+} file_ignore_layer;
+
+typedef struct t_file_ignore
+{
+	array names; // char*, directories from the top layer to the walked directory
+	array layers; // file_ignore_layer, outermost first
+	char path[MAX_INPUT_LENGTH];
+} file_ignore;
+
+// directory is the directory that will be walked and ends with a path separator.
+// when it is inside a git repository the ignore files of its parents up to the
+// repository root are loaded too.
+file_ignore *file_ignore_create(char *directory);
+void file_ignore_destroy(file_ignore *ignore);
+
+// called by the walker around every directory it descends into, directory is the
+// full path ending with a separator and name is the last part of it.
+void file_ignore_enter(file_ignore *ignore, char *directory, char *name);
+void file_ignore_leave(file_ignore *ignore);
+
+// name is an entry of the directory that was entered last
+bool file_ignore_matches(file_ignore *ignore, char *name, bool is_directory);
+
+// parses the contents of an ignore file and adds its rules to layer
+void file_ignore_parse(file_ignore_layer *layer, char *content);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,245 @@
+/* 
+*  BSD 2-Clause “Simplified” License
+*  Copyright (c) 2019, Aldrik Ramaekers, aldrik.ramaekers@protonmail.com
+*  All rights reserved.
+*/
+
+static bool file_reader_take_pending(file_reader *reader, file_read *result)
+{
+	bool found = false;
+	
+	mutex_lock(&reader->mutex);
+	// every read that is started has to fit in the completed ring
+	if (reader->completed_count + reader->in_flight < FILE_READER_QUEUE_DEPTH &&
+		reader->pending_cursor < reader->pending.length)
+	{
+		*result = *(file_read*)array_at(&reader->pending, reader->pending_cursor);
+		reader->pending_cursor++;
+		reader->in_flight++;
+		found = true;
+		
+		if (reader->pending_cursor == reader->pending.length)
+		{
+			reader->pending.length = 0;
+			reader->pending_cursor = 0;
+		}
+	}
+	mutex_unlock(&reader->mutex);
+	
+	return found;
+}
+
+static bool file_reader_is_drained(file_reader *reader)
+{
+	mutex_lock(&reader->mutex);
+	bool result = reader->done_submitting &&
+		reader->pending_cursor == reader->pending.length;
+	mutex_unlock(&reader->mutex);
+	
+	return result;
+}
+
+static void file_reader_push_completed(file_reader *reader, file_read *read)
+{
+	mutex_lock(&reader->mutex);
+	s32 index = (reader->completed_start + reader->completed_count) % FILE_READER_QUEUE_DEPTH;
+	reader->completed[index] = *read;
+	reader->completed_count++;
+	reader->in_flight--;
+	mutex_unlock(&reader->mutex);
+}
+
+u32 file_reader_take_ticket(file_reader *reader)
+{
+	return __atomic_fetch_add(&reader->budget_next_ticket, 1, __ATOMIC_RELAXED);
+}
+
+bool file_reader_reserve(file_reader *reader, s64 size, u32 ticket)
+{
+	mutex_lock(&reader->mutex);
+	bool result = ticket == reader->budget_serving_ticket &&
+		(!reader->memory_budget || !reader->memory_used || reader->memory_used + size <= reader->memory_budget);
+	if (result)
+	{
+		reader->budget_serving_ticket++;
+		reader->memory_used += size;
+		if (reader->memory_used > reader->peak_memory_used) reader->peak_memory_used = reader->memory_used;
+	}
+	mutex_unlock(&reader->mutex);
+	
+	return result;
+}
+
+bool file_reader_wait_for_budget(file_reader *reader, s64 size)
+{
+	u32 ticket = file_reader_take_ticket(reader);
+	if (file_reader_reserve(reader, size, ticket)) return true;
+	
+	__atomic_fetch_add(&reader->budget_wait_count, 1, __ATOMIC_RELAXED);
+	while (!file_reader_reserve(reader, size, ticket))
+	{
+		// reads after this one stop waiting too
+		if (reader->stop) return false;
+		thread_sleep(FILE_READER_BUDGET_WAIT_US);
+	}
+	return true;
+}
+
+void file_reader_unreserve(file_reader *reader, s64 size)
+{
+	mutex_lock(&reader->mutex);
+	reader->memory_used -= size;
+	mutex_unlock(&reader->mutex);
+}
+
+static void *file_reader_thread_pool_worker(void *args)
+{
+	file_reader *reader = args;
+	
+	file_read read;
+	while (!reader->stop)
+	{
+		if (!file_reader_take_pending(reader, &read))
+		{
+			if (file_reader_is_drained(reader)) break;
+			
+			thread_sleep(FILE_READER_IDLE_US);
+			continue;
+		}
+		
+		read.content = file_reader_read_blocking(reader, read.path, &read.reserved);
+		file_reader_push_completed(reader, &read);
+	}
+	
+	return 0;
+}
+
+file_reader *file_reader_create_ex(s32 thread_count, s32 max_file_size, file_reader_backend preferred_backend)
+{
+	file_reader *reader = mem_alloc(sizeof(file_reader));
+	reader->mutex = mutex_create();
+	reader->pending = array_create(sizeof(file_read));
+	reader->pending.reserve_jump = FILE_READER_QUEUE_DEPTH;
+	reader->pending_cursor = 0;
+	reader->completed_start = 0;
+	reader->completed_count = 0;
+	reader->in_flight = 0;
+	reader->max_file_size = max_file_size;
+	reader->memory_budget = 0;
+	reader->memory_used = 0;
+	reader->peak_memory_used = 0;
+	reader->budget_next_ticket = 0;
+	reader->budget_serving_ticket = 0;
+	reader->budget_wait_count = 0;
+	reader->backend_data = 0;
+	reader->done_submitting = false;
+	reader->stop = false;
+	
+	if (thread_count < 1) thread_count = 1;
+	
+	if (preferred_backend == FILE_READER_IO_URING && file_reader_io_uring_start(reader))
+	{
+		reader->backend = FILE_READER_IO_URING;
+		return reader;
+	}
+	
+	reader->backend = FILE_READER_THREAD_POOL;
+	reader->thread_count = thread_count;
+	reader->threads = mem_alloc(sizeof(thread)*thread_count);
+	for (s32 i = 0; i < thread_count; i++)
+	{
+		reader->threads[i] = thread_start(file_reader_thread_pool_worker, reader);
+	}
+	
+	return reader;
+}
+
+void file_reader_set_memory_budget(file_reader *reader, s64 memory_budget)
+{
+	reader->memory_budget = memory_budget;
+}
+
+void file_reader_submit(file_reader *reader, char *path, void *data)
+{
+	file_read read;
+	read.path = path;
+	read.data = data;
+	read.content.content = 0;
+	read.content.content_length = 0;
+	read.content.file_error = 0;
+	read.reserved = 0;
+	
+	mutex_lock(&reader->mutex);
+	array_push(&reader->pending, &read);
+	mutex_unlock(&reader->mutex);
+}
+
+void file_reader_finish_submitting(file_reader *reader)
+{
+	mutex_lock(&reader->mutex);
+	reader->done_submitting = true;
+	mutex_unlock(&reader->mutex);
+}
+
+u32 file_reader_pending_count(file_reader *reader)
+{
+	mutex_lock(&reader->mutex);
+	u32 result = reader->pending.length - reader->pending_cursor;
+	mutex_unlock(&reader->mutex);
+	
+	return result;
+}
+
+bool file_reader_next(file_reader *reader, file_read *result)
+{
+	while (1)
+	{
+		mutex_lock(&reader->mutex);
+		if (reader->completed_count)
+		{
+			*result = reader->completed[reader->completed_start];
+			reader->completed_start = (reader->completed_start + 1) % FILE_READER_QUEUE_DEPTH;
+			reader->completed_count--;
+			mutex_unlock(&reader->mutex);
+			return true;
+		}
+		
+		bool done = reader->stop || (reader->done_submitting && reader->in_flight == 0 &&
+									 reader->pending_cursor == reader->pending.length);
+		mutex_unlock(&reader->mutex);
+		
+		if (done) return false;
+		thread_sleep(FILE_READER_NEXT_WAIT_US);
+	}
+}
+
+void file_reader_release(file_reader *reader, file_read *read)
+{
+	platform_destroy_file_content(&read->content);
+	if (read->reserved) file_reader_unreserve(reader, read->reserved);
+	read->reserved = 0;
+}
+
+void file_reader_destroy(file_reader *reader)
+{
+	reader->stop = true;
+	
+	for (s32 i = 0; i < reader->thread_count; i++)
+	{
+		thread_join(&reader->threads[i]);
+	}
+	mem_free(reader->threads);
+	
+	if (reader->backend == FILE_READER_IO_URING)
+		file_reader_io_uring_stop(reader);
+	
+	for (s32 i = 0; i < reader->completed_count; i++)
+	{
+		file_read *read = &reader->completed[(reader->completed_start + i) % FILE_READER_QUEUE_DEPTH];
+		file_reader_release(reader, read);
+	}
+	
+	array_destroy(&reader->pending);
+	mutex_destroy(&reader->mutex);
+	mem_free(reader);
+}
\ No newline at end of file
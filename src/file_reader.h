@@ -0,0 +1,99 @@
+/* 
+*  BSD 2-Clause “Simplified” License
+*  Copyright (c) 2019, Aldrik Ramaekers, aldrik.ramaekers@protonmail.com
+*  All rights reserved.
+*/
+
+#ifndef INCLUDE_FILE_READER
+#define INCLUDE_FILE_READER
+
+// number of open+read operations kept in flight by the io_uring backend,
+// also the maximum number of read buffers waiting to be picked up.
+#define FILE_READER_QUEUE_DEPTH 256
+// reads waiting for the memory budget check again after this long
+#define FILE_READER_BUDGET_WAIT_US 100
+// workers without pending files check again after this long
+#define FILE_READER_IDLE_US 1000
+// consumers waiting for a finished read check again after this long, it is short
+// because searching stalls on it
+#define FILE_READER_NEXT_WAIT_US 100
+
+typedef enum t_file_reader_backend
+{
+	FILE_READER_THREAD_POOL, // blocking open/pread/close on worker threads
+	FILE_READER_IO_URING,    // batched asynchronous open/read/close, linux only
+} file_reader_backend;
+
+typedef struct t_file_read
+{
+	char *path;
+	void *data; // user pointer passed to file_reader_submit
+	file_content content;
+	s64 reserved; // bytes of the memory budget held by content
+} file_read;
+
+typedef struct t_file_reader
+{
+	file_reader_backend backend;
+	mutex mutex;
+	array pending; // file_read, submitted but not started
+	u32 pending_cursor;
+	file_read completed[FILE_READER_QUEUE_DEPTH]; // ring of buffers ready to be picked up
+	s32 completed_start;
+	s32 completed_count;
+	s32 in_flight;
+	s32 max_file_size; // bytes, 0 = no limit
+	
+	// file content handed out and not released yet is kept below memory_budget
+	s64 memory_budget; // bytes, 0 = no limit
+	s64 memory_used;
+	s64 peak_memory_used;
+	u32 budget_next_ticket; // reads get the budget in the order they asked for it
+	u32 budget_serving_ticket;
+	u32 budget_wait_count; // reads that had to wait for buffers to be released
+	
+	s32 thread_count;
+	thread *threads;
+	void *backend_data;
+	bool done_submitting;
+	bool stop;
+} file_reader;
+
+// file_reader_create picks io_uring when the kernel supports it and falls back
+// to the thread pool otherwise. path passed to file_reader_submit must stay valid
+// until the read is returned by file_reader_next. file_reader_next can be called
+// from any number of threads and returns false once every submitted read has been
+// handed out. content has to be freed with file_reader_release.
+#define file_reader_create(thread_count, max_file_size) file_reader_create_ex(thread_count, max_file_size, FILE_READER_IO_URING)
+file_reader *file_reader_create_ex(s32 thread_count, s32 max_file_size, file_reader_backend preferred_backend);
+// called before the first submit. a file is only read when its content fits in
+// the budget next to the content that was not released yet, a file larger than
+// the budget is read when no other content is in memory. peak memory of file
+// content is max(memory_budget, max_file_size) no matter how many threads read
+// or search.
+void file_reader_set_memory_budget(file_reader *reader, s64 memory_budget);
+void file_reader_submit(file_reader *reader, char *path, void *data);
+void file_reader_finish_submitting(file_reader *reader);
+// reads that were submitted and not started yet, reads are started in submit order
+u32 file_reader_pending_count(file_reader *reader);
+bool file_reader_next(file_reader *reader, file_read *result);
+// frees the content of a read returned by file_reader_next and returns its bytes
+// to the memory budget
+void file_reader_release(file_reader *reader, file_read *read);
+void file_reader_destroy(file_reader *reader);
+
+// the backends reserve the size of a file before its buffer is allocated.
+// file_reader_reserve does not block, reads that take a ticket have to keep
+// trying until they get the budget so later tickets are not stuck behind them.
+u32 file_reader_take_ticket(file_reader *reader);
+bool file_reader_reserve(file_reader *reader, s64 size, u32 ticket);
+// blocks until size fits, returns false when the reader was stopped
+bool file_reader_wait_for_budget(file_reader *reader, s64 size);
+void file_reader_unreserve(file_reader *reader, s64 size);
+
+// implemented per platform, reserved receives the bytes taken from the budget
+file_content file_reader_read_blocking(file_reader *reader, char *path, s64 *reserved);
+bool file_reader_io_uring_start(file_reader *reader);
+void file_reader_io_uring_stop(file_reader *reader);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,162 @@
+/* 
+*  BSD 2-Clause “Simplified” License
+*  Copyright (c) 2019, Aldrik Ramaekers, aldrik.ramaekers@protonmail.com
+*  All rights reserved.
+*/
+
+file_schedule file_schedule_create(file_schedule_order order, bool interleave_sizes, s32 batch_size)
+{
+	file_schedule schedule;
+	schedule.order = order;
+	schedule.interleave_sizes = interleave_sizes;
+	schedule.batch_size = batch_size < 1 ? 1 : batch_size;
+	schedule.batch = array_create(sizeof(file_schedule_entry));
+	schedule.batch.reserve_jump = schedule.batch_size;
+	schedule.lookup_us = 0;
+	
+	return schedule;
+}
+
+void file_schedule_destroy(file_schedule *schedule)
+{
+	array_destroy(&schedule->batch);
+}
+
+char *file_schedule_order_name(file_schedule_order order)
+{
+	switch (order)
+	{
+		case FILE_SCHEDULE_LISTED: return "listed";
+		case FILE_SCHEDULE_INODE: return "inode";
+		case FILE_SCHEDULE_EXTENT: return "extent";
+	}
+	return "listed";
+}
+
+bool file_schedule_order_from_name(char *name, file_schedule_order *order)
+{
+	if (strcmp(name, "listed") == 0) *order = FILE_SCHEDULE_LISTED;
+	else if (strcmp(name, "inode") == 0) *order = FILE_SCHEDULE_INODE;
+	else if (strcmp(name, "extent") == 0) *order = FILE_SCHEDULE_EXTENT;
+	else return false;
+	return true;
+}
+
+static s32 file_schedule_compare(const void *a, const void *b)
+{
+	file_schedule_entry *left = (file_schedule_entry*)a;
+	file_schedule_entry *right = (file_schedule_entry*)b;
+	
+	if (left->key != right->key) return left->key < right->key ? -1 : 1;
+	if (left->inode != right->inode) return left->inode < right->inode ? -1 : 1;
+	return left->index - right->index;
+}
+
+// the sort key of every file in the batch
+static void file_schedule_fill(file_schedule *schedule)
+{
+	bool needs_info = schedule->order != FILE_SCHEDULE_LISTED || schedule->interleave_sizes;
+	if (!needs_info) return;
+	
+	u64 stamp = platform_get_time(TIME_FULL, TIME_US);
+	for (s32 i = 0; i < schedule->batch.length; i++)
+	{
+		file_schedule_entry *entry = array_at(&schedule->batch, i);
+		entry->index = i;
+		entry->key = 0;
+		entry->inode = 0;
+		entry->size = 0;
+		
+		// files that can't be looked up keep their place in front
+		file_info info;
+		if (!platform_get_file_info(entry->path, &info)) continue;
+		entry->size = info.size;
+		
+		if (schedule->order == FILE_SCHEDULE_INODE)
+		{
+			entry->key = info.inode;
+		}
+		else if (schedule->order == FILE_SCHEDULE_EXTENT)
+		{
+			entry->key = platform_get_file_physical_offset(entry->path);
+			entry->inode = info.inode;
+		}
+	}
+	schedule->lookup_us += platform_get_time(TIME_FULL, TIME_US) - stamp;
+	
+	if (schedule->order != FILE_SCHEDULE_LISTED)
+		qsort(schedule->batch.data, schedule->batch.length, sizeof(file_schedule_entry), file_schedule_compare);
+}
+
+// small and large files keep their order, the large ones are spread evenly
+static void file_schedule_interleave(file_schedule *schedule)
+{
+	s32 count = schedule->batch.length;
+	file_schedule_entry *entries = schedule->batch.data;
+	
+	s32 large_count = 0;
+	for (s32 i = 0; i < count; i++)
+	{
+		if (entries[i].size >= FILE_SCHEDULE_LARGE_FILE_SIZE) large_count++;
+	}
+	s32 small_count = count - large_count;
+	if (!large_count || !small_count) return;
+	
+	file_schedule_entry *small = mem_alloc(sizeof(file_schedule_entry)*count);
+	file_schedule_entry *large = small + small_count;
+	s32 small_index = 0;
+	s32 large_index = 0;
+	for (s32 i = 0; i < count; i++)
+	{
+		if (entries[i].size >= FILE_SCHEDULE_LARGE_FILE_SIZE) large[large_index++] = entries[i];
+		else small[small_index++] = entries[i];
+	}
+	
+	small_index = 0;
+	large_index = 0;
+	for (s32 i = 0; i < count; i++)
+	{
+		bool take_large = large_index < large_count &&
+			(small_index == small_count || (s64)large_index*small_count <= (s64)small_index*large_count);
+		
+		if (take_large) entries[i] = large[large_index++];
+		else entries[i] = small[small_index++];
+	}
+	
+	mem_free(small);
+}
+
+void file_schedule_flush(file_schedule *schedule, file_reader *reader)
+{
+	if (!schedule->batch.length) return;
+	
+	file_schedule_fill(schedule);
+	if (schedule->interleave_sizes) file_schedule_interleave(schedule);
+	
+	for (s32 i = 0; i < schedule->batch.length; i++)
+	{
+		file_schedule_entry *entry = array_at(&schedule->batch, i);
+		file_reader_submit(reader, entry->path, entry->data);
+	}
+	schedule->batch.length = 0;
+}
+
+void file_schedule_add(file_schedule *schedule, file_reader *reader, char *path, void *data)
+{
+	// nothing to order
+	if (schedule->order == FILE_SCHEDULE_LISTED && !schedule->interleave_sizes)
+	{
+		file_reader_submit(reader, path, data);
+		return;
+	}
+	
+	file_schedule_entry entry;
+	entry.path = path;
+	entry.data = data;
+	array_push(&schedule->batch, &entry);
+}
+
+bool file_schedule_is_full(file_schedule *schedule)
+{
+	return schedule->batch.length >= schedule->batch_size;
+}
\ No newline at end of file
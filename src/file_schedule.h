@@ -0,0 +1,62 @@
+/* 
+*  BSD 2-Clause “Simplified” License
+*  Copyright (c) 2019, Aldrik Ramaekers, aldrik.ramaekers@protonmail.com
+*  All rights reserved.
+*/
+
+#ifndef INCLUDE_FILE_SCHEDULE
+#define INCLUDE_FILE_SCHEDULE
+
+// files that are ordered together
+#define FILE_SCHEDULE_BATCH_SIZE 1024
+// files of at least this size are spread over the smaller ones with interleave_sizes
+#define FILE_SCHEDULE_LARGE_FILE_SIZE (kilobytes(256))
+
+typedef enum t_file_schedule_order
+{
+	FILE_SCHEDULE_LISTED, // order of the walker, files are submitted right away
+	FILE_SCHEDULE_INODE, // inode number, close to the order on disk on most file systems
+	FILE_SCHEDULE_EXTENT, // position of the first extent on disk, files without one go first
+} file_schedule_order;
+
+typedef struct t_file_schedule_entry
+{
+	char *path;
+	void *data;
+	u64 key;
+	u64 inode;
+	u64 size;
+	s32 index; // position in the batch, keeps the sort stable
+} file_schedule_entry;
+
+// Stage between the walker and the file_reader that collects files in batches
+// and submits every batch in the order that needs the least seeking on spinning
+// disks and network file systems. A new order is a value in
+// file_schedule_order and a branch in file_schedule_fill.
+typedef struct t_file_schedule
+{
+	file_schedule_order order;
+	bool interleave_sizes; // large files are spread evenly so they are read next to small ones
+	s32 batch_size;
+	array batch; // file_schedule_entry
+	u64 lookup_us; // time spent reading inodes, sizes and extents
+} file_schedule;
+
+file_schedule file_schedule_create(file_schedule_order order, bool interleave_sizes, s32 batch_size);
+void file_schedule_destroy(file_schedule *schedule);
+
+// adds a file to the batch, or submits it to reader right away when there is
+// nothing to order. path has to stay valid like for file_reader_submit.
+void file_schedule_add(file_schedule *schedule, file_reader *reader, char *path, void *data);
+bool file_schedule_is_full(file_schedule *schedule);
+
+// orders and submits the files in the batch. called when the batch is full, when
+// the reader has nothing left to read and after the last file. it looks up every
+// file, so it should not be called while the list of the walker is locked.
+void file_schedule_flush(file_schedule *schedule, file_reader *reader);
+
+char *file_schedule_order_name(file_schedule_order order);
+// returns false when name is not listed, inode or extent
+bool file_schedule_order_from_name(char *name, file_schedule_order *order);
+
+#endif
\ No newline at end of file
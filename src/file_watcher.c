@@ -0,0 +1,513 @@
+/* 
+*  BSD 2-Clause “Simplified” License
+*  Copyright (c) 2019, Aldrik Ramaekers, aldrik.ramaekers@protonmail.com
+*  All rights reserved.
+*/
+
+static char *file_watcher_copy_string(char *string)
+{
+	s32 length = strlen(string);
+	char *result = mem_alloc(length + 1);
+	string_copyn(result, string, length + 1);
+	return result;
+}
+
+static void file_watcher_drop_events(file_watcher *watcher, s32 count)
+{
+	file_watcher_queued_event *events = (file_watcher_queued_event*)watcher->events.data;
+	for (s32 i = 0; i < count; i++)
+	{
+		mem_free(events[i].path);
+		if (events[i].old_path) mem_free(events[i].old_path);
+	}
+	memmove(events, events + count, (watcher->events.length - count)*sizeof(file_watcher_queued_event));
+	watcher->events.length -= count;
+	watcher->first_sequence += count;
+	
+	// subscribers that had not seen the dropped events have missed them
+	file_watcher_subscriber *subscribers = (file_watcher_subscriber*)watcher->subscribers.data;
+	for (s32 i = 0; i < watcher->subscribers.length; i++)
+	{
+		if (subscribers[i].active && subscribers[i].cursor < watcher->first_sequence)
+		{
+			subscribers[i].cursor = watcher->first_sequence;
+			subscribers[i].overflowed = true;
+		}
+	}
+}
+
+// drops events every subscriber has received, in batches
+static void file_watcher_prune_events(file_watcher *watcher)
+{
+	u64 end = watcher->first_sequence + watcher->events.length;
+	u64 oldest = end;
+	file_watcher_subscriber *subscribers = (file_watcher_subscriber*)watcher->subscribers.data;
+	for (s32 i = 0; i < watcher->subscribers.length; i++)
+	{
+		if (subscribers[i].active && subscribers[i].cursor < oldest) oldest = subscribers[i].cursor;
+	}
+	
+	s32 count = oldest - watcher->first_sequence;
+	if (count >= 256 || (count && oldest == end))
+		file_watcher_drop_events(watcher, count);
+}
+
+static void file_watcher_push_event(file_watcher *watcher, file_watcher_event_type type, char *path, char *old_path)
+{
+	if (watcher->initial_scan) return;
+	
+	file_watcher_queued_event event;
+	event.type = type;
+	event.path = file_watcher_copy_string(path);
+	event.old_path = old_path ? file_watcher_copy_string(old_path) : 0;
+	
+	mutex_lock(&watcher->mutex);
+	array_push(&watcher->events, &event);
+	if (watcher->events.length > FILE_WATCHER_MAX_EVENTS)
+		file_watcher_drop_events(watcher, watcher->events.length / 2);
+	file_watcher_prune_events(watcher);
+	mutex_unlock(&watcher->mutex);
+}
+
+static u32 file_watcher_hash(char *path)
+{
+	// fnv-1a
+	u32 hash = 2166136261u;
+	for (; *path; path++)
+	{
+		hash ^= (u8)*path;
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+static file_watcher_entry *file_watcher_find(file_watcher *watcher, char *path)
+{
+	u32 mask = (1u << watcher->entry_bits) - 1;
+	for (u32 slot = file_watcher_hash(path) & mask; watcher->entries[slot].path; slot = (slot + 1) & mask)
+	{
+		if (strcmp(watcher->entries[slot].path, path) == 0) return &watcher->entries[slot];
+	}
+	return 0;
+}
+
+static void file_watcher_insert(file_watcher *watcher, file_watcher_entry *entry)
+{
+	u32 mask = (1u << watcher->entry_bits) - 1;
+	u32 slot = file_watcher_hash(entry->path) & mask;
+	while (watcher->entries[slot].path) slot = (slot + 1) & mask;
+	watcher->entries[slot] = *entry;
+	watcher->entry_count++;
+}
+
+static void file_watcher_add(file_watcher *watcher, char *path, u64 size, u64 mtime)
+{
+	// table is kept at most half full
+	if ((watcher->entry_count + 1) * 2 > (1 << watcher->entry_bits))
+	{
+		file_watcher_entry *old_entries = watcher->entries;
+		s32 old_size = 1 << watcher->entry_bits;
+		
+		watcher->entry_bits++;
+		watcher->entries = mem_alloc(sizeof(file_watcher_entry) << watcher->entry_bits);
+		memset(watcher->entries, 0, sizeof(file_watcher_entry) << watcher->entry_bits);
+		watcher->entry_count = 0;
+		for (s32 i = 0; i < old_size; i++)
+		{
+			if (old_entries[i].path) file_watcher_insert(watcher, &old_entries[i]);
+		}
+		mem_free(old_entries);
+	}
+	
+	file_watcher_entry entry;
+	entry.path = file_watcher_copy_string(path);
+	entry.size = size;
+	entry.mtime = mtime;
+	entry.generation = watcher->generation;
+	file_watcher_insert(watcher, &entry);
+}
+
+static void file_watcher_remove(file_watcher *watcher, file_watcher_entry *entry)
+{
+	u32 mask = (1u << watcher->entry_bits) - 1;
+	u32 slot = entry - watcher->entries;
+	mem_free(entry->path);
+	entry->path = 0;
+	watcher->entry_count--;
+	
+	// move later entries of the same probe sequence back into the hole
+	for (u32 next = (slot + 1) & mask; watcher->entries[next].path; next = (next + 1) & mask)
+	{
+		u32 home = file_watcher_hash(watcher->entries[next].path) & mask;
+		if (((next - home) & mask) >= ((next - slot) & mask))
+		{
+			watcher->entries[slot] = watcher->entries[next];
+			watcher->entries[next].path = 0;
+			slot = next;
+		}
+	}
+}
+
+// paths of all files below directory, directory ends with a separator
+static array file_watcher_find_below(file_watcher *watcher, char *directory)
+{
+	array result = array_create(sizeof(char*));
+	s32 length = strlen(directory);
+	for (s32 i = 0; i < (1 << watcher->entry_bits); i++)
+	{
+		char *path = watcher->entries[i].path;
+		if (path && strncmp(path, directory, length) == 0) array_push(&result, &path);
+	}
+	return result;
+}
+
+void file_watcher_file_found(file_watcher *watcher, char *path, u64 size, u64 mtime)
+{
+	file_watcher_entry *entry = file_watcher_find(watcher, path);
+	if (!entry)
+	{
+		file_watcher_add(watcher, path, size, mtime);
+		file_watcher_push_event(watcher, FILE_WATCHER_CREATED, path, 0);
+		return;
+	}
+	
+	entry->generation = watcher->generation;
+	if (entry->size != size || entry->mtime != mtime)
+	{
+		entry->size = size;
+		entry->mtime = mtime;
+		file_watcher_push_event(watcher, FILE_WATCHER_MODIFIED, path, 0);
+	}
+}
+
+void file_watcher_path_changed(file_watcher *watcher, char *path)
+{
+	bool is_directory;
+	u64 size, mtime;
+	if (!file_watcher_stat(path, &is_directory, &size, &mtime))
+	{
+		file_watcher_path_removed(watcher, path);
+		return;
+	}
+	
+	if (!is_directory)
+	{
+		file_watcher_file_found(watcher, path, size, mtime);
+		return;
+	}
+	
+	// files can be created before the directory is watched
+	char directory[MAX_INPUT_LENGTH];
+	snprintf(directory, MAX_INPUT_LENGTH, "%s%c", path, file_watcher_separator());
+	file_watcher_scan(watcher, directory);
+}
+
+void file_watcher_path_removed(file_watcher *watcher, char *path)
+{
+	file_watcher_entry *entry = file_watcher_find(watcher, path);
+	if (entry)
+	{
+		file_watcher_remove(watcher, entry);
+		file_watcher_push_event(watcher, FILE_WATCHER_DELETED, path, 0);
+		return;
+	}
+	
+	// a directory, everything below it is gone
+	char directory[MAX_INPUT_LENGTH];
+	snprintf(directory, MAX_INPUT_LENGTH, "%s%c", path, file_watcher_separator());
+	array below = file_watcher_find_below(watcher, directory);
+	for (s32 i = 0; i < below.length; i++)
+	{
+		char *removed = file_watcher_copy_string(((char**)below.data)[i]);
+		file_watcher_remove(watcher, file_watcher_find(watcher, removed));
+		file_watcher_push_event(watcher, FILE_WATCHER_DELETED, removed, 0);
+		mem_free(removed);
+	}
+	array_destroy(&below);
+}
+
+void file_watcher_path_renamed(file_watcher *watcher, char *old_path, char *new_path)
+{
+	file_watcher_entry *entry = file_watcher_find(watcher, old_path);
+	if (entry)
+	{
+		u64 size = entry->size;
+		u64 mtime = entry->mtime;
+		file_watcher_remove(watcher, entry);
+		
+		// a file that is replaced by the rename is not reported separately
+		file_watcher_entry *replaced = file_watcher_find(watcher, new_path);
+		if (replaced) file_watcher_remove(watcher, replaced);
+		
+		file_watcher_add(watcher, new_path, size, mtime);
+		file_watcher_push_event(watcher, FILE_WATCHER_RENAMED, new_path, old_path);
+		return;
+	}
+	
+	char old_directory[MAX_INPUT_LENGTH];
+	char new_directory[MAX_INPUT_LENGTH];
+	snprintf(old_directory, MAX_INPUT_LENGTH, "%s%c", old_path, file_watcher_separator());
+	snprintf(new_directory, MAX_INPUT_LENGTH, "%s%c", new_path, file_watcher_separator());
+	s32 old_length = strlen(old_directory);
+	
+	array below = file_watcher_find_below(watcher, old_directory);
+	for (s32 i = 0; i < below.length; i++)
+	{
+		char *moved = file_watcher_copy_string(((char**)below.data)[i]);
+		entry = file_watcher_find(watcher, moved);
+		u64 size = entry->size;
+		u64 mtime = entry->mtime;
+		file_watcher_remove(watcher, entry);
+		
+		char path[MAX_INPUT_LENGTH];
+		snprintf(path, MAX_INPUT_LENGTH, "%s%s", new_directory, moved + old_length);
+		file_watcher_add(watcher, path, size, mtime);
+		file_watcher_push_event(watcher, FILE_WATCHER_RENAMED, path, moved);
+		mem_free(moved);
+	}
+	array_destroy(&below);
+	
+	// picks up a directory that was moved in from outside the tree and changes
+	// made before it was watched
+	file_watcher_path_changed(watcher, new_path);
+}
+
+static void file_watcher_rescan(file_watcher *watcher)
+{
+	watcher->generation++;
+	file_watcher_scan(watcher, watcher->directory);
+	
+	array removed = array_create(sizeof(char*));
+	for (s32 i = 0; i < (1 << watcher->entry_bits); i++)
+	{
+		file_watcher_entry *entry = &watcher->entries[i];
+		if (entry->path && entry->generation != watcher->generation)
+		{
+			char *path = file_watcher_copy_string(entry->path);
+			array_push(&removed, &path);
+		}
+	}
+	for (s32 i = 0; i < removed.length; i++)
+	{
+		char *path = ((char**)removed.data)[i];
+		file_watcher_path_removed(watcher, path);
+		mem_free(path);
+	}
+	array_destroy(&removed);
+}
+
+static void *file_watcher_thread(void *args)
+{
+	file_watcher *watcher = args;
+	
+	// watches are added while the first snapshot is taken, changes made during
+	// the scan are reported by the backend or the next rescan
+	watcher->initial_scan = true;
+	file_watcher_scan(watcher, watcher->directory);
+	watcher->initial_scan = false;
+	
+	u64 last_scan = platform_get_time(TIME_FULL, TIME_MILI_S);
+	while (!watcher->stop)
+	{
+		if (watcher->mode == FILE_WATCHER_NATIVE)
+		{
+			// events were lost, the snapshot finds what changed
+			if (!file_watcher_backend_wait(watcher))
+				file_watcher_rescan(watcher);
+			continue;
+		}
+		
+		thread_sleep(FILE_WATCHER_POLL_MS*1000);
+		if (platform_get_time(TIME_FULL, TIME_MILI_S) - last_scan >= FILE_WATCHER_RESCAN_INTERVAL_MS)
+		{
+			file_watcher_rescan(watcher);
+			last_scan = platform_get_time(TIME_FULL, TIME_MILI_S);
+		}
+	}
+	
+	return 0;
+}
+
+file_watcher *file_watcher_start(char *directory)
+{
+	file_watcher *watcher = mem_alloc(sizeof(file_watcher));
+	watcher->directory = file_watcher_copy_string(directory);
+	watcher->stop = false;
+	watcher->entry_bits = 10;
+	watcher->entries = mem_alloc(sizeof(file_watcher_entry) << watcher->entry_bits);
+	memset(watcher->entries, 0, sizeof(file_watcher_entry) << watcher->entry_bits);
+	watcher->entry_count = 0;
+	watcher->generation = 0;
+	watcher->backend_data = 0;
+	watcher->mutex = mutex_create();
+	watcher->events = array_create(sizeof(file_watcher_queued_event));
+	watcher->events.reserve_jump = 256;
+	watcher->first_sequence = 0;
+	watcher->subscribers = array_create(sizeof(file_watcher_subscriber));
+	
+	watcher->mode = file_watcher_backend_start(watcher) ? FILE_WATCHER_NATIVE : FILE_WATCHER_RESCAN;
+	watcher->initial_scan = true;
+	
+	watcher->thread = thread_start(file_watcher_thread, watcher);
+	
+	return watcher;
+}
+
+void file_watcher_stop(file_watcher *watcher)
+{
+	watcher->stop = true;
+	thread_join(&watcher->thread);
+	if (watcher->mode == FILE_WATCHER_NATIVE) file_watcher_backend_stop(watcher);
+	
+	for (s32 i = 0; i < (1 << watcher->entry_bits); i++)
+	{
+		if (watcher->entries[i].path) mem_free(watcher->entries[i].path);
+	}
+	mem_free(watcher->entries);
+	
+	file_watcher_drop_events(watcher, watcher->events.length);
+	array_destroy(&watcher->events);
+	array_destroy(&watcher->subscribers);
+	mutex_destroy(&watcher->mutex);
+	mem_free(watcher->directory);
+	mem_free(watcher);
+}
+
+s32 file_watcher_subscribe(file_watcher *watcher)
+{
+	file_watcher_subscriber subscriber;
+	subscriber.active = true;
+	subscriber.overflowed = false;
+	
+	mutex_lock(&watcher->mutex);
+	subscriber.cursor = watcher->first_sequence + watcher->events.length;
+	
+	s32 result = -1;
+	file_watcher_subscriber *subscribers = (file_watcher_subscriber*)watcher->subscribers.data;
+	for (s32 i = 0; i < watcher->subscribers.length && result == -1; i++)
+	{
+		if (!subscribers[i].active) result = i;
+	}
+	
+	if (result == -1)
+	{
+		result = watcher->subscribers.length;
+		array_push(&watcher->subscribers, &subscriber);
+	}
+	else
+	{
+		subscribers[result] = subscriber;
+	}
+	mutex_unlock(&watcher->mutex);
+	
+	return result;
+}
+
+void file_watcher_unsubscribe(file_watcher *watcher, s32 subscriber)
+{
+	mutex_lock(&watcher->mutex);
+	((file_watcher_subscriber*)watcher->subscribers.data)[subscriber].active = false;
+	file_watcher_prune_events(watcher);
+	mutex_unlock(&watcher->mutex);
+}
+
+bool file_watcher_next_event(file_watcher *watcher, s32 subscriber, file_watcher_event *event)
+{
+	bool found = false;
+	
+	mutex_lock(&watcher->mutex);
+	file_watcher_subscriber *state = &((file_watcher_subscriber*)watcher->subscribers.data)[subscriber];
+	if (state->overflowed)
+	{
+		state->overflowed = false;
+		event->type = FILE_WATCHER_OVERFLOW;
+		event->path[0] = 0;
+		event->old_path[0] = 0;
+		found = true;
+	}
+	else if (state->cursor < watcher->first_sequence + watcher->events.length)
+	{
+		file_watcher_queued_event *queued = &((file_watcher_queued_event*)watcher->events.data)[state->cursor - watcher->first_sequence];
+		event->type = queued->type;
+		string_copyn(event->path, queued->path, MAX_INPUT_LENGTH);
+		string_copyn(event->old_path, queued->old_path ? queued->old_path : "", MAX_INPUT_LENGTH);
+		state->cursor++;
+		found = true;
+		
+		file_watcher_prune_events(watcher);
+	}
+	mutex_unlock(&watcher->mutex);
+	
+	return found;
+}
+
+static void file_watcher_remove_from_list(array *list, char *path, memory_bucket *bucket)
+{
+	mutex_lock(&list->mutex);
+	found_file *files = (found_file*)list->data;
+	for (s32 i = 0; i < list->length; i++)
+	{
+		if (strcmp(files[i].path, path) != 0) continue;
+		
+		if (!bucket)
+		{
+			mem_free(files[i].path);
+			mem_free(files[i].matched_filter);
+		}
+		memmove(files + i, files + i + 1, (list->length - i - 1)*sizeof(found_file));
+		list->length--;
+		break;
+	}
+	mutex_unlock(&list->mutex);
+}
+
+static void file_watcher_add_to_list(array *list, char *path, file_filter *filter, memory_bucket *bucket)
+{
+	char *name = path;
+	for (char *ch = path; *ch; ch++)
+	{
+		if (*ch == file_watcher_separator()) name = ch + 1;
+	}
+	
+	char *matched_filter = 0;
+	s32 len = file_filter_matches(filter, name, &matched_filter);
+	if (!len || len == -1) return;
+	
+	found_file f;
+	f.path = create_found_file_path(bucket, path, "");
+	if (bucket)
+		f.matched_filter = memory_bucket_reserve(bucket, len+1);
+	else
+		f.matched_filter = mem_alloc(len+1);
+	string_copyn(f.matched_filter, matched_filter, len+1);
+	
+	mutex_lock(&list->mutex);
+	array_push_size(list, &f, sizeof(found_file));
+	mutex_unlock(&list->mutex);
+}
+
+bool file_watcher_apply_to_list(array *list, file_watcher_event *event, file_filter *filter, memory_bucket *bucket)
+{
+	switch(event->type)
+	{
+		case FILE_WATCHER_OVERFLOW: return false;
+		case FILE_WATCHER_MODIFIED: break;
+		case FILE_WATCHER_CREATED:
+		{
+			file_watcher_remove_from_list(list, event->path, bucket);
+			file_watcher_add_to_list(list, event->path, filter, bucket);
+		} break;
+		case FILE_WATCHER_DELETED:
+		{
+			file_watcher_remove_from_list(list, event->path, bucket);
+		} break;
+		case FILE_WATCHER_RENAMED:
+		{
+			file_watcher_remove_from_list(list, event->old_path, bucket);
+			file_watcher_remove_from_list(list, event->path, bucket);
+			file_watcher_add_to_list(list, event->path, filter, bucket);
+		} break;
+	}
+	
+	return true;
+}
\ No newline at end of file
@@ -0,0 +1,113 @@
+/* 
+*  BSD 2-Clause “Simplified” License
+*  Copyright (c) 2019, Aldrik Ramaekers, aldrik.ramaekers@protonmail.com
+*  All rights reserved.
+*/
+
+#ifndef INCLUDE_FILE_WATCHER
+#define INCLUDE_FILE_WATCHER
+
+// directory trees are rescanned at this interval when native change
+// notifications are not available
+#define FILE_WATCHER_RESCAN_INTERVAL_MS 2000
+// native notifications are waited on for at most this long so stop is noticed
+#define FILE_WATCHER_POLL_MS 100
+// events waiting for the slowest subscriber, older events are dropped and the
+// subscriber receives FILE_WATCHER_OVERFLOW
+#define FILE_WATCHER_MAX_EVENTS 65536
+
+typedef enum t_file_watcher_mode
+{
+	FILE_WATCHER_NATIVE, // inotify on linux
+	FILE_WATCHER_RESCAN, // periodic size and mtime comparison
+} file_watcher_mode;
+
+typedef enum t_file_watcher_event_type
+{
+	FILE_WATCHER_CREATED,
+	FILE_WATCHER_MODIFIED,
+	FILE_WATCHER_DELETED,
+	FILE_WATCHER_RENAMED, // old_path is set
+	FILE_WATCHER_OVERFLOW, // events were lost, listings and indexes have to be rebuilt
+} file_watcher_event_type;
+
+typedef struct t_file_watcher_event
+{
+	file_watcher_event_type type;
+	char path[MAX_INPUT_LENGTH];
+	char old_path[MAX_INPUT_LENGTH];
+} file_watcher_event;
+
+typedef struct t_file_watcher_queued_event
+{
+	file_watcher_event_type type;
+	char *path;
+	char *old_path;
+} file_watcher_queued_event;
+
+// last known state of a file, the snapshot turns native notifications and
+// rescans into events
+typedef struct t_file_watcher_entry
+{
+	char *path; // 0 when the slot is empty
+	u64 size;
+	u64 mtime;
+	u32 generation; // rescan that last saw the file
+} file_watcher_entry;
+
+typedef struct t_file_watcher_subscriber
+{
+	bool active;
+	bool overflowed;
+	u64 cursor; // sequence number of the next event
+} file_watcher_subscriber;
+
+typedef struct t_file_watcher
+{
+	char *directory; // ends with a path separator, like platform_list_files
+	file_watcher_mode mode;
+	thread thread;
+	bool stop;
+	
+	// owned by the watcher thread
+	file_watcher_entry *entries; // open addressing table
+	s32 entry_bits;
+	s32 entry_count;
+	u32 generation;
+	bool initial_scan; // no events while the first snapshot is taken
+	void *backend_data;
+	
+	mutex mutex;
+	array events; // file_watcher_queued_event
+	u64 first_sequence; // sequence number of the first event in events
+	array subscribers; // file_watcher_subscriber
+} file_watcher;
+
+// file_watcher_start watches directory and everything below it on a background
+// thread, only files are reported. a subscriber receives every event that
+// happened after it subscribed, paths are built like platform_list_files does.
+file_watcher *file_watcher_start(char *directory);
+void file_watcher_stop(file_watcher *watcher);
+s32 file_watcher_subscribe(file_watcher *watcher);
+void file_watcher_unsubscribe(file_watcher *watcher, s32 subscriber);
+bool file_watcher_next_event(file_watcher *watcher, s32 subscriber, file_watcher_event *event);
+
+// keeps a list filled by platform_list_files_block up to date without walking the
+// directory again, returns false on FILE_WATCHER_OVERFLOW.
+bool file_watcher_apply_to_list(array *list, file_watcher_event *event, file_filter *filter, memory_bucket *bucket);
+
+// called by the backends
+void file_watcher_file_found(file_watcher *watcher, char *path, u64 size, u64 mtime);
+void file_watcher_path_changed(file_watcher *watcher, char *path);
+void file_watcher_path_removed(file_watcher *watcher, char *path);
+void file_watcher_path_renamed(file_watcher *watcher, char *old_path, char *new_path);
+
+// implemented per platform
+bool file_watcher_backend_start(file_watcher *watcher);
+void file_watcher_backend_stop(file_watcher *watcher);
+bool file_watcher_backend_wait(file_watcher *watcher);
+void file_watcher_scan(file_watcher *watcher, char *directory);
+bool file_watcher_stat(char *path, bool *is_directory, u64 *size, u64 *mtime);
+char file_watcher_separator();
+
+#endif
\ No newline at end of file
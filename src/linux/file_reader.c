@@ -0,0 +1,544 @@
+/* 
+*  BSD 2-Clause “Simplified” License
+*  Copyright (c) 2019, Aldrik Ramaekers, aldrik.ramaekers@protonmail.com
+*  All rights reserved.
+*/
+
+#include <fcntl.h>
+
+// IORING_FEAT_CUR_PERSONALITY was added together with the openat/read/close opcodes (5.6)
+#if defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#if defined(IORING_FEAT_CUR_PERSONALITY) && defined(__NR_io_uring_setup)
+#define FILE_READER_HAS_IO_URING
+#endif
+#endif
+#endif
+
+file_content file_reader_read_blocking(file_reader *reader, char *path, s64 *reserved)
+{
+	file_content result;
+	result.content = 0;
+	result.content_length = 0;
+	result.file_error = 0;
+	*reserved = 0;
+	
+	s32 fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (fd == -1)
+	{
+		result.file_error = translate_file_error(errno);
+		return result;
+	}
+	
+	struct stat info;
+	if (fstat(fd, &info) == -1)
+	{
+		result.file_error = translate_file_error(errno);
+		goto done;
+	}
+	
+	s64 size = info.st_size;
+	if (reader->max_file_size && size > reader->max_file_size)
+	{
+		result.file_error = FILE_ERROR_TOO_BIG;
+		goto done;
+	}
+	
+	if (!file_reader_wait_for_budget(reader, size+1))
+	{
+		result.file_error = FILE_ERROR_GENERIC;
+		goto done;
+	}
+	*reserved = size+1;
+	
+	result.content = mem_alloc(size+1);
+	if (!result.content)
+	{
+		file_reader_unreserve(reader, *reserved);
+		*reserved = 0;
+		goto done;
+	}
+	
+	s64 offset = 0;
+	while (offset < size)
+	{
+		ssize_t read_result = pread(fd, result.content+offset, size-offset, offset);
+		if (read_result == -1 && errno == EINTR) continue;
+		if (read_result == -1)
+		{
+			result.file_error = translate_file_error(errno);
+			mem_free(result.content);
+			result.content = 0;
+			file_reader_unreserve(reader, *reserved);
+			*reserved = 0;
+			goto done;
+		}
+		if (read_result == 0) break;
+		
+		offset += read_result;
+	}
+	
+	result.content_length = offset;
+	((char*)result.content)[offset] = 0;
+	
+	done:
+	close(fd);
+	return result;
+}
+
+#ifdef FILE_READER_HAS_IO_URING
+
+#define IO_URING_ENTRIES (FILE_READER_QUEUE_DEPTH*2)
+#define IO_URING_CLOSE_TAG 0xFFFFFFFFFFFFFFFF
+
+typedef struct t_io_uring_slot
+{
+	file_read read;
+	s32 fd;
+	s64 size;
+	s64 offset;
+	bool is_reading;
+	u32 ticket; // for the memory budget
+} io_uring_slot;
+
+typedef struct t_io_uring_state
+{
+	s32 ring_fd;
+	void *sq_ring;
+	void *cq_ring;
+	u64 sq_ring_size;
+	u64 cq_ring_size;
+	u32 *sq_head;
+	u32 *sq_tail;
+	u32 *sq_mask;
+	u32 *sq_array;
+	u32 *cq_head;
+	u32 *cq_tail;
+	u32 *cq_mask;
+	struct io_uring_sqe *sqes;
+	u64 sqes_size;
+	struct io_uring_cqe *cqes;
+	u32 queued; // sqes written after the published tail
+	u32 to_submit; // published sqes the kernel did not take yet
+	bool failed; // io_uring_enter failed, nothing is submitted after this
+	s32 in_ring; // submitted operations without a completion
+	s32 free_slot_count;
+	s32 free_slots[FILE_READER_QUEUE_DEPTH];
+	s32 budget_queue_start; // opened files waiting for the memory budget, oldest first
+	s32 budget_queue_count;
+	s32 budget_queue[FILE_READER_QUEUE_DEPTH];
+	io_uring_slot slots[FILE_READER_QUEUE_DEPTH];
+} io_uring_state;
+
+static bool io_uring_supports_file_ops(s32 ring_fd)
+{
+	u64 probe_size = sizeof(struct io_uring_probe) + 256*sizeof(struct io_uring_probe_op);
+	struct io_uring_probe *probe = mem_alloc(probe_size);
+	memset(probe, 0, probe_size);
+	
+	bool result = false;
+	if (syscall(__NR_io_uring_register, ring_fd, IORING_REGISTER_PROBE, probe, 256) == 0)
+	{
+		u8 ops[] = { IORING_OP_OPENAT, IORING_OP_READ, IORING_OP_CLOSE };
+		result = true;
+		for (s32 i = 0; i < sizeof(ops); i++)
+		{
+			if (ops[i] >= probe->ops_len || !(probe->ops[ops[i]].flags & IO_URING_OP_SUPPORTED))
+				result = false;
+		}
+	}
+	
+	mem_free(probe);
+	return result;
+}
+
+static struct io_uring_sqe *io_uring_get_sqe(io_uring_state *ring, u64 user_data)
+{
+	u32 tail = *ring->sq_tail + ring->queued;
+	u32 index = tail & *ring->sq_mask;
+	
+	struct io_uring_sqe *sqe = &ring->sqes[index];
+	memset(sqe, 0, sizeof(struct io_uring_sqe));
+	sqe->user_data = user_data;
+	
+	ring->sq_array[index] = index;
+	ring->queued++;
+	ring->in_ring++;
+	
+	return sqe;
+}
+
+static void io_uring_prep_read(io_uring_state *ring, s32 slot_index)
+{
+	io_uring_slot *slot = &ring->slots[slot_index];
+	
+	struct io_uring_sqe *sqe = io_uring_get_sqe(ring, slot_index);
+	sqe->opcode = IORING_OP_READ;
+	sqe->fd = slot->fd;
+	sqe->addr = (u64)(slot->read.content.content+slot->offset);
+	sqe->len = slot->size - slot->offset;
+	sqe->off = slot->offset;
+	slot->is_reading = true;
+}
+
+static void io_uring_finish_slot(file_reader *reader, io_uring_state *ring, s32 slot_index)
+{
+	io_uring_slot *slot = &ring->slots[slot_index];
+	
+	if (slot->fd != -1)
+	{
+		// close asynchronously when there is room in the ring, nobody waits for it
+		if (ring->in_ring < IO_URING_ENTRIES && !ring->failed)
+		{
+			struct io_uring_sqe *sqe = io_uring_get_sqe(ring, IO_URING_CLOSE_TAG);
+			sqe->opcode = IORING_OP_CLOSE;
+			sqe->fd = slot->fd;
+		}
+		else
+		{
+			close(slot->fd);
+		}
+	}
+	
+	if (slot->read.content.content)
+	{
+		slot->read.content.content_length = slot->offset;
+		((char*)slot->read.content.content)[slot->offset] = 0;
+	}
+	
+	file_reader_push_completed(reader, &slot->read);
+	ring->free_slots[ring->free_slot_count++] = slot_index;
+}
+
+static void io_uring_fail_slot(file_reader *reader, io_uring_state *ring, s32 slot_index, s16 file_error)
+{
+	io_uring_slot *slot = &ring->slots[slot_index];
+	
+	if (slot->read.content.content)
+	{
+		mem_free(slot->read.content.content);
+		slot->read.content.content = 0;
+	}
+	if (slot->read.reserved)
+	{
+		file_reader_unreserve(reader, slot->read.reserved);
+		slot->read.reserved = 0;
+	}
+	slot->read.content.file_error = file_error;
+	
+	io_uring_finish_slot(reader, ring, slot_index);
+}
+
+// called once the size of the file is reserved in the memory budget
+static void io_uring_start_read(file_reader *reader, io_uring_state *ring, s32 slot_index)
+{
+	io_uring_slot *slot = &ring->slots[slot_index];
+	slot->read.reserved = slot->size+1;
+	slot->read.content.content = mem_alloc(slot->size+1);
+	if (!slot->read.content.content)
+	{
+		file_reader_unreserve(reader, slot->read.reserved);
+		slot->read.reserved = 0;
+	}
+	
+	if (!slot->read.content.content || slot->size == 0)
+	{
+		io_uring_finish_slot(reader, ring, slot_index);
+		return;
+	}
+	
+	io_uring_prep_read(ring, slot_index);
+}
+
+static void io_uring_handle_completion(file_reader *reader, io_uring_state *ring, struct io_uring_cqe *cqe)
+{
+	ring->in_ring--;
+	if (cqe->user_data == IO_URING_CLOSE_TAG) return;
+	
+	s32 slot_index = cqe->user_data;
+	io_uring_slot *slot = &ring->slots[slot_index];
+	
+	if (!slot->is_reading)
+	{
+		if (cqe->res < 0)
+		{
+			io_uring_fail_slot(reader, ring, slot_index, translate_file_error(-cqe->res));
+			return;
+		}
+		
+		slot->fd = cqe->res;
+		
+		struct stat info;
+		if (fstat(slot->fd, &info) == -1)
+		{
+			io_uring_fail_slot(reader, ring, slot_index, translate_file_error(errno));
+			return;
+		}
+		
+		slot->size = info.st_size;
+		if (reader->max_file_size && slot->size > reader->max_file_size)
+		{
+			io_uring_fail_slot(reader, ring, slot_index, FILE_ERROR_TOO_BIG);
+			return;
+		}
+		
+		// the ring can't wait, the file is read when the budget has room
+		slot->ticket = file_reader_take_ticket(reader);
+		if (!file_reader_reserve(reader, slot->size+1, slot->ticket))
+		{
+			__atomic_fetch_add(&reader->budget_wait_count, 1, __ATOMIC_RELAXED);
+			s32 index = (ring->budget_queue_start + ring->budget_queue_count) % FILE_READER_QUEUE_DEPTH;
+			ring->budget_queue[index] = slot_index;
+			ring->budget_queue_count++;
+			return;
+		}
+		
+		io_uring_start_read(reader, ring, slot_index);
+		return;
+	}
+	
+	if (cqe->res == -EINTR || cqe->res == -EAGAIN)
+	{
+		io_uring_prep_read(ring, slot_index);
+		return;
+	}
+	
+	if (cqe->res < 0)
+	{
+		io_uring_fail_slot(reader, ring, slot_index, translate_file_error(-cqe->res));
+		return;
+	}
+	
+	slot->offset += cqe->res;
+	
+	// file shrunk while reading or we got a short read
+	if (cqe->res > 0 && slot->offset < slot->size)
+	{
+		io_uring_prep_read(ring, slot_index);
+		return;
+	}
+	
+	io_uring_finish_slot(reader, ring, slot_index);
+}
+
+// the sqes the kernel did not take are undone, their files fail. the operations
+// it did take are still running and have to be reaped.
+static void io_uring_drop_unsubmitted(file_reader *reader, io_uring_state *ring)
+{
+	u32 head = __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE);
+	for (u32 i = head; i != *ring->sq_tail + ring->queued; i++)
+	{
+		struct io_uring_sqe sqe = ring->sqes[ring->sq_array[i & *ring->sq_mask]];
+		ring->in_ring--;
+		
+		if (sqe.user_data == IO_URING_CLOSE_TAG) close(sqe.fd);
+		else io_uring_fail_slot(reader, ring, sqe.user_data, FILE_ERROR_GENERIC);
+	}
+	
+	__atomic_store_n(ring->sq_tail, head, __ATOMIC_RELEASE);
+	ring->queued = 0;
+	ring->to_submit = 0;
+}
+
+static void *file_reader_io_uring_worker(void *args)
+{
+	file_reader *reader = args;
+	io_uring_state *ring = reader->backend_data;
+	
+	// when the reader is stopped we keep reaping until nothing is in flight
+	// so the kernel is never left writing into freed buffers.
+	while (1)
+	{
+		// files that waited for the memory budget are read in the order they were opened
+		while (ring->budget_queue_count)
+		{
+			s32 slot_index = ring->budget_queue[ring->budget_queue_start];
+			io_uring_slot *slot = &ring->slots[slot_index];
+			bool fail = reader->stop || ring->failed;
+			if (!fail && !file_reader_reserve(reader, slot->size+1, slot->ticket)) break;
+			
+			ring->budget_queue_start = (ring->budget_queue_start + 1) % FILE_READER_QUEUE_DEPTH;
+			ring->budget_queue_count--;
+			if (fail) io_uring_fail_slot(reader, ring, slot_index, FILE_ERROR_GENERIC);
+			else io_uring_start_read(reader, ring, slot_index);
+		}
+		
+		// keep the ring filled with new open requests
+		file_read read;
+		while (!reader->stop && ring->free_slot_count && ring->in_ring < IO_URING_ENTRIES &&
+			   file_reader_take_pending(reader, &read))
+		{
+			s32 slot_index = ring->free_slots[--ring->free_slot_count];
+			io_uring_slot *slot = &ring->slots[slot_index];
+			slot->read = read;
+			slot->fd = -1;
+			slot->size = 0;
+			slot->offset = 0;
+			slot->is_reading = false;
+			
+			// without a working ring every file gets an error so nobody waits for it
+			if (ring->failed)
+			{
+				io_uring_fail_slot(reader, ring, slot_index, FILE_ERROR_GENERIC);
+				continue;
+			}
+			
+			struct io_uring_sqe *sqe = io_uring_get_sqe(ring, slot_index);
+			sqe->opcode = IORING_OP_OPENAT;
+			sqe->fd = AT_FDCWD;
+			sqe->addr = (u64)read.path;
+			sqe->open_flags = O_RDONLY | O_CLOEXEC;
+		}
+		
+		if (ring->in_ring == 0)
+		{
+			if (reader->stop || (!ring->budget_queue_count && file_reader_is_drained(reader))) break;
+			
+			thread_sleep(FILE_READER_IDLE_US);
+			continue;
+		}
+		
+		if (ring->failed)
+		{
+			// completions of what the kernel already took are polled for
+			io_uring_drop_unsubmitted(reader, ring);
+			thread_sleep(FILE_READER_IDLE_US);
+		}
+		else
+		{
+			// only the new sqes are published, sqes the kernel left over stay published
+			__atomic_store_n(ring->sq_tail, *ring->sq_tail + ring->queued, __ATOMIC_RELEASE);
+			ring->to_submit += ring->queued;
+			ring->queued = 0;
+			
+			s32 result = syscall(__NR_io_uring_enter, ring->ring_fd, ring->to_submit, 1, IORING_ENTER_GETEVENTS, 0, 0);
+			if (result >= 0)
+				ring->to_submit -= result;
+			else if (errno != EINTR && errno != EBUSY && errno != EAGAIN)
+			{
+				// reads in the kernel still write into their buffers, they are waited for
+				ring->failed = true;
+				io_uring_drop_unsubmitted(reader, ring);
+			}
+		}
+		
+		u32 head = *ring->cq_head;
+		u32 tail = __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE);
+		while (head != tail)
+		{
+			struct io_uring_cqe cqe = ring->cqes[head & *ring->cq_mask];
+			head++;
+			__atomic_store_n(ring->cq_head, head, __ATOMIC_RELEASE);
+			
+			io_uring_handle_completion(reader, ring, &cqe);
+		}
+	}
+	
+	return 0;
+}
+
+bool file_reader_io_uring_start(file_reader *reader)
+{
+	struct io_uring_params params;
+	memset(&params, 0, sizeof(params));
+	
+	s32 ring_fd = syscall(__NR_io_uring_setup, IO_URING_ENTRIES, &params);
+	if (ring_fd < 0) return false;
+	
+	if (!io_uring_supports_file_ops(ring_fd) || params.sq_entries < IO_URING_ENTRIES)
+	{
+		close(ring_fd);
+		return false;
+	}
+	
+	io_uring_state *ring = mem_alloc(sizeof(io_uring_state));
+	memset(ring, 0, sizeof(io_uring_state));
+	ring->ring_fd = ring_fd;
+	
+	ring->sq_ring_size = params.sq_off.array + params.sq_entries*sizeof(u32);
+	ring->cq_ring_size = params.cq_off.cqes + params.cq_entries*sizeof(struct io_uring_cqe);
+	if (params.features & IORING_FEAT_SINGLE_MMAP)
+	{
+		if (ring->cq_ring_size > ring->sq_ring_size) ring->sq_ring_size = ring->cq_ring_size;
+		ring->cq_ring_size = ring->sq_ring_size;
+	}
+	
+	ring->sq_ring = mmap(0, ring->sq_ring_size, PROT_READ | PROT_WRITE,
+						 MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQ_RING);
+	if (params.features & IORING_FEAT_SINGLE_MMAP)
+		ring->cq_ring = ring->sq_ring;
+	else
+		ring->cq_ring = mmap(0, ring->cq_ring_size, PROT_READ | PROT_WRITE,
+							 MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_CQ_RING);
+	
+	ring->sqes_size = params.sq_entries*sizeof(struct io_uring_sqe);
+	ring->sqes = mmap(0, ring->sqes_size, PROT_READ | PROT_WRITE,
+					  MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQES);
+	
+	if (ring->sq_ring == MAP_FAILED || ring->cq_ring == MAP_FAILED || ring->sqes == MAP_FAILED)
+	{
+		if (ring->sq_ring != MAP_FAILED) munmap(ring->sq_ring, ring->sq_ring_size);
+		if (ring->cq_ring != MAP_FAILED && ring->cq_ring != ring->sq_ring) munmap(ring->cq_ring, ring->cq_ring_size);
+		if (ring->sqes != MAP_FAILED) munmap(ring->sqes, ring->sqes_size);
+		close(ring_fd);
+		mem_free(ring);
+		return false;
+	}
+	
+	ring->sq_head = ring->sq_ring + params.sq_off.head;
+	ring->sq_tail = ring->sq_ring + params.sq_off.tail;
+	ring->sq_mask = ring->sq_ring + params.sq_off.ring_mask;
+	ring->sq_array = ring->sq_ring + params.sq_off.array;
+	ring->cq_head = ring->cq_ring + params.cq_off.head;
+	ring->cq_tail = ring->cq_ring + params.cq_off.tail;
+	ring->cq_mask = ring->cq_ring + params.cq_off.ring_mask;
+	ring->cqes = ring->cq_ring + params.cq_off.cqes;
+	
+	for (s32 i = 0; i < FILE_READER_QUEUE_DEPTH; i++)
+	{
+		ring->free_slots[ring->free_slot_count++] = FILE_READER_QUEUE_DEPTH-1-i;
+	}
+	
+	reader->backend_data = ring;
+	reader->thread_count = 1;
+	reader->threads = mem_alloc(sizeof(thread));
+	reader->threads[0] = thread_start(file_reader_io_uring_worker, reader);
+	
+	if (!reader->threads[0].valid)
+	{
+		file_reader_io_uring_stop(reader);
+		mem_free(reader->threads);
+		reader->thread_count = 0;
+		return false;
+	}
+	
+	return true;
+}
+
+void file_reader_io_uring_stop(file_reader *reader)
+{
+	io_uring_state *ring = reader->backend_data;
+	if (!ring) return;
+	
+	munmap(ring->sqes, ring->sqes_size);
+	if (ring->cq_ring != ring->sq_ring) munmap(ring->cq_ring, ring->cq_ring_size);
+	munmap(ring->sq_ring, ring->sq_ring_size);
+	close(ring->ring_fd);
+	
+	mem_free(ring);
+	reader->backend_data = 0;
+}
+
+#else
+
+bool file_reader_io_uring_start(file_reader *reader)
+{
+	return false;
+}
+
+void file_reader_io_uring_stop(file_reader *reader)
+{
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,325 @@
+/* 
+*  BSD 2-Clause “Simplified” License
+*  Copyright (c) 2019, Aldrik Ramaekers, aldrik.ramaekers@protonmail.com
+*  All rights reserved.
+*/
+
+#include <sys/inotify.h>
+#include <poll.h>
+
+// IN_MODIFY because files that stay open while they are written, like logs, never
+// send IN_CLOSE_WRITE
+#define FILE_WATCHER_INOTIFY_MASK (IN_CREATE | IN_DELETE | IN_MODIFY | IN_CLOSE_WRITE | IN_ATTRIB | \
+IN_MOVED_FROM | IN_MOVED_TO | IN_ONLYDIR | IN_DONT_FOLLOW | IN_EXCL_UNLINK)
+// modified paths that are collected before they are looked at
+#define FILE_WATCHER_MAX_MODIFIED 256
+
+typedef struct t_file_watcher_inotify
+{
+	s32 fd;
+	char **watch_paths; // directory of every watch descriptor, ends with '/'
+	s32 watch_capacity;
+	bool watch_limit_reached;
+	
+	// IN_MOVED_FROM waiting for the IN_MOVED_TO with the same cookie
+	char *moved_from;
+	u32 moved_cookie;
+	bool moved_is_directory;
+	
+	// a writer sends IN_MODIFY for every write, the paths are looked at once per
+	// FILE_WATCHER_POLL_MS
+	array modified; // char*
+	u64 modified_since; // when the oldest one was added
+} file_watcher_inotify;
+
+char file_watcher_separator()
+{
+	return '/';
+}
+
+bool file_watcher_backend_start(file_watcher *watcher)
+{
+	s32 fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (fd == -1) return false;
+	
+	file_watcher_inotify *backend = mem_alloc(sizeof(file_watcher_inotify));
+	backend->fd = fd;
+	backend->watch_capacity = 64;
+	backend->watch_paths = mem_alloc(sizeof(char*)*backend->watch_capacity);
+	memset(backend->watch_paths, 0, sizeof(char*)*backend->watch_capacity);
+	backend->watch_limit_reached = false;
+	backend->moved_from = 0;
+	backend->modified = array_create(sizeof(char*));
+	backend->modified_since = 0;
+	watcher->backend_data = backend;
+	
+	return true;
+}
+
+void file_watcher_backend_stop(file_watcher *watcher)
+{
+	file_watcher_inotify *backend = watcher->backend_data;
+	if (!backend) return;
+	
+	close(backend->fd);
+	for (s32 i = 0; i < backend->watch_capacity; i++)
+	{
+		if (backend->watch_paths[i]) mem_free(backend->watch_paths[i]);
+	}
+	mem_free(backend->watch_paths);
+	if (backend->moved_from) mem_free(backend->moved_from);
+	for (s32 i = 0; i < backend->modified.length; i++)
+	{
+		mem_free(*(char**)array_at(&backend->modified, i));
+	}
+	array_destroy(&backend->modified);
+	mem_free(backend);
+	watcher->backend_data = 0;
+}
+
+// false when the path does not fit with room for a trailing '/', the watcher
+// skips such paths
+static bool file_watcher_join_path(char *buffer, char *directory, char *name)
+{
+	s32 length = snprintf(buffer, MAX_INPUT_LENGTH, "%s%s", directory, name);
+	return length >= 0 && length+1 < MAX_INPUT_LENGTH;
+}
+
+static void file_watcher_inotify_add_watch(file_watcher_inotify *backend, char *directory)
+{
+	s32 wd = inotify_add_watch(backend->fd, directory, FILE_WATCHER_INOTIFY_MASK);
+	if (wd == -1)
+	{
+		// out of watches, directories that are not watched are only seen by a rescan
+		if (errno == ENOSPC) backend->watch_limit_reached = true;
+		return;
+	}
+	
+	if (wd >= backend->watch_capacity)
+	{
+		s32 capacity = backend->watch_capacity;
+		while (wd >= capacity) capacity *= 2;
+		backend->watch_paths = mem_realloc(backend->watch_paths, sizeof(char*)*capacity);
+		memset(backend->watch_paths + backend->watch_capacity, 0, sizeof(char*)*(capacity - backend->watch_capacity));
+		backend->watch_capacity = capacity;
+	}
+	
+	// the same directory returns the same descriptor
+	if (backend->watch_paths[wd]) mem_free(backend->watch_paths[wd]);
+	backend->watch_paths[wd] = file_watcher_copy_string(directory);
+}
+
+// moved or removed directories keep their descriptors until the kernel sends IN_IGNORED,
+// new_directory is 0 when the directory left the tree
+static void file_watcher_inotify_move_watches(file_watcher_inotify *backend, char *old_directory, char *new_directory)
+{
+	s32 old_length = strlen(old_directory);
+	for (s32 wd = 0; wd < backend->watch_capacity; wd++)
+	{
+		char *path = backend->watch_paths[wd];
+		if (!path || strncmp(path, old_directory, old_length) != 0) continue;
+		
+		char moved[MAX_INPUT_LENGTH];
+		if (new_directory && file_watcher_join_path(moved, new_directory, path + old_length))
+		{
+			mem_free(path);
+			backend->watch_paths[wd] = file_watcher_copy_string(moved);
+		}
+		else
+		{
+			inotify_rm_watch(backend->fd, wd);
+		}
+	}
+}
+
+static void file_watcher_inotify_flush_move(file_watcher *watcher, file_watcher_inotify *backend)
+{
+	if (!backend->moved_from) return;
+	
+	// moved out of the tree
+	if (backend->moved_is_directory)
+	{
+		char directory[MAX_INPUT_LENGTH];
+		if (file_watcher_join_path(directory, backend->moved_from, "/"))
+			file_watcher_inotify_move_watches(backend, directory, 0);
+	}
+	file_watcher_path_removed(watcher, backend->moved_from);
+	
+	mem_free(backend->moved_from);
+	backend->moved_from = 0;
+}
+
+static void file_watcher_inotify_add_modified(file_watcher_inotify *backend, char *path)
+{
+	for (s32 i = 0; i < backend->modified.length; i++)
+	{
+		if (strcmp(*(char**)array_at(&backend->modified, i), path) == 0) return;
+	}
+	
+	if (!backend->modified.length) backend->modified_since = platform_get_time(TIME_FULL, TIME_MILI_S);
+	char *copy = file_watcher_copy_string(path);
+	array_push(&backend->modified, &copy);
+}
+
+// the snapshot only reports the files whose size or time changed
+static void file_watcher_inotify_flush_modified(file_watcher *watcher, file_watcher_inotify *backend)
+{
+	for (s32 i = 0; i < backend->modified.length; i++)
+	{
+		char *path = *(char**)array_at(&backend->modified, i);
+		file_watcher_path_changed(watcher, path);
+		mem_free(path);
+	}
+	backend->modified.length = 0;
+}
+
+bool file_watcher_backend_wait(file_watcher *watcher)
+{
+	file_watcher_inotify *backend = watcher->backend_data;
+	if (backend->watch_limit_reached)
+	{
+		file_watcher_backend_stop(watcher);
+		watcher->mode = FILE_WATCHER_RESCAN;
+		return false;
+	}
+	
+	struct pollfd poll_fd;
+	poll_fd.fd = backend->fd;
+	poll_fd.events = POLLIN;
+	poll_fd.revents = 0;
+	if (poll(&poll_fd, 1, FILE_WATCHER_POLL_MS) <= 0)
+	{
+		// the IN_MOVED_TO of a pair is queued right after IN_MOVED_FROM, when
+		// nothing follows the file left the tree
+		file_watcher_inotify_flush_move(watcher, backend);
+		file_watcher_inotify_flush_modified(watcher, backend);
+		return true;
+	}
+	
+	char buffer[kilobytes(64)] __attribute__((aligned(__alignof__(struct inotify_event))));
+	ssize_t length = read(backend->fd, buffer, sizeof(buffer));
+	if (length <= 0) return true;
+	
+	bool result = true;
+	struct inotify_event *event;
+	for (char *ptr = buffer; ptr < buffer + length; ptr += sizeof(struct inotify_event) + event->len)
+	{
+		event = (struct inotify_event*)ptr;
+		
+		if (event->mask & IN_Q_OVERFLOW)
+		{
+			result = false;
+			continue;
+		}
+		
+		bool is_pair = (event->mask & IN_MOVED_TO) && backend->moved_from && event->cookie == backend->moved_cookie;
+		if (!is_pair) file_watcher_inotify_flush_move(watcher, backend);
+		
+		if (event->wd < 0 || event->wd >= backend->watch_capacity || !backend->watch_paths[event->wd])
+			continue;
+		
+		if (event->mask & IN_IGNORED)
+		{
+			mem_free(backend->watch_paths[event->wd]);
+			backend->watch_paths[event->wd] = 0;
+			continue;
+		}
+		if (!event->len) continue;
+		
+		char path[MAX_INPUT_LENGTH];
+		if (!file_watcher_join_path(path, backend->watch_paths[event->wd], event->name)) continue;
+		bool is_directory = event->mask & IN_ISDIR;
+		
+		if (event->mask & IN_MOVED_FROM)
+		{
+			backend->moved_from = file_watcher_copy_string(path);
+			backend->moved_cookie = event->cookie;
+			backend->moved_is_directory = is_directory;
+		}
+		else if (is_pair)
+		{
+			if (backend->moved_is_directory)
+			{
+				char old_directory[MAX_INPUT_LENGTH];
+				char new_directory[MAX_INPUT_LENGTH];
+				if (file_watcher_join_path(old_directory, backend->moved_from, "/") &&
+					file_watcher_join_path(new_directory, path, "/"))
+					file_watcher_inotify_move_watches(backend, old_directory, new_directory);
+			}
+			file_watcher_path_renamed(watcher, backend->moved_from, path);
+			
+			mem_free(backend->moved_from);
+			backend->moved_from = 0;
+		}
+		else if (event->mask & IN_DELETE)
+		{
+			file_watcher_path_removed(watcher, path);
+		}
+		else if (event->mask & IN_MODIFY)
+		{
+			file_watcher_inotify_add_modified(backend, path);
+		}
+		else
+		{
+			// created, written, touched or moved in from outside the tree
+			file_watcher_path_changed(watcher, path);
+		}
+	}
+	
+	// files that are written the whole time are still reported
+	if (backend->modified.length >= FILE_WATCHER_MAX_MODIFIED ||
+		(backend->modified.length && platform_get_time(TIME_FULL, TIME_MILI_S) - backend->modified_since >= FILE_WATCHER_POLL_MS))
+		file_watcher_inotify_flush_modified(watcher, backend);
+	
+	if (backend->watch_limit_reached) result = false;
+	return result;
+}
+
+void file_watcher_scan(file_watcher *watcher, char *directory)
+{
+	file_watcher_inotify *backend = watcher->backend_data;
+	if (watcher->mode == FILE_WATCHER_NATIVE && backend)
+		file_watcher_inotify_add_watch(backend, directory);
+	
+	DIR *d = opendir(directory);
+	if (!d) return;
+	
+	struct dirent *dir;
+	while ((dir = readdir(d)) != NULL)
+	{
+		if (watcher->stop) break;
+		if ((strcmp(dir->d_name, ".") == 0) || (strcmp(dir->d_name, "..") == 0))
+			continue;
+		
+		// symbolic links are not followed, like platform_list_files
+		struct stat info;
+		if (fstatat(dirfd(d), dir->d_name, &info, AT_SYMLINK_NOFOLLOW) == -1)
+			continue;
+		
+		char path[MAX_INPUT_LENGTH];
+		if (!file_watcher_join_path(path, directory, dir->d_name)) continue;
+		if (S_ISDIR(info.st_mode))
+		{
+			string_appendn(path, "/", MAX_INPUT_LENGTH);
+			file_watcher_scan(watcher, path);
+		}
+		else if (S_ISREG(info.st_mode))
+		{
+			file_watcher_file_found(watcher, path, info.st_size,
+									(u64)info.st_mtim.tv_sec*1000000000 + info.st_mtim.tv_nsec);
+		}
+	}
+	closedir(d);
+}
+
+bool file_watcher_stat(char *path, bool *is_directory, u64 *size, u64 *mtime)
+{
+	struct stat info;
+	if (lstat(path, &info) == -1) return false;
+	if (!S_ISDIR(info.st_mode) && !S_ISREG(info.st_mode)) return false;
+	
+	*is_directory = S_ISDIR(info.st_mode);
+	*size = info.st_size;
+	*mtime = (u64)info.st_mtim.tv_sec*1000000000 + info.st_mtim.tv_nsec;
+	return true;
+}
\ No newline at end of file
@@ -0,0 +1,34 @@
+/* 
+*  BSD 2-Clause “Simplified” License
+*  Copyright (c) 2019, Aldrik Ramaekers, aldrik.ramaekers@protonmail.com
+*  All rights reserved.
+*/
+
+bool match_text_open_file(match_text *text, char *path)
+{
+	s32 fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (fd == -1) return false;
+	
+	text->file = (void*)(s64)fd;
+	return true;
+}
+
+s32 match_text_read_file(match_text *text, s64 offset, char *buffer, s32 length)
+{
+	s32 fd = (s32)(s64)text->file;
+	s32 total = 0;
+	while (total < length)
+	{
+		ssize_t read_result = pread(fd, buffer+total, length-total, offset+total);
+		if (read_result == -1 && errno == EINTR) continue;
+		if (read_result == -1) return -1;
+		if (read_result == 0) break;
+		total += read_result;
+	}
+	return total;
+}
+
+void match_text_close_file(match_text *text)
+{
+	close((s32)(s64)text->file);
+}
\ No newline at end of file
@@ -20,6 +20,11 @@
 #include <dlfcn.h>
 #include <sys/stat.h>
 #include <sys/mman.h>
+#include <sys/resource.h>
+#include <fcntl.h>
+#include <sys/ioctl.h>
+#include <linux/fs.h>
+#include <linux/fiemap.h>
 #include <X11/cursorfont.h>
 
 #define GET_ATOM(X) window.X = XInternAtom(window.display, #X, False)
@@ -193,6 +198,11 @@ void platform_delete_file(char *path)
 	remove(path);
 }
 
+void platform_create_directory(char *path)
+{
+	mkdir(path, S_IRWXU | S_IRWXG | S_IROTH | S_IXOTH);
+}
+
 bool platform_write_file_content(char *path, const char *mode, char *buffer, s32 len)
 {
 	bool result = false;
@@ -272,6 +282,76 @@ s32 platform_get_file_size(char *path)
 	return length;
 }
 
+bool platform_get_file_info(char *path, file_info *info)
+{
+	struct stat file_stat;
+	if (stat(path, &file_stat) == -1) return false;
+	
+	info->size = file_stat.st_size;
+	info->mtime = (u64)file_stat.st_mtim.tv_sec*1000000000 + file_stat.st_mtim.tv_nsec;
+	info->device = file_stat.st_dev;
+	info->inode = file_stat.st_ino;
+	info->is_directory = S_ISDIR(file_stat.st_mode);
+	return true;
+}
+
+u64 platform_get_file_physical_offset(char *path)
+{
+	s32 fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (fd == -1) return 0;
+	
+	// room for the first extent only
+	u64 buffer[(sizeof(struct fiemap) + sizeof(struct fiemap_extent)) / sizeof(u64) + 1];
+	memset(buffer, 0, sizeof(buffer));
+	struct fiemap *map = (struct fiemap*)buffer;
+	map->fm_start = 0;
+	map->fm_length = FIEMAP_MAX_OFFSET;
+	map->fm_extent_count = 1;
+	
+	u64 result = 0;
+	if (ioctl(fd, FS_IOC_FIEMAP, map) == 0 && map->fm_mapped_extents)
+		result = map->fm_extents[0].fe_physical;
+	
+	close(fd);
+	return result;
+}
+
+bool platform_evict_file_cache(char *path)
+{
+	s32 fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (fd == -1) return false;
+	
+	bool result = posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED) == 0;
+	close(fd);
+	return result;
+}
+
+static s16 translate_file_error(s32 error)
+{
+	if (error == EMFILE)
+		return FILE_ERROR_TOO_MANY_OPEN_FILES_PROCESS;
+	else if (error == ENFILE)
+		return FILE_ERROR_TOO_MANY_OPEN_FILES_SYSTEM;
+	else if (error == EACCES)
+		return FILE_ERROR_NO_ACCESS;
+	else if (error == EPERM)
+		return FILE_ERROR_NO_ACCESS;
+	else if (error == ENOENT)
+		return FILE_ERROR_NOT_FOUND;
+	else if (error == ECONNABORTED)
+		return FILE_ERROR_CONNECTION_ABORTED;
+	else if (error == ECONNREFUSED)
+		return FILE_ERROR_CONNECTION_REFUSED;
+	else if (error == ENETDOWN)
+		return FILE_ERROR_NETWORK_DOWN;
+	else if (error == EREMOTEIO)
+		return FILE_ERROR_REMOTE_IO_ERROR;
+	else if (error == ESTALE)
+		return FILE_ERROR_STALE;
+	
+	return FILE_ERROR_GENERIC;
+}
+
 file_content platform_read_file_content(char *path, const char *mode)
 {
 	file_content result;
@@ -283,32 +363,7 @@ file_content platform_read_file_content(char *path, const char *mode)
 	
 	if (!file) 
 	{
-		if (errno == EMFILE)
-			result.file_error = FILE_ERROR_TOO_MANY_OPEN_FILES_PROCESS;
-		else if (errno == ENFILE)
-			result.file_error = FILE_ERROR_TOO_MANY_OPEN_FILES_SYSTEM;
-		else if (errno == EACCES)
-			result.file_error = FILE_ERROR_NO_ACCESS;
-		else if (errno == EPERM)
-			result.file_error = FILE_ERROR_NO_ACCESS;
-		else if (errno == ENOENT)
-			result.file_error = FILE_ERROR_NOT_FOUND;
-		else if (errno == ECONNABORTED)
-			result.file_error = FILE_ERROR_CONNECTION_ABORTED;
-		else if (errno == ECONNREFUSED)
-			result.file_error = FILE_ERROR_CONNECTION_REFUSED;
-		else if (errno == ENETDOWN)
-			result.file_error = FILE_ERROR_NETWORK_DOWN;
-		else if (errno == EREMOTEIO)
-			result.file_error = FILE_ERROR_REMOTE_IO_ERROR;
-		else if (errno == ESTALE)
-			result.file_error = FILE_ERROR_STALE;
-		else
-		{
-			result.file_error = FILE_ERROR_GENERIC;
-			printf("ERROR: %d\n", errno);
-		}
-		
+		result.file_error = translate_file_error(errno);
 		goto done_failure;
 	}
 	
@@ -1423,6 +1478,15 @@ inline s32 platform_get_memory_size()
 	return (int)(aid);
 }
 
+u64 platform_get_peak_memory_usage()
+{
+	struct rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+	
+	// kilobytes on linux
+	return (u64)usage.ru_maxrss * 1024;
+}
+
 void platform_show_message(platform_window *window, char *message, char *title)
 {
 	char command[MAX_INPUT_LENGTH];
@@ -1498,49 +1562,85 @@ void *platform_open_file_dialog_block(void *arg)
 	return 0;
 }
 
-void platform_list_files_block(array *list, char *start_dir, array filters, bool recursive, memory_bucket *bucket, bool include_directories, bool *is_cancelled, search_info *info)
+void platform_list_files_block(array *list, char *start_dir, file_filter *filter, bool recursive, memory_bucket *bucket, bool include_directories, bool *is_cancelled, search_info *info)
 {
 	assert(list);
 	
 	s32 len = 0;
 	char *matched_filter = 0;
 	
-	char *subdirname_buf;
-	if (bucket)
-		subdirname_buf = memory_bucket_reserve(bucket, MAX_INPUT_LENGTH);
-	else
-		subdirname_buf = mem_alloc(MAX_INPUT_LENGTH);
+	// only found files go in the bucket, it is kept for the whole search
+	char *subdirname_buf = mem_alloc(MAX_INPUT_LENGTH);
+	
+	file_dedup *dedup = info ? info->dedup : 0;
 	
 	DIR *d;
 	struct dirent *dir;
 	d = opendir(start_dir);
 	if (d) {
+		// subdirectories are checked before they are entered, except the first one
+		struct stat dir_stat;
+		if (dedup && !dedup->has_root && fstat(dirfd(d), &dir_stat) == 0)
+		{
+			file_identity root = { dir_stat.st_dev, dir_stat.st_ino };
+			file_dedup_set_root(dedup, root);
+		}
+		u64 device = dedup ? dedup->device : 0;
+		
 		set_active_directory(start_dir);
 		while ((dir = readdir(d)) != NULL) {
 			if (*is_cancelled) break;
 			set_active_directory(start_dir);
 			
-			if (dir->d_type == DT_DIR)
+			u8 type = dir->d_type;
+			file_identity identity = { device, dir->d_ino };
+			
+			// links are only followed when the dedup set can stop a loop
+			if (type == DT_LNK)
+			{
+				struct stat target;
+				if (!dedup || !dedup->follow_symlinks || fstatat(dirfd(d), dir->d_name, &target, 0) != 0)
+					continue;
+				
+				if (S_ISDIR(target.st_mode)) type = DT_DIR;
+				else if (S_ISREG(target.st_mode)) type = DT_REG;
+				else continue;
+				identity.device = target.st_dev;
+				identity.inode = target.st_ino;
+			}
+			
+			if (type == DT_DIR)
 			{
 				if ((strcmp(dir->d_name, ".") == 0) || (strcmp(dir->d_name, "..") == 0))
 					continue;
 				
+				// the whole subtree is skipped
+				if (info && info->ignore && file_ignore_matches(info->ignore, dir->d_name, true))
+				{
+					info->ignored_dir_count++;
+					continue;
+				}
+				
+				// bind mounts and followed links can lead to a directory that was walked
+				// already, a mount point has the device of the mounted file system
+				if (dedup)
+				{
+					struct stat entry;
+					if (dir->d_type == DT_DIR && fstatat(dirfd(d), dir->d_name, &entry, AT_SYMLINK_NOFOLLOW) == 0)
+					{
+						identity.device = entry.st_dev;
+						identity.inode = entry.st_ino;
+					}
+					if (!file_dedup_visit_directory(dedup, identity)) continue;
+				}
+				
 				if (include_directories)
 				{
-					if ((len = filter_matches(&filters, dir->d_name, 
+					if ((len = file_filter_matches(filter, dir->d_name, 
 											  &matched_filter)) && len != -1)
 					{
-						char *buf;
-						if (bucket)
-							buf = memory_bucket_reserve(bucket, MAX_INPUT_LENGTH);
-						else
-							buf = mem_alloc(MAX_INPUT_LENGTH);
-						
-						//realpath(dir->d_name, buf);
-						snprintf(buf, MAX_INPUT_LENGTH, "%s%s",start_dir, dir->d_name);
-						
 						found_file f;
-						f.path = buf;
+						f.path = create_found_file_path(bucket, start_dir, dir->d_name);
 						
 						if (bucket)
 							f.matched_filter = memory_bucket_reserve(bucket, len+1);
@@ -1564,29 +1664,33 @@ void platform_list_files_block(array *list, char *start_dir, array filters, bool
 					string_appendn(subdirname_buf, "/", MAX_INPUT_LENGTH);
 					
 					// do recursive search
-					platform_list_files_block(list, subdirname_buf, filters, recursive, bucket, include_directories, is_cancelled, info);
+					if (info && info->ignore) file_ignore_enter(info->ignore, subdirname_buf, dir->d_name);
+					if (dedup) dedup->device = identity.device;
+					platform_list_files_block(list, subdirname_buf, filter, recursive, bucket, include_directories, is_cancelled, info);
+					if (dedup) dedup->device = device;
+					if (info && info->ignore) file_ignore_leave(info->ignore);
 				}
 			}
 			// we handle DT_UNKNOWN for file systems that do not support type lookup.
-			else if (dir->d_type == DT_REG || dir->d_type == DT_UNKNOWN)
+			else if (type == DT_REG || type == DT_UNKNOWN)
 			{
+				if (info && info->ignore && file_ignore_matches(info->ignore, dir->d_name, false))
+				{
+					info->ignored_file_count++;
+					continue;
+				}
+				
+				// a hard link or followed link to a file that was found already
+				if (dedup && !file_dedup_visit_file(dedup, identity)) continue;
+				
 				if (info) info->file_count++;
 				
 				// check if name matches pattern
-				if ((len = filter_matches(&filters, dir->d_name, 
+				if ((len = file_filter_matches(filter, dir->d_name, 
 										  &matched_filter)) && len != -1)
 				{
-					char *buf;
-					if (bucket)
-						buf = memory_bucket_reserve(bucket, MAX_INPUT_LENGTH);
-					else
-						buf = mem_alloc(MAX_INPUT_LENGTH);
-					
-					//realpath(dir->d_name, buf);
-					snprintf(buf, MAX_INPUT_LENGTH, "%s%s",start_dir, dir->d_name);
-					
 					found_file f;
-					f.path = buf;
+					f.path = create_found_file_path(bucket, start_dir, dir->d_name);
 					
 					if (bucket)
 						f.matched_filter = memory_bucket_reserve(bucket, len+1);
@@ -1605,8 +1709,7 @@ void platform_list_files_block(array *list, char *start_dir, array filters, bool
 		closedir(d);
 	}
 	
-	if (!bucket)
-		mem_free(subdirname_buf);
+	mem_free(subdirname_buf);
 }
 
 char *platform_get_full_path(char *file)
@@ -0,0 +1,50 @@
+/* 
+*  BSD 2-Clause “Simplified” License
+*  Copyright (c) 2019, Aldrik Ramaekers, aldrik.ramaekers@protonmail.com
+*  All rights reserved.
+*/
+
+#include <sys/mman.h>
+
+bool trigram_index_map_file(trigram_index *index, char *path)
+{
+	s32 fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (fd == -1) return false;
+	
+	struct stat info;
+	if (fstat(fd, &info) == -1 || info.st_size == 0)
+	{
+		close(fd);
+		return false;
+	}
+	
+	// the mapping stays valid after the descriptor is closed
+	void *data = mmap(0, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (data == MAP_FAILED) return false;
+	
+	index->data = data;
+	index->size = info.st_size;
+	index->mapping = 0;
+	return true;
+}
+
+void trigram_index_unmap_file(trigram_index *index)
+{
+	munmap(index->data, index->size);
+}
+
+bool trigram_index_stat_file(char *path, u64 *size, u64 *mtime)
+{
+	struct stat info;
+	if (stat(path, &info) == -1) return false;
+	
+	*size = info.st_size;
+	*mtime = (u64)info.st_mtim.tv_sec*1000000000 + info.st_mtim.tv_nsec;
+	return true;
+}
+
+bool trigram_index_replace_file(char *from, char *to)
+{
+	return rename(from, to) == 0;
+}
\ No newline at end of file
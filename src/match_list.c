@@ -0,0 +1,166 @@
+/* 
+*  BSD 2-Clause “Simplified” License
+*  Copyright (c) 2019, Aldrik Ramaekers, aldrik.ramaekers@protonmail.com
+*  All rights reserved.
+*/
+
+match_list match_list_create()
+{
+	match_list list;
+	list.chunks = mem_alloc(sizeof(file_match*)*MATCH_LIST_MAX_CHUNKS);
+	memset(list.chunks, 0, sizeof(file_match*)*MATCH_LIST_MAX_CHUNKS);
+	list.length = 0;
+	return list;
+}
+
+void match_list_destroy(match_list *list)
+{
+	for (s32 i = 0; i < MATCH_LIST_MAX_CHUNKS && list->chunks[i]; i++)
+	{
+		mem_free(list->chunks[i]);
+	}
+	mem_free(list->chunks);
+	list->chunks = 0;
+	list->length = 0;
+}
+
+u32 match_list_push(match_list *list, file_match *matches, u32 count)
+{
+	u32 length = list->length;
+	u32 pushed = 0;
+	while (pushed < count)
+	{
+		u32 chunk = length / MATCH_LIST_CHUNK_SIZE;
+		if (chunk >= MATCH_LIST_MAX_CHUNKS) break;
+		
+		if (!list->chunks[chunk])
+			list->chunks[chunk] = mem_alloc(sizeof(file_match)*MATCH_LIST_CHUNK_SIZE);
+		
+		u32 offset = length % MATCH_LIST_CHUNK_SIZE;
+		u32 n = MATCH_LIST_CHUNK_SIZE - offset;
+		if (n > count - pushed) n = count - pushed;
+		
+		memcpy(list->chunks[chunk] + offset, matches + pushed, sizeof(file_match)*n);
+		pushed += n;
+		length += n;
+	}
+	
+	// matches and chunk pointers are written before the new length is visible
+	__atomic_store_n(&list->length, length, __ATOMIC_RELEASE);
+	return pushed;
+}
+
+inline u32 match_list_length(match_list *list)
+{
+	return __atomic_load_n(&list->length, __ATOMIC_ACQUIRE);
+}
+
+bool match_list_is_full(match_list *list)
+{
+	return match_list_length(list) == MATCH_LIST_CHUNK_SIZE*MATCH_LIST_MAX_CHUNKS;
+}
+
+inline file_match *match_list_at(match_list *list, u32 index)
+{
+	return &list->chunks[index / MATCH_LIST_CHUNK_SIZE][index % MATCH_LIST_CHUNK_SIZE];
+}
+
+match_channel match_channel_create(u32 capacity)
+{
+	match_channel channel;
+	channel.mutex = mutex_create();
+	channel.capacity = capacity;
+	channel.ring = mem_alloc(sizeof(file_match)*capacity);
+	channel.head = 0;
+	channel.tail = 0;
+	channel.closed = false;
+	channel.wait_count = 0;
+	return channel;
+}
+
+void match_channel_destroy(match_channel *channel)
+{
+	mem_free(channel->ring);
+	channel->ring = 0;
+	mutex_destroy(&channel->mutex);
+}
+
+bool match_channel_send(match_channel *channel, file_match *matches, u32 count, bool *cancel_search)
+{
+	u32 sent = 0;
+	while (sent < count)
+	{
+		if (cancel_search && *cancel_search) return false;
+		
+		mutex_lock(&channel->mutex);
+		if (channel->closed)
+		{
+			mutex_unlock(&channel->mutex);
+			return false;
+		}
+		
+		u32 n = channel->capacity - (u32)(channel->head - channel->tail);
+		if (n > count - sent) n = count - sent;
+		for (u32 i = 0; i < n; i++)
+		{
+			channel->ring[(channel->head + i) % channel->capacity] = matches[sent + i];
+		}
+		channel->head += n;
+		mutex_unlock(&channel->mutex);
+		
+		sent += n;
+		if (!n)
+		{
+			// the ui did not keep up, wait for it to drain
+			__atomic_add_fetch(&channel->wait_count, 1, __ATOMIC_RELAXED);
+			thread_sleep(MATCH_CHANNEL_WAIT_US);
+		}
+	}
+	
+	return true;
+}
+
+u32 match_channel_drain(match_channel *channel, match_list *list, u32 max_count)
+{
+	mutex_lock(&channel->mutex);
+	
+	u32 count = (u32)(channel->head - channel->tail);
+	if (count > max_count) count = max_count;
+	
+	// the ring is copied in at most two parts
+	u32 drained = 0;
+	while (drained < count)
+	{
+		u32 start = (channel->tail + drained) % channel->capacity;
+		u32 n = channel->capacity - start;
+		if (n > count - drained) n = count - drained;
+		
+		u32 pushed = match_list_push(list, channel->ring + start, n);
+		drained += pushed;
+		if (pushed != n)
+		{
+			// senders would wait for room forever
+			channel->closed = true;
+			break;
+		}
+	}
+	channel->tail += drained;
+	
+	mutex_unlock(&channel->mutex);
+	return drained;
+}
+
+u32 match_channel_pending(match_channel *channel)
+{
+	mutex_lock(&channel->mutex);
+	u32 result = (u32)(channel->head - channel->tail);
+	mutex_unlock(&channel->mutex);
+	return result;
+}
+
+void match_channel_close(match_channel *channel)
+{
+	mutex_lock(&channel->mutex);
+	channel->closed = true;
+	mutex_unlock(&channel->mutex);
+}
\ No newline at end of file
@@ -0,0 +1,62 @@
+/* 
+*  BSD 2-Clause “Simplified” License
+*  Copyright (c) 2019, Aldrik Ramaekers, aldrik.ramaekers@protonmail.com
+*  All rights reserved.
+*/
+
+#ifndef INCLUDE_MATCH_LIST
+#define INCLUDE_MATCH_LIST
+
+// matches are stored in chunks that are never moved, the list holds at most
+// MATCH_LIST_CHUNK_SIZE*MATCH_LIST_MAX_CHUNKS matches
+#define MATCH_LIST_CHUNK_SIZE 16384
+#define MATCH_LIST_MAX_CHUNKS 16384
+
+// matches waiting for the ui, searchers wait when the channel is full
+#define MATCH_CHANNEL_CAPACITY 65536
+// matches moved from the channel to the list every frame
+#define MATCH_CHANNEL_FRAME_LIMIT 20000
+#define MATCH_CHANNEL_WAIT_US 1000
+
+// Append-only list with a single writer. Readers on any thread see every match
+// below match_list_length without locking.
+typedef struct t_match_list
+{
+	struct t_file_match **chunks;
+	u32 length;
+} match_list;
+
+// Bounded queue between the search threads and the ui thread.
+typedef struct t_match_channel
+{
+	mutex mutex;
+	struct t_file_match *ring;
+	u32 capacity;
+	u64 head; // total matches sent
+	u64 tail; // total matches drained
+	bool closed;
+	u64 wait_count; // times a searcher waited for room
+} match_channel;
+
+match_list match_list_create();
+void match_list_destroy(match_list *list);
+// returns the number of matches added, less than count when the list is full
+u32 match_list_push(match_list *list, struct t_file_match *matches, u32 count);
+u32 match_list_length(match_list *list);
+bool match_list_is_full(match_list *list);
+struct t_file_match *match_list_at(match_list *list, u32 index);
+
+match_channel match_channel_create(u32 capacity);
+void match_channel_destroy(match_channel *channel);
+// blocks while the channel is full, returns false when cancel_search is set or the
+// channel was closed before every match was sent.
+bool match_channel_send(match_channel *channel, struct t_file_match *matches, u32 count, bool *cancel_search);
+// moves at most max_count matches to list and returns how many were moved, only
+// the thread that owns list may drain into it. the channel is closed when list is
+// full, the search has to be stopped then.
+u32 match_channel_drain(match_channel *channel, match_list *list, u32 max_count);
+u32 match_channel_pending(match_channel *channel);
+// waiting and future senders give up, used when the search is cancelled
+void match_channel_close(match_channel *channel);
+
+#endif
\ No newline at end of file
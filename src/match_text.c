@@ -0,0 +1,70 @@
+/* 
+*  BSD 2-Clause “Simplified” License
+*  Copyright (c) 2019, Aldrik Ramaekers, aldrik.ramaekers@protonmail.com
+*  All rights reserved.
+*/
+
+match_text match_text_create()
+{
+	match_text text;
+	text.path = 0;
+	text.is_open = false;
+	text.file = 0;
+	text.buffer = 0;
+	text.buffer_size = 0;
+	text.buffer_length = 0;
+	text.buffer_offset = 0;
+	return text;
+}
+
+void match_text_destroy(match_text *text)
+{
+	if (text->is_open) match_text_close_file(text);
+	if (text->buffer) mem_free(text->buffer);
+	*text = match_text_create();
+}
+
+bool match_text_has_line(file_match *match)
+{
+	return match->line_copy || match->line_offset >= 0;
+}
+
+char *match_text_get_line(match_text *text, file_match *match, s32 *length)
+{
+	*length = match->line_length;
+	if (match->line_copy) return match->line_copy;
+	if (match->line_offset < 0 || !match->file.path) return 0;
+	
+	// matches of a file are found together, the path is usually the same pointer
+	if (!text->path || (match->file.path != text->path && strcmp(match->file.path, text->path) != 0))
+	{
+		if (text->is_open) match_text_close_file(text);
+		text->path = match->file.path;
+		text->is_open = match_text_open_file(text, match->file.path);
+		text->buffer_length = 0;
+		text->buffer_offset = 0;
+	}
+	if (!text->is_open) return 0;
+	if (!match->line_length) return "";
+	
+	s64 line_end = match->line_offset + match->line_length;
+	if (match->line_offset < text->buffer_offset || line_end > text->buffer_offset + text->buffer_length)
+	{
+		if (match->line_length > text->buffer_size)
+		{
+			if (text->buffer) mem_free(text->buffer);
+			text->buffer_size = match->line_length > MATCH_TEXT_BUFFER_SIZE ? match->line_length : MATCH_TEXT_BUFFER_SIZE;
+			text->buffer = mem_alloc(text->buffer_size);
+		}
+		
+		// the buffer starts at the line so the lines after it are read with it
+		s32 read = match_text_read_file(text, match->line_offset, text->buffer, text->buffer_size);
+		text->buffer_offset = match->line_offset;
+		text->buffer_length = read > 0 ? read : 0;
+		
+		// the file changed after it was searched
+		if (line_end > text->buffer_offset + text->buffer_length) return 0;
+	}
+	
+	return text->buffer + (match->line_offset - text->buffer_offset);
+}
\ No newline at end of file
@@ -0,0 +1,44 @@
+/* 
+*  BSD 2-Clause “Simplified” License
+*  Copyright (c) 2019, Aldrik Ramaekers, aldrik.ramaekers@protonmail.com
+*  All rights reserved.
+*/
+
+#ifndef INCLUDE_MATCH_TEXT
+#define INCLUDE_MATCH_TEXT
+
+// the part of a file that is read at once, lines are mostly read in order
+#define MATCH_TEXT_BUFFER_SIZE (kilobytes(256))
+
+// A file_match only knows where its line is in the file, the text is read back
+// when the match is displayed or exported. The last file stays open with the part
+// of it after the last line in a buffer because the matches of a file are found
+// together, from the start of the file to the end.
+typedef struct t_match_text
+{
+	char *path; // file that was opened last, compared by pointer first
+	bool is_open; // false when path could not be opened, it is not tried again
+	void *file; // platform handle
+	char *buffer;
+	s32 buffer_size;
+	s32 buffer_length; // bytes read into buffer
+	s64 buffer_offset; // where buffer starts in the file
+} match_text;
+
+match_text match_text_create();
+void match_text_destroy(match_text *text);
+
+// false for raw binary matches, they have no line
+bool match_text_has_line(file_match *match);
+// returns the line of match and sets length, the text is not terminated and stays
+// valid until the next call. returns 0 when the match has no line, when the file
+// can't be read or when it became shorter than the line.
+char *match_text_get_line(match_text *text, file_match *match, s32 *length);
+
+// implemented per platform. match_text_read_file returns the bytes read at offset,
+// less than length at the end of the file and -1 when reading failed.
+bool match_text_open_file(match_text *text, char *path);
+s32 match_text_read_file(match_text *text, s64 offset, char *buffer, s32 length);
+void match_text_close_file(match_text *text);
+
+#endif
\ No newline at end of file
@@ -39,9 +39,10 @@ void* memory_bucket_reserve(memory_bucket *bucket, s32 reserve_length)
 	
 	// failed to find suitable space, allocate new bucket
 	memory_bucket_entry new_bucket;
-	new_bucket.data = mem_alloc(bucket_entry->length);
 	new_bucket.length = bucket_entry->length;
-	new_bucket.cursor = 0;
+	if (new_bucket.length < reserve_length) new_bucket.length = reserve_length;
+	new_bucket.data = mem_alloc(new_bucket.length);
+	new_bucket.cursor = reserve_length;
 	array_push(&bucket->buckets, &new_bucket);
 	mutex_unlock(&bucket->bucket_mutex);
 	
@@ -25,25 +25,48 @@ typedef struct t_file_match
 	s32 file_size;
 	
 	u32 line_nr;
+	s32 line_length; // bytes of the line that are shown, longer lines are cut
+	s64 line_offset; // where the line starts in the file, -1 when it is not in the file
+	s64 match_count; // matches in the file in SEARCH_MODE_COUNT
 	s32 word_match_offset;
 	s32 word_match_length;
 	s32 word_match_offset_x; // highlight render offset
 	s32 word_match_width; // highlight render width
-	char *line_info; // will be null when no match is found
+	char *line_copy; // lines of gzip files, the decompressed text can't be read back
 } file_match;
 
 typedef struct t_search_info
 {
 	u64 file_count;
 	u64 dir_count;
+	u64 binary_skip_count; // binary files that were not searched
+	u64 ignored_dir_count; // directories skipped because of ignore files
+	u64 ignored_file_count;
+	file_ignore *ignore; // 0 when ignore files are not used
+	file_dedup *dedup; // 0 when hard links, bind mounts and links can be walked more than once
 } search_info;
 
+typedef enum t_binary_file_mode
+{
+	BINARY_FILES_SKIP, // files detected as binary are not searched
+	BINARY_FILES_RAW, // binary files are searched as raw bytes, without line info
+	BINARY_FILES_TEXT, // binary files are searched like text files
+} binary_file_mode;
+
+typedef enum t_search_mode
+{
+	SEARCH_MODE_MATCHES, // every match is saved with the position of its line
+	SEARCH_MODE_FILES_WITH_MATCHES, // a file is searched up to its first match, one record per file
+	SEARCH_MODE_COUNT, // matches are counted without saving them, one record per file with match_count set
+} search_mode;
+
 typedef struct t_search_result
 {
 	array work_queue;
 	array files;
-	array matches;
-	s32 match_count;
+	match_list matches; // read by the ui without locking
+	match_channel pending_matches; // filled by the search threads, drained by the ui every frame
+	s64 match_count; // files in SEARCH_MODE_FILES_WITH_MATCHES
 	u64 find_duration_us;
 	array errors;
 	bool show_error_message; // error occured
@@ -63,13 +86,24 @@ typedef struct t_search_result
 	bool is_command_line_search;
 	bool threads_closed;
 	search_info search_info;
+	bool respect_ignore_files; // .gitignore and .ignore files are loaded into search_info.ignore
+	bool deduplicate_files; // search_info.dedup is created, also when one of the flags below is set
+	bool follow_symlinks;
+	bool one_file_system;
 	char *export_path;
 	char *file_filter;
 	char *directory_to_search;
 	char *text_to_find;
 	s32 max_thread_count;
+	s32 min_thread_count; // the worker controller keeps the active count between the two
+	s32 active_thread_count; // chosen by the worker controller
 	s32 max_file_size;
+	s64 memory_budget; // bytes of file content in memory at once, 0 = no limit
 	bool is_recursive;
+	binary_file_mode binary_mode;
+	search_mode mode; // what is kept of the matches of a file
+	bool is_regex; // text_to_find is a regular expression
+	struct t_text_regex *regex; // compiled once when the search starts
 } search_result;
 
 typedef struct t_find_text_args
@@ -88,6 +122,15 @@ typedef struct t_file_content
 	s16 file_error;
 } file_content;
 
+typedef struct t_file_info
+{
+	u64 size;
+	u64 mtime; // nanoseconds, only compared for equality
+	u64 device; // volume serial number on windows
+	u64 inode; // file index on windows
+	bool is_directory;
+} file_info;
+
 typedef enum t_time_type
 {
 	TIME_FULL,     // realtime
@@ -222,13 +265,19 @@ void platform_set_cursor(platform_window *window, cursor_type type);
 void platform_window_set_title(platform_window *window, char *name);
 file_content platform_read_file_content(char *path, const char *mode);
 s32 platform_get_file_size(char *path);
+bool platform_get_file_info(char *path, file_info *info);
+// position of the first extent of the file on its disk, only meaningful compared
+// to other files on the same disk. 0 when the file system doesn't tell.
+u64 platform_get_file_physical_offset(char *path);
+// drops the cached content of the file so it is read from the disk next time
+bool platform_evict_file_cache(char *path);
 bool platform_write_file_content(char *path, const char *mode, char *buffer, s32 len);
 void platform_destroy_file_content(file_content *content);
 bool get_active_directory(char *buffer);
 bool set_active_directory(char *path);
 void platform_show_message(platform_window *window, char *message, char *title);
 array get_filters(char *filter);
-void platform_list_files_block(array *list, char *start_dir, array filters, bool recursive, memory_bucket *bucket, bool include_directories, bool *is_cancelled, search_info *info);
+void platform_list_files_block(array *list, char *start_dir, file_filter *filter, bool recursive, memory_bucket *bucket, bool include_directories, bool *is_cancelled, search_info *info);
 void platform_list_files(array *list, char *start_dir, char *filter, bool recursive, memory_bucket *bucket, bool *is_cancelled, bool *state, search_info *info);
 void platform_open_file_dialog(file_dialog_type type, char *buffer, char *file_filter, char *start_path);
 bool platform_get_mac_address(char *buffer, s32 buf_size);
@@ -253,12 +302,15 @@ char *get_config_save_location(char *buffer);
 char *get_file_extension(char *path);
 void get_name_from_path(char *buffer, char *path);
 void get_directory_from_path(char *buffer, char *path);
+// directory and name joined into a path of its own length, cut at MAX_INPUT_LENGTH
+char *create_found_file_path(memory_bucket *bucket, char *directory, char *name);
 vec2 platform_get_window_size(platform_window *window);
 s32 filter_matches(array *filters, char *string, char **matched_filter);
 void platform_delete_file(char *path);
 
 u64 platform_get_time(time_type time_type, time_precision precision);
 s32 platform_get_memory_size();
+u64 platform_get_peak_memory_usage(); // bytes, highest resident set size of the process
 s32 platform_get_cpu_count();
 
 u64 string_to_u64(char *str);
@@ -79,9 +79,9 @@ void platform_autocomplete_path(char *buffer, bool want_dir)
 	string_appendn(name, "*", MAX_INPUT_LENGTH);
 	
 	array files = array_create(sizeof(found_file));
-	array filters = get_filters(name);
+	file_filter filter = file_filter_create(name);
 	bool is_cancelled = false;
-	platform_list_files_block(&files, dir, filters, false, 0, want_dir, &is_cancelled, 0);
+	platform_list_files_block(&files, dir, &filter, false, 0, want_dir, &is_cancelled, 0);
 	
 	s32 index_to_take = -1;
 	if (want_dir)
@@ -102,7 +102,7 @@ void platform_autocomplete_path(char *buffer, bool want_dir)
 		index_to_take = 0;
 	}
 	
-	array_destroy(&filters);
+	file_filter_destroy(&filter);
 	
 	if (files.length > 0 && index_to_take != -1)
 	{
@@ -159,20 +159,20 @@ void *platform_list_files_thread(void *args)
 {
 	list_file_args *info = args;
 	
-	array filters = get_filters(info->pattern);
+	file_filter filter = file_filter_create(info->pattern);
 	
 	array *list = info->list;
 	char *start_dir = info->start_dir;
 	bool recursive = info->recursive;
 	
-	platform_list_files_block(info->list, info->start_dir, filters, info->recursive, info->bucket, info->include_directories, info->is_cancelled, info->info);
+	platform_list_files_block(info->list, info->start_dir, &filter, info->recursive, info->bucket, info->include_directories, info->is_cancelled, info->info);
 	
 	mutex_lock(&info->list->mutex);
 	//if (!(*info->is_cancelled))
 	*(info->state) = true;
 	mutex_unlock(&info->list->mutex);
 	
-	array_destroy(&filters);
+	file_filter_destroy(&filter);
 	
 	return 0;
 }
@@ -221,6 +221,16 @@ void destroy_found_file_array(array *found_files)
 	array_destroy(found_files);
 }
 
+char *create_found_file_path(memory_bucket *bucket, char *directory, char *name)
+{
+	s32 length = strlen(directory) + strlen(name);
+	if (length > MAX_INPUT_LENGTH-1) length = MAX_INPUT_LENGTH-1;
+	
+	char *path = bucket ? memory_bucket_reserve(bucket, length+1) : mem_alloc(length+1);
+	snprintf(path, length+1, "%s%s", directory, name);
+	return path;
+}
+
 char *get_file_extension(char *path)
 {
 	while(*path != '.' && *path)
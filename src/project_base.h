@@ -78,25 +78,58 @@
 #include "timer.h"
 #include "assets.h"
 #include "memory_bucket.h"
+#include "file_filter.h"
+#include "file_ignore.h"
+#include "file_dedup.h"
+#include "match_list.h"
 #include "platform.h"
+#include "file_reader.h"
+#include "file_schedule.h"
+#include "worker_control.h"
+#include "file_watcher.h"
 #include "render.h"
 #include "camera.h"
 #include "ui.h"
 #include "notification.h"
 #include "string_utils.h"
+#include "text_search.h"
+#include "text_regex.h"
+#include "text_gzip.h"
+#include "trigram_index.h"
+#include "search_cache.h"
+#include "match_text.h"
+#include "search_export.h"
 #include "settings_config.h"
+#include "command_line_search.h"
 #include "localization.h"
+#include "benchmark.h"
 
 #include "platform_shared.c"
+#include "file_reader.c"
+#include "file_schedule.c"
+#include "worker_control.c"
+#include "file_filter.c"
+#include "file_ignore.c"
+#include "file_dedup.c"
+#include "match_list.c"
+#include "file_watcher.c"
 
 #ifdef OS_LINUX
 #include "linux/thread.c"
 #include "linux/platform.c"
+#include "linux/file_reader.c"
+#include "linux/trigram_index.c"
+#include "linux/match_text.c"
+#include "linux/file_watcher.c"
 #endif
 
 #ifdef OS_WIN
 #include "windows/thread.c"
 #include "windows/platform.c"
+#include "windows/file_reader.c"
+#include "windows/trigram_index.c"
+#include "windows/match_text.c"
+#include "windows/file_watcher.c"
 #endif
 
 #include "render.c"
@@ -108,9 +141,18 @@
 #include "ui.c"
 #include "notification.c"
 #include "string_utils.c"
+#include "text_search.c"
+#include "text_regex.c"
+#include "text_gzip.c"
+#include "trigram_index.c"
+#include "search_cache.c"
+#include "match_text.c"
+#include "search_export.c"
 #include "settings_config.c"
+#include "command_line_search.c"
 #include "localization.c"
 #include "memory_bucket.c"
+#include "benchmark.c"
 #include "external/cJSON.c"
 
 #endif
\ No newline at end of file
@@ -0,0 +1,590 @@
+/* 
+*  BSD 2-Clause “Simplified” License
+*  Copyright (c) 2019, Aldrik Ramaekers, aldrik.ramaekers@protonmail.com
+*  All rights reserved.
+*/
+
+static char *search_cache_copy_string(char *string)
+{
+	if (!string) string = "";
+	
+	s32 length = strlen(string);
+	char *result = mem_alloc(length + 1);
+	string_copyn(result, string, length + 1);
+	return result;
+}
+
+static u32 search_cache_hash(char *path)
+{
+	// fnv-1a
+	u32 hash = 2166136261u;
+	for (; *path; path++)
+	{
+		hash ^= (u8)*path;
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+search_cache_key search_cache_key_create(search_result *result, bool ignore_case)
+{
+	search_cache_key key;
+	key.directory_to_search = result->directory_to_search;
+	key.file_filter = result->file_filter;
+	key.text_to_find = result->text_to_find;
+	key.is_recursive = result->is_recursive;
+	key.ignore_case = ignore_case;
+	key.is_regex = result->is_regex;
+	key.binary_mode = result->binary_mode;
+	return key;
+}
+
+static bool search_cache_key_equals(search_cache_key *a, search_cache_key *b)
+{
+	return strcmp(a->directory_to_search, b->directory_to_search ? b->directory_to_search : "") == 0 &&
+		strcmp(a->file_filter, b->file_filter ? b->file_filter : "") == 0 &&
+		strcmp(a->text_to_find, b->text_to_find ? b->text_to_find : "") == 0 &&
+		a->is_recursive == b->is_recursive &&
+		a->ignore_case == b->ignore_case &&
+		a->is_regex == b->is_regex &&
+		a->binary_mode == b->binary_mode;
+}
+
+static s64 search_cache_file_size(search_cache_file *file)
+{
+	s64 size = sizeof(search_cache_file) + strlen(file->path) + 1;
+	size += file->match_count * sizeof(search_cache_match);
+	for (s32 i = 0; i < file->match_count; i++)
+	{
+		if (file->matches[i].line_copy) size += strlen(file->matches[i].line_copy) + 1;
+	}
+	return size;
+}
+
+static void search_cache_free_file(search_cache_file *file)
+{
+	for (s32 i = 0; i < file->match_count; i++)
+	{
+		if (file->matches[i].line_copy) mem_free(file->matches[i].line_copy);
+	}
+	if (file->matches) mem_free(file->matches);
+	mem_free(file->path);
+}
+
+static search_cache_file *search_cache_files(search_cache_entry *entry)
+{
+	return (search_cache_file*)entry->files.data;
+}
+
+static void search_cache_rebuild_table(search_cache_entry *entry)
+{
+	if (entry->file_table) mem_free(entry->file_table);
+	
+	// table is kept at most half full
+	entry->file_table_size = 64;
+	while (entry->file_table_size < (entry->files.length + 1) * 2) entry->file_table_size *= 2;
+	entry->file_table = mem_alloc(sizeof(s32)*entry->file_table_size);
+	memset(entry->file_table, 0xFF, sizeof(s32)*entry->file_table_size);
+	
+	u32 mask = entry->file_table_size - 1;
+	for (s32 i = 0; i < entry->files.length; i++)
+	{
+		u32 slot = search_cache_hash(search_cache_files(entry)[i].path) & mask;
+		while (entry->file_table[slot] != -1) slot = (slot + 1) & mask;
+		entry->file_table[slot] = i;
+	}
+}
+
+static s32 search_cache_find_file(search_cache_entry *entry, char *path)
+{
+	u32 mask = entry->file_table_size - 1;
+	for (u32 slot = search_cache_hash(path) & mask; entry->file_table[slot] != -1; slot = (slot + 1) & mask)
+	{
+		s32 index = entry->file_table[slot];
+		if (strcmp(search_cache_files(entry)[index].path, path) == 0) return index;
+	}
+	return -1;
+}
+
+static void search_cache_add_file(search_cache *cache, search_cache_entry *entry, search_cache_file *file)
+{
+	s64 size = search_cache_file_size(file);
+	entry->size += size;
+	cache->size += size;
+	
+	s32 index = search_cache_find_file(entry, file->path);
+	if (index != -1)
+	{
+		search_cache_file *old = &search_cache_files(entry)[index];
+		size = search_cache_file_size(old);
+		entry->size -= size;
+		cache->size -= size;
+		search_cache_free_file(old);
+		*old = *file;
+		return;
+	}
+	
+	array_push(&entry->files, file);
+	if (entry->files.length * 2 > entry->file_table_size)
+	{
+		search_cache_rebuild_table(entry);
+		return;
+	}
+	
+	u32 mask = entry->file_table_size - 1;
+	u32 slot = search_cache_hash(file->path) & mask;
+	while (entry->file_table[slot] != -1) slot = (slot + 1) & mask;
+	entry->file_table[slot] = entry->files.length - 1;
+}
+
+static search_cache_entry *search_cache_create_entry(search_cache_key *key)
+{
+	search_cache_entry *entry = mem_alloc(sizeof(search_cache_entry));
+	entry->key.directory_to_search = search_cache_copy_string(key->directory_to_search);
+	entry->key.file_filter = search_cache_copy_string(key->file_filter);
+	entry->key.text_to_find = search_cache_copy_string(key->text_to_find);
+	entry->key.is_recursive = key->is_recursive;
+	entry->key.ignore_case = key->ignore_case;
+	entry->key.is_regex = key->is_regex;
+	entry->key.binary_mode = key->binary_mode;
+	entry->files = array_create(sizeof(search_cache_file));
+	entry->files.reserve_jump = 1000;
+	entry->file_table = 0;
+	search_cache_rebuild_table(entry);
+	entry->size = sizeof(search_cache_entry);
+	entry->run = 0;
+	entry->users = 0;
+	entry->previous = 0;
+	entry->next = 0;
+	return entry;
+}
+
+static void search_cache_destroy_entry(search_cache_entry *entry)
+{
+	for (s32 i = 0; i < entry->files.length; i++)
+	{
+		search_cache_free_file(&search_cache_files(entry)[i]);
+	}
+	array_destroy(&entry->files);
+	mem_free(entry->file_table);
+	mem_free(entry->key.directory_to_search);
+	mem_free(entry->key.file_filter);
+	mem_free(entry->key.text_to_find);
+	mem_free(entry);
+}
+
+static void search_cache_unlink(search_cache *cache, search_cache_entry *entry)
+{
+	if (entry->previous) entry->previous->next = entry->next;
+	else cache->first = entry->next;
+	if (entry->next) entry->next->previous = entry->previous;
+	else cache->last = entry->previous;
+	
+	entry->previous = 0;
+	entry->next = 0;
+}
+
+static void search_cache_link_first(search_cache *cache, search_cache_entry *entry)
+{
+	entry->previous = 0;
+	entry->next = cache->first;
+	if (cache->first) cache->first->previous = entry;
+	else cache->last = entry;
+	cache->first = entry;
+}
+
+static void search_cache_evict(search_cache *cache)
+{
+	search_cache_entry *entry = cache->last;
+	while (entry && cache->size > cache->max_size)
+	{
+		search_cache_entry *previous = entry->previous;
+		if (!entry->users)
+		{
+			search_cache_unlink(cache, entry);
+			cache->size -= entry->size;
+			search_cache_destroy_entry(entry);
+		}
+		entry = previous;
+	}
+}
+
+search_cache search_cache_create(s64 max_size)
+{
+	search_cache cache;
+	cache.mutex = mutex_create();
+	cache.first = 0;
+	cache.last = 0;
+	cache.size = 0;
+	cache.max_size = max_size;
+	return cache;
+}
+
+void search_cache_destroy(search_cache *cache)
+{
+	search_cache_entry *entry = cache->first;
+	while (entry)
+	{
+		search_cache_entry *next = entry->next;
+		search_cache_destroy_entry(entry);
+		entry = next;
+	}
+	cache->first = 0;
+	cache->last = 0;
+	cache->size = 0;
+	mutex_destroy(&cache->mutex);
+}
+
+search_cache_entry *search_cache_begin(search_cache *cache, search_cache_key *key)
+{
+	mutex_lock(&cache->mutex);
+	
+	search_cache_entry *entry = cache->first;
+	while (entry && !search_cache_key_equals(&entry->key, key)) entry = entry->next;
+	
+	if (entry)
+	{
+		search_cache_unlink(cache, entry);
+	}
+	else
+	{
+		entry = search_cache_create_entry(key);
+		cache->size += entry->size;
+	}
+	search_cache_link_first(cache, entry);
+	
+	entry->users++;
+	entry->run++;
+	
+	mutex_unlock(&cache->mutex);
+	
+	return entry;
+}
+
+bool search_cache_get_file(search_cache *cache, search_cache_entry *entry, found_file *file, file_info *info, array *matches, memory_bucket *bucket)
+{
+	if (!platform_get_file_info(file->path, info))
+	{
+		memset(info, 0, sizeof(file_info));
+		return false;
+	}
+	
+	mutex_lock(&cache->mutex);
+	
+	s32 index = search_cache_find_file(entry, file->path);
+	search_cache_file *cached = index == -1 ? 0 : &search_cache_files(entry)[index];
+	if (!cached || cached->info.size != info->size || cached->info.mtime != info->mtime ||
+		cached->info.inode != info->inode || cached->info.device != info->device)
+	{
+		mutex_unlock(&cache->mutex);
+		return false;
+	}
+	
+	cached->run = entry->run;
+	for (s32 i = 0; i < cached->match_count; i++)
+	{
+		search_cache_match *match = &cached->matches[i];
+		
+		file_match new_match;
+		new_match.file = *file;
+		new_match.file_error = 0;
+		new_match.file_size = cached->file_size;
+		new_match.line_nr = match->line_nr;
+		new_match.line_length = match->line_length;
+		new_match.line_offset = match->line_offset;
+		new_match.match_count = 0;
+		new_match.word_match_offset = match->word_match_offset;
+		new_match.word_match_length = match->word_match_length;
+		new_match.word_match_offset_x = 0;
+		new_match.word_match_width = 0;
+		new_match.line_copy = 0;
+		if (match->line_copy)
+		{
+			s32 length = strlen(match->line_copy);
+			new_match.line_copy = bucket ? memory_bucket_reserve(bucket, length + 1) : mem_alloc(length + 1);
+			string_copyn(new_match.line_copy, match->line_copy, length + 1);
+		}
+		array_push(matches, &new_match);
+	}
+	
+	mutex_unlock(&cache->mutex);
+	
+	return true;
+}
+
+void search_cache_put_file(search_cache *cache, search_cache_entry *entry, found_file *file, file_info *info, file_match *matches, s32 match_count)
+{
+	// copied outside of the lock
+	search_cache_file cached;
+	cached.path = search_cache_copy_string(file->path);
+	cached.info = *info;
+	cached.file_size = match_count ? matches[0].file_size : info->size;
+	cached.match_count = match_count;
+	cached.matches = match_count ? mem_alloc(sizeof(search_cache_match)*match_count) : 0;
+	for (s32 i = 0; i < match_count; i++)
+	{
+		cached.matches[i].line_nr = matches[i].line_nr;
+		cached.matches[i].word_match_offset = matches[i].word_match_offset;
+		cached.matches[i].word_match_length = matches[i].word_match_length;
+		cached.matches[i].line_length = matches[i].line_length;
+		cached.matches[i].line_offset = matches[i].line_offset;
+		cached.matches[i].line_copy = matches[i].line_copy ? search_cache_copy_string(matches[i].line_copy) : 0;
+	}
+	
+	mutex_lock(&cache->mutex);
+	cached.run = entry->run;
+	search_cache_add_file(cache, entry, &cached);
+	mutex_unlock(&cache->mutex);
+}
+
+void search_cache_end(search_cache *cache, search_cache_entry *entry, bool completed)
+{
+	mutex_lock(&cache->mutex);
+	
+	// files that were not seen by a complete search are deleted or filtered out
+	if (completed)
+	{
+		search_cache_file *files = search_cache_files(entry);
+		s32 kept = 0;
+		for (s32 i = 0; i < entry->files.length; i++)
+		{
+			if (files[i].run == entry->run)
+			{
+				files[kept++] = files[i];
+				continue;
+			}
+			
+			s64 size = search_cache_file_size(&files[i]);
+			entry->size -= size;
+			cache->size -= size;
+			search_cache_free_file(&files[i]);
+		}
+		
+		if (kept != entry->files.length)
+		{
+			entry->files.length = kept;
+			search_cache_rebuild_table(entry);
+		}
+	}
+	
+	entry->users--;
+	search_cache_evict(cache);
+	
+	mutex_unlock(&cache->mutex);
+}
+
+static bool search_cache_write_string(FILE *file, char *string)
+{
+	s32 length = string ? strlen(string) : -1;
+	if (fwrite(&length, sizeof(length), 1, file) != 1) return false;
+	return length <= 0 || fwrite(string, 1, length, file) == length;
+}
+
+bool search_cache_save(search_cache *cache, char *path)
+{
+	FILE *file = fopen(path, "wb");
+	if (!file) return false;
+	
+	mutex_lock(&cache->mutex);
+	
+	u32 header[3] = { SEARCH_CACHE_MAGIC, SEARCH_CACHE_VERSION, 0 };
+	for (search_cache_entry *entry = cache->first; entry; entry = entry->next) header[2]++;
+	bool result = fwrite(header, sizeof(header), 1, file) == 1;
+	
+	// least recently used first so loading restores the order
+	for (search_cache_entry *entry = cache->last; entry && result; entry = entry->previous)
+	{
+		u32 key[5] = { entry->key.is_recursive, entry->key.ignore_case, entry->key.is_regex, entry->key.binary_mode, entry->files.length };
+		result &= search_cache_write_string(file, entry->key.directory_to_search);
+		result &= search_cache_write_string(file, entry->key.file_filter);
+		result &= search_cache_write_string(file, entry->key.text_to_find);
+		result &= fwrite(key, sizeof(key), 1, file) == 1;
+		
+		for (s32 i = 0; i < entry->files.length && result; i++)
+		{
+			search_cache_file *cached = &search_cache_files(entry)[i];
+			u64 info[4] = { cached->info.size, cached->info.mtime, cached->info.device, cached->info.inode };
+			s32 counts[2] = { cached->file_size, cached->match_count };
+			result &= search_cache_write_string(file, cached->path);
+			result &= fwrite(info, sizeof(info), 1, file) == 1;
+			result &= fwrite(counts, sizeof(counts), 1, file) == 1;
+			
+			for (s32 m = 0; m < cached->match_count && result; m++)
+			{
+				search_cache_match *match = &cached->matches[m];
+				s32 values[4] = { match->line_nr, match->word_match_offset, match->word_match_length, match->line_length };
+				result &= fwrite(values, sizeof(values), 1, file) == 1;
+				result &= fwrite(&match->line_offset, sizeof(match->line_offset), 1, file) == 1;
+				result &= search_cache_write_string(file, match->line_copy);
+			}
+		}
+	}
+	
+	mutex_unlock(&cache->mutex);
+	
+	result &= fclose(file) == 0;
+	if (!result) platform_delete_file(path);
+	
+	return result;
+}
+
+typedef struct t_search_cache_reader
+{
+	u8 *cursor;
+	u8 *end;
+	bool valid;
+} search_cache_reader;
+
+static bool search_cache_read(search_cache_reader *reader, void *buffer, s64 size)
+{
+	if (!reader->valid || reader->end - reader->cursor < size)
+	{
+		reader->valid = false;
+		memset(buffer, 0, size);
+		return false;
+	}
+	
+	memcpy(buffer, reader->cursor, size);
+	reader->cursor += size;
+	return true;
+}
+
+// returns 0 for a null string or when the data ends
+static char *search_cache_read_string(search_cache_reader *reader)
+{
+	s32 length;
+	if (!search_cache_read(reader, &length, sizeof(length)) || length < 0) return 0;
+	if (reader->end - reader->cursor < length)
+	{
+		reader->valid = false;
+		return 0;
+	}
+	
+	char *result = mem_alloc(length + 1);
+	memcpy(result, reader->cursor, length);
+	result[length] = 0;
+	reader->cursor += length;
+	return result;
+}
+
+static search_cache_entry *search_cache_read_entry(search_cache_reader *reader)
+{
+	search_cache_key key;
+	key.directory_to_search = search_cache_read_string(reader);
+	key.file_filter = search_cache_read_string(reader);
+	key.text_to_find = search_cache_read_string(reader);
+	
+	u32 values[5];
+	search_cache_read(reader, values, sizeof(values));
+	key.is_recursive = values[0];
+	key.ignore_case = values[1];
+	key.is_regex = values[2];
+	key.binary_mode = values[3];
+	
+	search_cache_entry *entry = search_cache_create_entry(&key);
+	if (key.directory_to_search) mem_free(key.directory_to_search);
+	if (key.file_filter) mem_free(key.file_filter);
+	if (key.text_to_find) mem_free(key.text_to_find);
+	
+	// every file takes more than 40 bytes, a count above that is corrupt
+	if (values[4] > (reader->end - reader->cursor) / 40) reader->valid = false;
+	
+	for (u32 i = 0; i < values[4] && reader->valid; i++)
+	{
+		search_cache_file cached;
+		cached.path = search_cache_read_string(reader);
+		
+		u64 info[4];
+		s32 counts[2];
+		search_cache_read(reader, info, sizeof(info));
+		search_cache_read(reader, counts, sizeof(counts));
+		cached.info.size = info[0];
+		cached.info.mtime = info[1];
+		cached.info.device = info[2];
+		cached.info.inode = info[3];
+		cached.info.is_directory = false;
+		cached.file_size = counts[0];
+		cached.match_count = 0;
+		cached.matches = 0;
+		cached.run = 0;
+		
+		if (!cached.path || counts[1] < 0 || counts[1] > (reader->end - reader->cursor) / 28)
+			reader->valid = false;
+		
+		if (reader->valid && counts[1])
+		{
+			cached.matches = mem_alloc(sizeof(search_cache_match)*counts[1]);
+			for (s32 m = 0; m < counts[1]; m++)
+			{
+				s32 match_values[4];
+				search_cache_read(reader, match_values, sizeof(match_values));
+				cached.matches[m].line_nr = match_values[0];
+				cached.matches[m].word_match_offset = match_values[1];
+				cached.matches[m].word_match_length = match_values[2];
+				cached.matches[m].line_length = match_values[3];
+				search_cache_read(reader, &cached.matches[m].line_offset, sizeof(cached.matches[m].line_offset));
+				cached.matches[m].line_copy = search_cache_read_string(reader);
+				cached.match_count++;
+			}
+		}
+		
+		if (!cached.path) break;
+		if (!reader->valid)
+		{
+			search_cache_free_file(&cached);
+			break;
+		}
+		
+		entry->size += search_cache_file_size(&cached);
+		array_push(&entry->files, &cached);
+	}
+	search_cache_rebuild_table(entry);
+	
+	if (!reader->valid)
+	{
+		search_cache_destroy_entry(entry);
+		return 0;
+	}
+	return entry;
+}
+
+bool search_cache_load(search_cache *cache, char *path)
+{
+	file_content content = platform_read_file_content(path, "rb");
+	if (!content.content) return false;
+	
+	search_cache_reader reader;
+	reader.cursor = content.content;
+	reader.end = reader.cursor + content.content_length;
+	reader.valid = true;
+	
+	u32 header[3];
+	search_cache_read(&reader, header, sizeof(header));
+	if (header[0] != SEARCH_CACHE_MAGIC || header[1] != SEARCH_CACHE_VERSION)
+		reader.valid = false;
+	
+	mutex_lock(&cache->mutex);
+	for (u32 i = 0; i < header[2] && reader.valid; i++)
+	{
+		search_cache_entry *entry = search_cache_read_entry(&reader);
+		if (!entry) break;
+		
+		// entries already in the cache are newer
+		search_cache_entry *existing = cache->first;
+		while (existing && !search_cache_key_equals(&existing->key, &entry->key)) existing = existing->next;
+		if (existing)
+		{
+			search_cache_destroy_entry(entry);
+			continue;
+		}
+		
+		search_cache_link_first(cache, entry);
+		cache->size += entry->size;
+	}
+	search_cache_evict(cache);
+	mutex_unlock(&cache->mutex);
+	
+	platform_destroy_file_content(&content);
+	
+	return reader.valid;
+}
\ No newline at end of file
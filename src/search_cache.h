@@ -0,0 +1,88 @@
+/* 
+*  BSD 2-Clause “Simplified” License
+*  Copyright (c) 2019, Aldrik Ramaekers, aldrik.ramaekers@protonmail.com
+*  All rights reserved.
+*/
+
+#ifndef INCLUDE_SEARCH_CACHE
+#define INCLUDE_SEARCH_CACHE
+
+#define SEARCH_CACHE_MAGIC 0x48435253 // "SRCH"
+#define SEARCH_CACHE_VERSION 3
+
+typedef struct t_search_cache_key
+{
+	char *directory_to_search;
+	char *file_filter;
+	char *text_to_find;
+	bool is_recursive;
+	bool ignore_case;
+	bool is_regex;
+	binary_file_mode binary_mode;
+} search_cache_key;
+
+typedef struct t_search_cache_match
+{
+	u32 line_nr;
+	s32 word_match_offset;
+	s32 word_match_length;
+	s32 line_length;
+	s64 line_offset; // lines are read from the file, it did not change when the match is used
+	char *line_copy; // gzip lines
+} search_cache_match;
+
+typedef struct t_search_cache_file
+{
+	char *path;
+	file_info info; // validators, the file is searched again when any of them changed
+	s32 file_size;
+	s32 match_count;
+	search_cache_match *matches;
+	u32 run; // last search that saw the file
+} search_cache_file;
+
+typedef struct t_search_cache_entry
+{
+	search_cache_key key;
+	array files; // search_cache_file
+	s32 *file_table; // open addressing table of indices into files, -1 when empty
+	s32 file_table_size; // power of 2
+	s64 size; // bytes used by the entry
+	u32 run;
+	s32 users; // searches using the entry, it is not evicted while used
+	struct t_search_cache_entry *previous; // more recently used
+	struct t_search_cache_entry *next; // less recently used
+} search_cache_entry;
+
+typedef struct t_search_cache
+{
+	mutex mutex;
+	search_cache_entry *first; // most recently used
+	search_cache_entry *last;
+	s64 size;
+	s64 max_size; // bytes, least recently used entries are evicted above this
+} search_cache;
+
+search_cache_key search_cache_key_create(search_result *result, bool ignore_case);
+
+search_cache search_cache_create(s64 max_size);
+void search_cache_destroy(search_cache *cache);
+
+// A search starts with search_cache_begin and ends with search_cache_end,
+// completed is false when the search was cancelled. For every file
+// search_cache_get_file returns true when the file did not change since it was
+// last searched and appends its matches, with line_copy copied into bucket. Other
+// files are searched and stored with search_cache_put_file using the info that
+// search_cache_get_file filled in, so a change during the search is noticed next
+// time. Both can be called from any number of threads.
+search_cache_entry *search_cache_begin(search_cache *cache, search_cache_key *key);
+bool search_cache_get_file(search_cache *cache, search_cache_entry *entry, found_file *file, file_info *info, array *matches, memory_bucket *bucket);
+void search_cache_put_file(search_cache *cache, search_cache_entry *entry, found_file *file, file_info *info, file_match *matches, s32 match_count);
+void search_cache_end(search_cache *cache, search_cache_entry *entry, bool completed);
+
+// entries are written to and read from disk with their validators, loaded
+// entries are checked against the file system like any other entry.
+bool search_cache_save(search_cache *cache, char *path);
+bool search_cache_load(search_cache *cache, char *path);
+
+#endif
\ No newline at end of file
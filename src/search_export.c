@@ -0,0 +1,366 @@
+/* 
+*  BSD 2-Clause “Simplified” License
+*  Copyright (c) 2019, Aldrik Ramaekers, aldrik.ramaekers@protonmail.com
+*  All rights reserved.
+*/
+
+static void search_export_flush(search_export *exporter)
+{
+	if (exporter->buffer_length && !exporter->failed)
+	{
+		if (fwrite(exporter->buffer, 1, exporter->buffer_length, exporter->file) != exporter->buffer_length)
+			exporter->failed = true;
+	}
+	exporter->buffer_length = 0;
+}
+
+static void search_export_write(search_export *exporter, void *data, s32 length)
+{
+	if (!length) return;
+	
+	if (exporter->buffer_length + length > SEARCH_EXPORT_BUFFER_SIZE)
+	{
+		search_export_flush(exporter);
+		
+		// too big for the buffer, written directly
+		if (length > SEARCH_EXPORT_BUFFER_SIZE)
+		{
+			if (!exporter->failed && fwrite(data, 1, length, exporter->file) != length)
+				exporter->failed = true;
+			return;
+		}
+	}
+	
+	memcpy(exporter->buffer + exporter->buffer_length, data, length);
+	exporter->buffer_length += length;
+}
+
+#define search_export_write_literal(_exporter, _text) search_export_write(_exporter, _text, sizeof(_text)-1)
+
+static void search_export_write_number(search_export *exporter, s64 number)
+{
+	char text[24];
+	s32 length = snprintf(text, sizeof(text), "%lld", (long long)number);
+	search_export_write(exporter, text, length);
+}
+
+// bytes that are not valid utf8 are written as U+FFFD, json has no way to
+// represent them
+static void search_export_write_json_string(search_export *exporter, char *string, s32 length)
+{
+	static const char hex[] = "0123456789abcdef";
+	
+	search_export_write_literal(exporter, "\"");
+	
+	u8 *text = (u8*)string;
+	u8 *end = text + length;
+	u8 *start = text;
+	while (text < end)
+	{
+		u8 ch = *text;
+		if (ch >= 0x20 && ch != '"' && ch != '\\' && ch < 0x80)
+		{
+			text++;
+			continue;
+		}
+		
+		s32 sequence_length = 0;
+		if (ch >= 0xC2 && ch <= 0xDF) sequence_length = 2;
+		else if (ch >= 0xE0 && ch <= 0xEF) sequence_length = 3;
+		else if (ch >= 0xF0 && ch <= 0xF4) sequence_length = 4;
+		
+		if (sequence_length)
+		{
+			s32 i = 1;
+			while (i < sequence_length && text + i < end && (text[i] & 0xC0) == 0x80) i++;
+			if (i == sequence_length)
+			{
+				text += sequence_length;
+				continue;
+			}
+		}
+		
+		search_export_write(exporter, start, text - start);
+		
+		if (ch == '"') search_export_write_literal(exporter, "\\\"");
+		else if (ch == '\\') search_export_write_literal(exporter, "\\\\");
+		else if (ch == '\n') search_export_write_literal(exporter, "\\n");
+		else if (ch == '\r') search_export_write_literal(exporter, "\\r");
+		else if (ch == '\t') search_export_write_literal(exporter, "\\t");
+		else if (ch < 0x20)
+		{
+			char escaped[6] = { '\\', 'u', '0', '0', hex[ch >> 4], hex[ch & 15] };
+			search_export_write(exporter, escaped, sizeof(escaped));
+		}
+		else search_export_write_literal(exporter, "\xEF\xBF\xBD");
+		
+		text++;
+		start = text;
+	}
+	
+	search_export_write(exporter, start, text - start);
+	search_export_write_literal(exporter, "\"");
+}
+
+static void search_export_json_record(search_export *exporter, file_match *match)
+{
+	char *path = match->file.path ? match->file.path : "";
+	search_export_write_literal(exporter, "{\"path\":");
+	search_export_write_json_string(exporter, path, strlen(path));
+	
+	if (match->file_error)
+	{
+		search_export_write_literal(exporter, ",\"error\":");
+		search_export_write_number(exporter, match->file_error);
+	}
+	else if (exporter->mode == SEARCH_MODE_COUNT)
+	{
+		search_export_write_literal(exporter, ",\"count\":");
+		search_export_write_number(exporter, match->match_count);
+	}
+	else if (exporter->mode == SEARCH_MODE_MATCHES)
+	{
+		search_export_write_literal(exporter, ",\"line\":");
+		search_export_write_number(exporter, match->line_nr);
+		search_export_write_literal(exporter, ",\"offset\":");
+		search_export_write_number(exporter, match->word_match_offset);
+		search_export_write_literal(exporter, ",\"length\":");
+		search_export_write_number(exporter, match->word_match_length);
+		
+		s32 length;
+		char *line = match_text_get_line(&exporter->text, match, &length);
+		if (line)
+		{
+			search_export_write_literal(exporter, ",\"text\":");
+			search_export_write_json_string(exporter, line, length);
+		}
+	}
+	
+	search_export_write_literal(exporter, "}\n");
+}
+
+static void search_export_binary_record(search_export *exporter, file_match *match)
+{
+	char *path = match->file.path ? match->file.path : "";
+	
+	// matches of a file are found together, the path is usually the same pointer
+	if (!exporter->last_path || (path != exporter->last_path && strcmp(path, exporter->last_path) != 0))
+	{
+		u8 type = SEARCH_EXPORT_RECORD_FILE;
+		u32 length = strlen(path);
+		search_export_write(exporter, &type, sizeof(type));
+		search_export_write(exporter, &length, sizeof(length));
+		search_export_write(exporter, path, length);
+	}
+	exporter->last_path = path;
+	
+	if (match->file_error)
+	{
+		u8 type = SEARCH_EXPORT_RECORD_ERROR;
+		search_export_write(exporter, &type, sizeof(type));
+		search_export_write(exporter, &match->file_error, sizeof(match->file_error));
+	}
+	else if (exporter->mode == SEARCH_MODE_COUNT)
+	{
+		u8 type = SEARCH_EXPORT_RECORD_COUNT;
+		search_export_write(exporter, &type, sizeof(type));
+		search_export_write(exporter, &match->match_count, sizeof(match->match_count));
+	}
+	else if (exporter->mode == SEARCH_MODE_MATCHES)
+	{
+		s32 length;
+		char *line = match_text_get_line(&exporter->text, match, &length);
+		if (!line) length = 0;
+		
+		u8 type = SEARCH_EXPORT_RECORD_MATCH;
+		u32 values[4] = { match->line_nr, match->word_match_offset, match->word_match_length, length };
+		search_export_write(exporter, &type, sizeof(type));
+		search_export_write(exporter, values, sizeof(values));
+		search_export_write(exporter, line, length);
+	}
+}
+
+static void search_export_text_record(search_export *exporter, file_match *match)
+{
+	if (match->file_error) return;
+	
+	char *path = match->file.path ? match->file.path : "";
+	bool same_file = exporter->last_path && (path == exporter->last_path || strcmp(path, exporter->last_path) == 0);
+	
+	if (exporter->mode == SEARCH_MODE_FILES_WITH_MATCHES)
+	{
+		search_export_write(exporter, path, strlen(path));
+		search_export_write_literal(exporter, "\n");
+	}
+	else if (exporter->mode == SEARCH_MODE_COUNT)
+	{
+		search_export_write(exporter, path, strlen(path));
+		search_export_write_literal(exporter, ":");
+		search_export_write_number(exporter, match->match_count);
+		search_export_write_literal(exporter, "\n");
+	}
+	else if (!match_text_has_line(match))
+	{
+		if (!same_file)
+		{
+			search_export_write_literal(exporter, "Binary file ");
+			search_export_write(exporter, path, strlen(path));
+			search_export_write_literal(exporter, " matches\n");
+		}
+	}
+	else if (!same_file || match->line_nr != exporter->last_line_nr)
+	{
+		s32 length;
+		char *line = match_text_get_line(&exporter->text, match, &length);
+		
+		search_export_write(exporter, path, strlen(path));
+		search_export_write_literal(exporter, ":");
+		search_export_write_number(exporter, match->line_nr);
+		search_export_write_literal(exporter, ":");
+		if (line) search_export_write(exporter, line, length);
+		search_export_write_literal(exporter, "\n");
+	}
+	
+	exporter->last_path = path;
+	exporter->last_line_nr = match->line_nr;
+}
+
+static void *search_export_thread(void *arg)
+{
+	search_export *exporter = arg;
+	
+	if (exporter->format == SEARCH_EXPORT_BINARY)
+	{
+		u32 header[2] = { SEARCH_EXPORT_MAGIC, SEARCH_EXPORT_VERSION };
+		search_export_write(exporter, header, sizeof(header));
+	}
+	
+	u32 exported = 0;
+	while (!__atomic_load_n(&exporter->cancel, __ATOMIC_RELAXED) && !exporter->failed)
+	{
+		// finish is read before the length so matches added before it was set are seen
+		bool finish = __atomic_load_n(&exporter->finish, __ATOMIC_ACQUIRE);
+		u32 length = match_list_length(exporter->matches);
+		
+		for (; exported < length && !__atomic_load_n(&exporter->cancel, __ATOMIC_RELAXED); exported++)
+		{
+			file_match *match = match_list_at(exporter->matches, exported);
+			if (exporter->format == SEARCH_EXPORT_JSON_LINES)
+				search_export_json_record(exporter, match);
+			else if (exporter->format == SEARCH_EXPORT_TEXT)
+				search_export_text_record(exporter, match);
+			else
+				search_export_binary_record(exporter, match);
+		}
+		__atomic_store_n(&exporter->exported_count, exported, __ATOMIC_RELAXED);
+		
+		if (finish && exported == length) break;
+		
+		// the buffer is written when the search is slow so the file keeps up
+		if (exported == length)
+		{
+			search_export_flush(exporter);
+			thread_sleep(SEARCH_EXPORT_POLL_US);
+		}
+	}
+	
+	search_export_flush(exporter);
+	match_text_destroy(&exporter->text);
+	if (exporter->path)
+	{
+		if (fclose(exporter->file) != 0) exporter->failed = true;
+		if (exporter->cancel || exporter->failed) platform_delete_file(exporter->path);
+	}
+	else if (fflush(exporter->file) != 0) exporter->failed = true;
+	exporter->file = 0;
+	
+	__atomic_store_n(&exporter->done, true, __ATOMIC_RELEASE);
+	return 0;
+}
+
+static search_export *search_export_create(search_export_format format, search_mode mode, match_list *matches)
+{
+	search_export *exporter = mem_alloc(sizeof(search_export));
+	exporter->path = 0;
+	exporter->format = format;
+	exporter->mode = mode;
+	exporter->matches = matches;
+	exporter->finish = false;
+	exporter->cancel = false;
+	exporter->done = false;
+	exporter->failed = false;
+	exporter->exported_count = 0;
+	exporter->buffer = 0;
+	exporter->buffer_length = 0;
+	exporter->last_path = 0;
+	exporter->last_line_nr = 0;
+	exporter->text = match_text_create();
+	exporter->file = 0;
+	exporter->thread.valid = false;
+	return exporter;
+}
+
+static void search_export_start_thread(search_export *exporter)
+{
+	if (!exporter->file)
+	{
+		exporter->failed = true;
+		exporter->done = true;
+		return;
+	}
+	
+	exporter->buffer = mem_alloc(SEARCH_EXPORT_BUFFER_SIZE);
+	exporter->thread = thread_start(search_export_thread, exporter);
+}
+
+search_export *search_export_start(char *path, search_export_format format, search_mode mode, match_list *matches)
+{
+	search_export *exporter = search_export_create(format, mode, matches);
+	exporter->path = mem_alloc(strlen(path)+1);
+	strcpy(exporter->path, path);
+	exporter->file = fopen(path, "wb");
+	search_export_start_thread(exporter);
+	
+	return exporter;
+}
+
+search_export *search_export_start_stream(FILE *file, search_export_format format, search_mode mode, match_list *matches)
+{
+	search_export *exporter = search_export_create(format, mode, matches);
+	exporter->file = file;
+	search_export_start_thread(exporter);
+	
+	return exporter;
+}
+
+void search_export_finish(search_export *exporter)
+{
+	__atomic_store_n(&exporter->finish, true, __ATOMIC_RELEASE);
+}
+
+void search_export_cancel(search_export *exporter)
+{
+	__atomic_store_n(&exporter->cancel, true, __ATOMIC_RELAXED);
+}
+
+bool search_export_is_done(search_export *exporter)
+{
+	return __atomic_load_n(&exporter->done, __ATOMIC_ACQUIRE);
+}
+
+u32 search_export_progress(search_export *exporter)
+{
+	return __atomic_load_n(&exporter->exported_count, __ATOMIC_RELAXED);
+}
+
+bool search_export_destroy(search_export *exporter)
+{
+	if (exporter->thread.valid) thread_join(&exporter->thread);
+	
+	bool result = !exporter->failed && !exporter->cancel;
+	if (exporter->buffer) mem_free(exporter->buffer);
+	if (exporter->path) mem_free(exporter->path);
+	mem_free(exporter);
+	
+	return result;
+}
\ No newline at end of file
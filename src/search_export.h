@@ -0,0 +1,84 @@
+/* 
+*  BSD 2-Clause “Simplified” License
+*  Copyright (c) 2019, Aldrik Ramaekers, aldrik.ramaekers@protonmail.com
+*  All rights reserved.
+*/
+
+#ifndef INCLUDE_SEARCH_EXPORT
+#define INCLUDE_SEARCH_EXPORT
+
+// records are formatted into a buffer of this size and written with one call
+#define SEARCH_EXPORT_BUFFER_SIZE (1024*1024)
+// the export thread waits this long when no new matches were found
+#define SEARCH_EXPORT_POLL_US 2000
+
+#define SEARCH_EXPORT_MAGIC 0x58505345
+#define SEARCH_EXPORT_VERSION 2
+
+typedef enum t_search_export_format
+{
+	// one json object per line:
+	// {"path":"..","line":1,"offset":0,"length":3,"text":".."} or {"path":"..","error":1},
+	// {"path":".."} in SEARCH_MODE_FILES_WITH_MATCHES and {"path":"..","count":3} in
+	// SEARCH_MODE_COUNT
+	SEARCH_EXPORT_JSON_LINES,
+	// u32 magic, u32 version, followed by records starting with a type byte:
+	// SEARCH_EXPORT_RECORD_FILE: u32 length, path. following matches are in this file
+	// SEARCH_EXPORT_RECORD_MATCH: u32 line_nr, s32 offset, s32 length, u32 text length, text
+	// SEARCH_EXPORT_RECORD_ERROR: s16 file_error
+	// SEARCH_EXPORT_RECORD_COUNT: s64 matches in the file, instead of matches in SEARCH_MODE_COUNT
+	// file records are not followed by matches in SEARCH_MODE_FILES_WITH_MATCHES
+	SEARCH_EXPORT_BINARY,
+	// like grep: path:line:text, a line with several matches is written once and
+	// raw binary matches are written as "Binary file path matches". errors are left
+	// out, they are reported by the caller. only the path is written in
+	// SEARCH_MODE_FILES_WITH_MATCHES and path:count in SEARCH_MODE_COUNT.
+	SEARCH_EXPORT_TEXT,
+} search_export_format;
+
+#define SEARCH_EXPORT_RECORD_FILE 1
+#define SEARCH_EXPORT_RECORD_MATCH 2
+#define SEARCH_EXPORT_RECORD_ERROR 3
+#define SEARCH_EXPORT_RECORD_COUNT 4
+
+typedef struct t_search_export
+{
+	char *path; // 0 when writing to a stream
+	search_export_format format;
+	search_mode mode; // what the records in matches are
+	match_list *matches; // followed without locking
+	thread thread;
+	bool finish; // no more matches will be added to the list
+	bool cancel;
+	bool done;
+	bool failed;
+	u32 exported_count;
+	
+	// owned by the export thread
+	FILE *file;
+	char *buffer;
+	s32 buffer_length;
+	char *last_path;
+	u32 last_line_nr;
+	match_text text; // lines are read back from the files of the matches
+} search_export;
+
+// search_export_start writes every match added to matches to path on a background
+// thread, memory use does not depend on the number of matches. the list and the
+// strings it points to have to stay alive until search_export_destroy. the text of
+// a match is read from its file when the match is written, a line that is no
+// longer in the file is written without its text.
+search_export *search_export_start(char *path, search_export_format format, search_mode mode, match_list *matches);
+// same as search_export_start for a stream that is already open, like stdout. the
+// stream is flushed but not closed and nothing is deleted when the export fails.
+search_export *search_export_start_stream(FILE *file, search_export_format format, search_mode mode, match_list *matches);
+// called after the last match was added to the list, does not wait for the export
+void search_export_finish(search_export *exporter);
+// stops the export and deletes the file
+void search_export_cancel(search_export *exporter);
+bool search_export_is_done(search_export *exporter);
+u32 search_export_progress(search_export *exporter);
+// waits for the export thread, returns false when the file could not be written
+bool search_export_destroy(search_export *exporter);
+
+#endif
\ No newline at end of file
@@ -22,27 +22,12 @@ char *string_get_next(char *list, char *buffer, char seperator)
 
 bool string_match(char *first, char *second)
 {
-	// If we reach at the end of both strings, we are done 
-	if (*first == '\0' && *second == '\0') 
-		return true; 
-	
-	// Make sure that the characters after '*' are present 
-	// in second string. This function assumes that the first 
-	// string will not contain two consecutive '*' 
-	if (*first == '*' && *(first+1) != '\0' && *second == '\0') 
-		return false;
-	
-	// If the first string contains '?', or current characters 
-	// of both strings string_match
-	if (*first == '?' || *first == *second) 
-		return string_match(first+1, second+1);
-	
-	// If there is *, then there are two possibilities 
-	// a) We consider current character of second string 
-	// b) We ignore current character of second string. 
-	if (*first == '*') 
-		return string_match(first+1, second) || string_match(first, second+1); 
-	return false; 
+	// compiled every call, use file_filter_glob_create when matching a pattern more than once
+	file_filter_glob glob = file_filter_glob_create(first);
+	bool result = file_filter_glob_matches(&glob, second);
+	file_filter_glob_destroy(&glob);
+	
+	return result;
 }
 
 bool string_is_asteriks(char *text)
@@ -55,7 +40,37 @@ bool string_is_asteriks(char *text)
 	return true;
 }
 
+static bool string_contains_internal(char *text_to_search, char *text_to_find, array *text_matches, s64 *match_count, bool *cancel_search, bool ignore_case)
+{
+	// leading * wildcards are ignored by the matcher
+	char *query = text_to_find;
+	while (*query == '*') query++;
+	
+	// queries without wildcards don't need the codepoint matcher
+	if (text_search_is_literal(query))
+		return text_search_literal_ex(text_to_search, query, text_matches, match_count, cancel_search, ignore_case);
+	
+	return string_contains_wildcard_ex(text_to_search, text_to_find, text_matches, match_count, cancel_search, ignore_case);
+}
+
 bool string_contains_ex(char *text_to_search, char *text_to_find, array *text_matches, bool *cancel_search)
+{
+	return string_contains_internal(text_to_search, text_to_find, text_matches, 0, cancel_search, false);
+}
+
+bool string_contains_ignore_case(char *text_to_search, char *text_to_find, array *text_matches, bool *cancel_search)
+{
+	return string_contains_internal(text_to_search, text_to_find, text_matches, 0, cancel_search, true);
+}
+
+s64 string_count_matches(char *text_to_search, char *text_to_find, bool *cancel_search, bool ignore_case)
+{
+	s64 match_count = 0;
+	string_contains_internal(text_to_search, text_to_find, 0, &match_count, cancel_search, ignore_case);
+	return match_count;
+}
+
+bool string_contains_wildcard_ex(char *text_to_search, char *text_to_find, array *text_matches, s64 *match_count, bool *cancel_search, bool ignore_case)
 {
 	bool final_result = false;
 	bool is_asteriks_only = false;
@@ -81,23 +96,38 @@ bool string_contains_ex(char *text_to_search, char *text_to_find, array *text_ma
 	utf8_int32_t text_to_find_ch = 0;
 	size_t text_to_find_char_len = utf8len(text_to_find);
 	
-	s32 line_nr_val = 1;
-	s32 word_offset_val = 0;
 	s32 word_match_len_val = 0;
-	char* line_start_ptr = text_to_search;
 	
-	s32 index = 0;
-	while((text_to_search = utf8codepoint(text_to_search, &text_to_search_ch)) 
-		  && text_to_search_ch)
+	// line and column are only computed for matches
+	text_search_lines lines = text_search_lines_create(text_to_search);
+	char *match_start = text_to_search;
+	
+	// nothing can match before the next occurrence of the first character
+	// of text to find, skip to it when it is a single byte
+	char skip_set[4] = {0};
+	u8 first_byte = *text_to_find_original;
+	if (first_byte && first_byte < 0x80 && first_byte != '?')
 	{
-		if (cancel_search && *cancel_search) goto set_info_and_return_failure;
-		word_offset_val++;
-		if (text_to_search_ch == '\n') 
+		skip_set[0] = first_byte;
+		if (ignore_case && (u8)((first_byte|0x20) - 'a') < 26)
 		{
-			line_nr_val++;
-			word_offset_val = 0;
-			line_start_ptr = text_to_search;
+			skip_set[0] = first_byte|0x20;
+			skip_set[1] = first_byte&~0x20;
+			// kelvin sign folds to k
+			if (skip_set[0] == 'k') skip_set[2] = '\xE2';
 		}
+	}
+	
+	s32 index = 0;
+	while(1)
+	{
+		if (skip_set[0]) match_start += strcspn(match_start, skip_set);
+		
+		text_to_search = utf8codepoint(match_start, &text_to_search_ch);
+		if (!text_to_search_ch) break;
+		
+		if (cancel_search && *cancel_search) goto set_info_and_return_failure;
+		if (ignore_case) text_to_search_ch = text_search_fold_codepoint(text_to_search_ch);
 		
 		char *text_to_search_current_attempt = text_to_search;
 		utf8_int32_t text_to_search_current_attempt_ch = text_to_search_ch;
@@ -105,6 +135,7 @@ bool string_contains_ex(char *text_to_search, char *text_to_find, array *text_ma
 		bool in_wildcard = false;
 		
 		text_to_find = utf8codepoint(text_to_find, &text_to_find_ch);
+		if (ignore_case) text_to_find_ch = text_search_fold_codepoint(text_to_find_ch);
 		//text_to_search_current_attempt = utf8codepoint(text_to_search_current_attempt,
 		//&text_to_search_current_attempt_ch);
 		
@@ -125,6 +156,7 @@ bool string_contains_ex(char *text_to_search, char *text_to_find, array *text_ma
 			if (text_to_find_ch == '*')
 			{
 				text_to_find = utf8codepoint(text_to_find, &text_to_find_ch);
+				if (ignore_case) text_to_find_ch = text_search_fold_codepoint(text_to_find_ch);
 				in_wildcard = true;
 			}
 			
@@ -135,17 +167,17 @@ bool string_contains_ex(char *text_to_search, char *text_to_find, array *text_ma
 				if (save_info)
 				{
 					text_match new_match;
-					new_match.line_nr = line_nr_val;
-					new_match.word_offset = word_offset_val-1;
+					text_search_lines_locate(&lines, match_start, &new_match);
 					new_match.word_match_len = word_match_len_val;
-					new_match.line_start = line_start_ptr;
 					new_match.line_info = 0;
 					array_push(text_matches, &new_match);
 				}
+				if (match_count) (*match_count)++;
 				
 				final_result = true;
 				
-				if (is_asteriks_only)
+				// without match info only the first match is needed
+				if (is_asteriks_only || (!save_info && !match_count))
 				{
 					return final_result;
 				}
@@ -165,12 +197,19 @@ bool string_contains_ex(char *text_to_search, char *text_to_find, array *text_ma
 				text_to_search_current_attempt,
 				&text_to_search_current_attempt_ch);
 			
+			if (ignore_case)
+			{
+				text_to_find_ch = text_search_fold_codepoint(text_to_find_ch);
+				text_to_search_current_attempt_ch = text_search_fold_codepoint(text_to_search_current_attempt_ch);
+			}
+			
 			if (!text_to_search_current_attempt_ch && !text_to_find_ch) goto done;
 			
 			word_match_len_val++;
 		}
 		
 		text_to_find = text_to_find_original;
+		match_start = text_to_search;
 		index++;
 	}
 	
@@ -62,6 +62,10 @@ typedef struct t_text_match
 #define string_contains(big, small) string_contains_ex(big, small, 0, 0)
 bool string_match(char *first, char *second);
 bool string_contains_ex(char *big, char *small, array *text_matches, bool *cancel_search);
+bool string_contains_ignore_case(char *big, char *small, array *text_matches, bool *cancel_search);
+#define string_contains_wildcard(big, small, text_matches, cancel_search, ignore_case) string_contains_wildcard_ex(big, small, text_matches, 0, cancel_search, ignore_case)
+bool string_contains_wildcard_ex(char *big, char *small, array *text_matches, s64 *match_count, bool *cancel_search, bool ignore_case);
+s64 string_count_matches(char *big, char *small, bool *cancel_search, bool ignore_case);
 void string_trim(char *string);
 bool string_equals(char *first, char *second);
 s32 string_length(char *buffer);
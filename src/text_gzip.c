@@ -0,0 +1,431 @@
+/* 
+*  BSD 2-Clause “Simplified” License
+*  Copyright (c) 2019, Aldrik Ramaekers, aldrik.ramaekers@protonmail.com
+*  All rights reserved.
+*/
+
+#define TEXT_GZIP_FLAG_HCRC 2
+#define TEXT_GZIP_FLAG_EXTRA 4
+#define TEXT_GZIP_FLAG_NAME 8
+#define TEXT_GZIP_FLAG_COMMENT 16
+
+bool text_gzip_is_gzip(file_content *content)
+{
+	u8 *bytes = content->content;
+	return bytes && content->content_length >= 18 && bytes[0] == 0x1F && bytes[1] == 0x8B && bytes[2] == 8;
+}
+
+// byte position of the match, only needed on long lines. matches are in
+// ascending order so the codepoints are counted from the previous match.
+static char *text_gzip_match_position(text_gzip_state *state, text_match *match)
+{
+	if (match->word_offset <= 0) return match->line_start;
+	
+	if (state->walk_line != match->line_start || state->walk_column > match->word_offset)
+	{
+		state->walk_line = match->line_start;
+		state->walk_position = match->line_start;
+		state->walk_column = 0;
+	}
+	
+	utf8_int32_t ch;
+	while (state->walk_column < match->word_offset)
+	{
+		state->walk_position = utf8codepoint(state->walk_position, &ch);
+		state->walk_column++;
+	}
+	return state->walk_position;
+}
+
+static void text_gzip_report_matches(text_gzip_state *state)
+{
+	char *text_end = state->zbuf.zout;
+	for (s32 i = 0; i < state->chunk_matches.length; i++)
+	{
+		text_match *match = array_at(&state->chunk_matches, i);
+		match->line_nr += state->line_nr;
+		
+		// matches on the same line share the copy
+		if (match->line_start != state->last_line_start || state->last_line_long)
+		{
+			char *line_end = memchr(match->line_start, '\n', text_end - match->line_start);
+			if (!line_end) line_end = text_end;
+			bool long_line = line_end - match->line_start > TEXT_GZIP_LINE_COPY_SIZE;
+			
+			char *word = long_line ? text_gzip_match_position(state, match) : 0;
+			if (match->line_start != state->last_line_start || word < state->last_line || word >= state->last_line_end)
+			{
+				// of very long lines only a part around the match is copied
+				char *start = match->line_start;
+				char *end = line_end;
+				if (long_line)
+				{
+					if (word - start > TEXT_GZIP_LINE_COPY_SIZE/2) start = word - TEXT_GZIP_LINE_COPY_SIZE/2;
+					if (end - start > TEXT_GZIP_LINE_COPY_SIZE) end = start + TEXT_GZIP_LINE_COPY_SIZE;
+					while (start < word && (*start & 0xC0) == 0x80) start++;
+					while (end > word && (*end & 0xC0) == 0x80) end--;
+				}
+				
+				s32 length = end - start;
+				char *copy = state->bucket ? memory_bucket_reserve(state->bucket, length+1) : mem_alloc(length+1);
+				memcpy(copy, start, length);
+				copy[length] = 0;
+				
+				state->last_line_start = match->line_start;
+				state->last_line_long = long_line;
+				state->last_line = start;
+				state->last_line_end = end;
+				state->last_line_copy = copy;
+			}
+			
+			if (long_line)
+			{
+				match->word_offset = text_search_count_codepoints(state->last_line, word - state->last_line);
+				s32 remaining = text_search_count_codepoints(word, state->last_line_end - word);
+				if (match->word_match_len > remaining) match->word_match_len = remaining;
+			}
+		}
+		
+		match->line_start = state->last_line_copy;
+		match->line_info = state->last_line_copy;
+		
+		array_push(state->text_matches, match);
+	}
+	state->chunk_matches.length = 0;
+}
+
+// searches the complete lines that were decompressed since the last call, or
+// everything when the stream ended. returns false when decoding should stop.
+static bool text_gzip_flush(text_gzip_state *state, bool stream_end)
+{
+	stbi__zbuf *z = &state->zbuf;
+	if (state->cancel_search && *state->cancel_search) state->stop = true;
+	if (state->stop) return false;
+	
+	char *end = z->zout;
+	if (!stream_end)
+	{
+		char *newline = 0;
+		for (char *ch = z->zout; ch > state->search_start; ch--)
+		{
+			if (ch[-1] == '\n')
+			{
+				newline = ch;
+				break;
+			}
+		}
+		
+		// a line longer than a chunk is split
+		if (newline) end = newline;
+		else if (z->zout - state->search_start < TEXT_GZIP_CHUNK_SIZE) end = state->search_start;
+	}
+	
+	if (!state->checked_binary && (end > state->search_start || stream_end))
+	{
+		state->checked_binary = true;
+		if (state->binary_mode != BINARY_FILES_TEXT && text_search_is_binary(state->search_start, end - state->search_start))
+		{
+			if (state->info) __atomic_fetch_add(&state->info->binary_skip_count, 1, __ATOMIC_RELAXED);
+			state->stop = true;
+			return false;
+		}
+	}
+	
+	if (end > state->search_start)
+	{
+		array *text_matches = state->text_matches ? &state->chunk_matches : 0;
+		s64 chunk_count = 0;
+		bool found = false;
+		if (state->regex)
+		{
+			if (state->match_count)
+				chunk_count = text_regex_count(state->regex, state->search_start, end - state->search_start, state->cancel_search);
+			else
+				found = text_regex_search(state->regex, state->search_start, end - state->search_start, text_matches, state->cancel_search);
+		}
+		else
+		{
+			// the buffer is ours, the text matchers need a terminating zero
+			char replaced = *end;
+			*end = 0;
+			if (state->match_count)
+				chunk_count = string_count_matches(state->search_start, state->text_to_find, state->cancel_search, state->ignore_case);
+			else if (state->ignore_case)
+				found = string_contains_ignore_case(state->search_start, state->text_to_find, text_matches, state->cancel_search);
+			else
+				found = string_contains_ex(state->search_start, state->text_to_find, text_matches, state->cancel_search);
+			*end = replaced;
+		}
+		if (state->match_count)
+		{
+			*state->match_count += chunk_count;
+			found = chunk_count > 0;
+		}
+		
+		if (found)
+		{
+			state->result = true;
+			if (!state->text_matches && !state->match_count)
+			{
+				state->stop = true;
+				return false;
+			}
+			if (state->text_matches) text_gzip_report_matches(state);
+		}
+		
+		char *last_newline = 0;
+		state->line_nr += text_search_count_newlines(state->search_start, end - state->search_start, &last_newline);
+		state->search_start = end;
+	}
+	
+	if (stream_end) return true;
+	
+	// keep the history and the unsearched text, at least a chunk has to be free
+	char *keep = z->zout - TEXT_GZIP_HISTORY_SIZE;
+	if (keep > state->search_start) keep = state->search_start;
+	if (keep > z->zout_start)
+	{
+		s64 shift = keep - z->zout_start;
+		memmove(z->zout_start, keep, z->zout - keep);
+		z->zout -= shift;
+		state->search_start -= shift;
+		state->last_line_start = 0;
+		state->walk_line = 0;
+	}
+	
+	return true;
+}
+
+// output up to zout becomes part of the text, the last flush searches it even
+// when decoding fails after it
+static void text_gzip_commit(text_gzip_state *state, char *zout)
+{
+	stbi__zbuf *z = &state->zbuf;
+	state->output_size += zout - z->zout;
+	z->zout = zout;
+}
+
+// zout is committed and moved with the buffer, also when it returns false
+static bool text_gzip_reserve(text_gzip_state *state, char **zout, s32 length)
+{
+	stbi__zbuf *z = &state->zbuf;
+	if (z->zout_end - *zout >= length) return true;
+	
+	text_gzip_commit(state, *zout);
+	if (state->output_size > state->max_output_size) return false;
+	
+	// the second flush searches a long unfinished line, which always makes room
+	bool result = true;
+	for (s32 i = 0; i < 2 && result && z->zout_end - z->zout < length; i++)
+	{
+		result = text_gzip_flush(state, false);
+	}
+	*zout = z->zout;
+	return result && z->zout_end - z->zout >= length;
+}
+
+static bool text_gzip_huffman_block(text_gzip_state *state)
+{
+	stbi__zbuf *z = &state->zbuf;
+	char *zout = z->zout;
+	bool result = false;
+	for (;;)
+	{
+		// longest deflate match
+		if (!text_gzip_reserve(state, &zout, 258)) break;
+		
+		// the bit reader reads zeros past the end, a complete member is followed
+		// by its trailer so reaching the end means the content is truncated
+		if (z->zbuffer >= z->zbuffer_end) break;
+		
+		s32 symbol = stbi__zhuffman_decode(z, &z->z_length);
+		if (symbol < 0) break;
+		if (symbol < 256)
+		{
+			*zout++ = (char)symbol;
+			continue;
+		}
+		if (symbol == 256)
+		{
+			result = true;
+			break;
+		}
+		
+		symbol -= 257;
+		if (symbol >= 29) break;
+		s32 length = stbi__zlength_base[symbol];
+		if (stbi__zlength_extra[symbol]) length += stbi__zreceive(z, stbi__zlength_extra[symbol]);
+		
+		symbol = stbi__zhuffman_decode(z, &z->z_distance);
+		if (symbol < 0 || symbol >= 30) break;
+		s32 distance = stbi__zdist_base[symbol];
+		if (stbi__zdist_extra[symbol]) distance += stbi__zreceive(z, stbi__zdist_extra[symbol]);
+		if (zout - z->zout_start < distance) break;
+		
+		// source and destination can overlap
+		char *source = zout - distance;
+		while (length--) *zout++ = *source++;
+	}
+	
+	// what was decoded before an error is searched too
+	text_gzip_commit(state, zout);
+	return result;
+}
+
+static bool text_gzip_stored_block(text_gzip_state *state)
+{
+	stbi__zbuf *z = &state->zbuf;
+	
+	// the length follows at the next byte boundary, some of it can be in the bit buffer
+	stbi__zreceive(z, z->num_bits & 7);
+	u8 header[4];
+	s32 count = 0;
+	while (z->num_bits > 0 && count < 4)
+	{
+		header[count++] = (u8)(z->code_buffer & 255);
+		z->code_buffer >>= 8;
+		z->num_bits -= 8;
+	}
+	while (count < 4) header[count++] = stbi__zget8(z);
+	
+	s32 length = header[1]*256 + header[0];
+	s32 inverse = header[3]*256 + header[2];
+	if (inverse != (length ^ 0xFFFF)) return false;
+	
+	// a truncated block is copied up to the end of the content
+	bool result = z->zbuffer_end - z->zbuffer >= length;
+	if (!result) length = z->zbuffer_end - z->zbuffer;
+	
+	char *zout = z->zout;
+	while (length)
+	{
+		if (!text_gzip_reserve(state, &zout, 1)) return false;
+		s32 part = z->zout_end - zout;
+		if (part > length) part = length;
+		memcpy(zout, z->zbuffer, part);
+		z->zbuffer += part;
+		zout += part;
+		length -= part;
+	}
+	text_gzip_commit(state, zout);
+	return result;
+}
+
+static bool text_gzip_inflate(text_gzip_state *state)
+{
+	stbi__zbuf *z = &state->zbuf;
+	z->num_bits = 0;
+	z->code_buffer = 0;
+	
+	s32 final;
+	do
+	{
+		final = stbi__zreceive(z, 1);
+		s32 type = stbi__zreceive(z, 2);
+		if (type == 0)
+		{
+			if (!text_gzip_stored_block(state)) return false;
+		}
+		else if (type == 1)
+		{
+			if (!stbi__zbuild_huffman(&z->z_length, stbi__zdefault_length, 288)) return false;
+			if (!stbi__zbuild_huffman(&z->z_distance, stbi__zdefault_distance, 32)) return false;
+			if (!text_gzip_huffman_block(state)) return false;
+		}
+		else if (type == 2)
+		{
+			if (!stbi__compute_huffman_codes(z)) return false;
+			if (!text_gzip_huffman_block(state)) return false;
+		}
+		else return false;
+	}
+	while (!final);
+	
+	// bytes that were read ahead into the bit buffer belong to the trailer
+	z->zbuffer -= z->num_bits / 8;
+	z->num_bits = 0;
+	z->code_buffer = 0;
+	return true;
+}
+
+// moves the reader past the member header, returns false when there is no member
+static bool text_gzip_skip_header(stbi__zbuf *z)
+{
+	u8 *bytes = z->zbuffer;
+	s64 length = z->zbuffer_end - bytes;
+	if (length < 18 || bytes[0] != 0x1F || bytes[1] != 0x8B || bytes[2] != 8) return false;
+	
+	u8 flags = bytes[3];
+	s64 offset = 10;
+	if (flags & TEXT_GZIP_FLAG_EXTRA)
+	{
+		if (offset + 2 > length) return false;
+		offset += 2 + (bytes[offset] | (bytes[offset+1] << 8));
+	}
+	if (flags & TEXT_GZIP_FLAG_NAME)
+	{
+		while (offset < length && bytes[offset]) offset++;
+		offset++;
+	}
+	if (flags & TEXT_GZIP_FLAG_COMMENT)
+	{
+		while (offset < length && bytes[offset]) offset++;
+		offset++;
+	}
+	if (flags & TEXT_GZIP_FLAG_HCRC) offset += 2;
+	if (offset >= length) return false;
+	
+	z->zbuffer += offset;
+	return true;
+}
+
+bool text_gzip_search(file_content *content, char *text_to_find, struct t_text_regex *regex, array *text_matches, s64 *match_count, bool *cancel_search, bool ignore_case, binary_file_mode binary_mode, search_info *info, memory_bucket *bucket)
+{
+	if (!text_gzip_is_gzip(content)) return false;
+	
+	text_gzip_state *state = mem_alloc(sizeof(text_gzip_state));
+	memset(state, 0, sizeof(text_gzip_state));
+	state->text_to_find = text_to_find;
+	state->regex = regex;
+	state->ignore_case = ignore_case;
+	state->cancel_search = cancel_search;
+	state->text_matches = text_matches;
+	state->match_count = match_count;
+	state->chunk_matches = array_create(sizeof(text_match));
+	state->chunk_matches.reserve_jump = 256;
+	state->bucket = bucket;
+	state->binary_mode = binary_mode;
+	state->info = info;
+	state->max_output_size = content->content_length * TEXT_GZIP_MAX_RATIO + TEXT_GZIP_CHUNK_SIZE;
+	
+	// history, a chunk and the longest match, plus one byte for the terminating zero
+	state->buffer_size = TEXT_GZIP_HISTORY_SIZE + 2*TEXT_GZIP_CHUNK_SIZE + 258 + 1;
+	state->buffer = mem_alloc(state->buffer_size);
+	state->search_start = state->buffer;
+	
+	stbi__zbuf *z = &state->zbuf;
+	z->zbuffer = content->content;
+	z->zbuffer_end = z->zbuffer + content->content_length;
+	z->zout_start = state->buffer;
+	z->zout = state->buffer;
+	z->zout_end = state->buffer + state->buffer_size - 1;
+	z->z_expandable = 0;
+	
+	// concatenated members are one text, rotated logs are often appended like that
+	while (text_gzip_skip_header(z))
+	{
+		if (!text_gzip_inflate(state)) break;
+		
+		// crc32 and size of the member
+		if (z->zbuffer_end - z->zbuffer < 8) break;
+		z->zbuffer += 8;
+	}
+	
+	text_gzip_flush(state, true);
+	
+	bool result = state->result && !(cancel_search && *cancel_search);
+	array_destroy(&state->chunk_matches);
+	mem_free(state->buffer);
+	mem_free(state);
+	return result;
+}
\ No newline at end of file
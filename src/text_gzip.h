@@ -0,0 +1,74 @@
+/* 
+*  BSD 2-Clause “Simplified” License
+*  Copyright (c) 2019, Aldrik Ramaekers, aldrik.ramaekers@protonmail.com
+*  All rights reserved.
+*/
+
+#ifndef INCLUDE_TEXT_GZIP
+#define INCLUDE_TEXT_GZIP
+
+// deflate refers back at most this many bytes
+#define TEXT_GZIP_HISTORY_SIZE 32768
+// decompressed text is searched in chunks of about this size, only the chunk and
+// the history are kept in memory
+#define TEXT_GZIP_CHUNK_SIZE (megabytes(1))
+// a deflate stream can't expand more than this, larger output means the input
+// is corrupt
+#define TEXT_GZIP_MAX_RATIO 1032
+// only this much of longer lines is copied for a match
+#define TEXT_GZIP_LINE_COPY_SIZE (kilobytes(64))
+
+// gzip files are inflated with the zlib decoder of stb_image into a sliding buffer.
+// every time the buffer is full the complete lines in it are searched and only the
+// history and the unfinished line are kept, so matches never span a chunk boundary
+// unless a line is longer than a chunk.
+typedef struct t_text_gzip_state
+{
+	stbi__zbuf zbuf; // bit reader, huffman tables and output pointers
+	char *buffer;
+	s64 buffer_size;
+	char *search_start; // output before this point has been searched
+	s64 line_nr; // newlines before search_start
+	s64 output_size; // decompressed bytes so far
+	s64 max_output_size;
+	bool stop; // cancelled, binary or done
+	bool checked_binary;
+	
+	char *text_to_find;
+	struct t_text_regex *regex;
+	bool ignore_case;
+	bool *cancel_search;
+	array *text_matches;
+	s64 *match_count; // matches are counted instead of saved when set
+	array chunk_matches;
+	memory_bucket *bucket;
+	binary_file_mode binary_mode;
+	search_info *info;
+	bool result;
+	
+	char *last_line_start; // line of the previous match in buffer
+	bool last_line_long;
+	char *last_line; // copied part of that line
+	char *last_line_end;
+	char *last_line_copy;
+	char *walk_line; // codepoints counted on a long line
+	char *walk_position;
+	s32 walk_column;
+} text_gzip_state;
+
+// content starts with the gzip magic number, this is checked instead of the
+// extension because the header has to be there for the content to be decoded.
+bool text_gzip_is_gzip(file_content *content);
+
+// searches the decompressed text of every gzip member in content like
+// text_search_content. line_start and line_info of every match point to a copy of
+// the line, allocated in bucket or with mem_alloc when bucket is 0, because the
+// decompressed text is gone when the search returns. of lines longer than
+// TEXT_GZIP_LINE_COPY_SIZE only the part around the match is copied and
+// word_offset is relative to that part. with match_count set the matches are
+// counted and text_matches is not used, without both decoding stops at the first
+// match. binary content is only searched in BINARY_FILES_TEXT mode. truncated or
+// corrupt content is searched up to the point where decoding fails.
+bool text_gzip_search(file_content *content, char *text_to_find, struct t_text_regex *regex, array *text_matches, s64 *match_count, bool *cancel_search, bool ignore_case, binary_file_mode binary_mode, search_info *info, memory_bucket *bucket);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,1277 @@
+/* 
+*  BSD 2-Clause “Simplified” License
+*  Copyright (c) 2019, Aldrik Ramaekers, aldrik.ramaekers@protonmail.com
+*  All rights reserved.
+*/
+
+// parse tree, only used while compiling
+typedef enum t_text_regex_node_type
+{
+	TEXT_REGEX_NODE_EMPTY,
+	TEXT_REGEX_NODE_CHAR,
+	TEXT_REGEX_NODE_ANY,
+	TEXT_REGEX_NODE_CLASS,
+	TEXT_REGEX_NODE_ASSERT, // value is the op
+	TEXT_REGEX_NODE_CONCAT,
+	TEXT_REGEX_NODE_ALTERNATE,
+	TEXT_REGEX_NODE_REPEAT,
+} text_regex_node_type;
+
+typedef struct t_text_regex_node
+{
+	text_regex_node_type type;
+	s32 value;
+	s32 min;
+	s32 max; // -1 when unbounded
+	bool lazy;
+	s32 left;
+	s32 right;
+} text_regex_node;
+
+typedef struct t_text_regex_parser
+{
+	text_regex *regex;
+	char *cursor;
+	s32 depth;
+	text_regex_node *nodes;
+	s32 node_count;
+	s32 node_capacity;
+	s32 class_capacity;
+	s32 range_capacity;
+	s32 program_capacity;
+} text_regex_parser;
+
+#define TEXT_REGEX_MAX_DEPTH 200
+
+static s32 text_regex_node_create(text_regex_parser *parser, text_regex_node_type type, s32 value, s32 left, s32 right)
+{
+	if (parser->node_count == parser->node_capacity)
+	{
+		parser->node_capacity *= 2;
+		parser->nodes = mem_realloc(parser->nodes, sizeof(text_regex_node)*parser->node_capacity);
+	}
+	
+	text_regex_node *node = &parser->nodes[parser->node_count];
+	node->type = type;
+	node->value = value;
+	node->min = 0;
+	node->max = 0;
+	node->lazy = false;
+	node->left = left;
+	node->right = right;
+	return parser->node_count++;
+}
+
+static s32 text_regex_class_create(text_regex_parser *parser, bool negated)
+{
+	text_regex *regex = parser->regex;
+	if (regex->class_count == parser->class_capacity)
+	{
+		parser->class_capacity *= 2;
+		regex->classes = mem_realloc(regex->classes, sizeof(text_regex_class)*parser->class_capacity);
+	}
+	
+	text_regex_class *class = &regex->classes[regex->class_count];
+	class->negated = negated;
+	memset(class->ascii, 0, sizeof(class->ascii));
+	class->range_start = regex->range_count;
+	class->range_count = 0;
+	return regex->class_count++;
+}
+
+// ranges are added to the last created class
+static void text_regex_class_add(text_regex_parser *parser, s32 first, s32 last, bool fold)
+{
+	text_regex *regex = parser->regex;
+	text_regex_class *class = &regex->classes[regex->class_count-1];
+	
+	for (s32 cp = first; cp <= last && cp < 128; cp++)
+	{
+		class->ascii[cp >> 3] |= 1 << (cp & 7);
+		// text is folded in ignore case mode, upper case letters never match
+		if (regex->ignore_case && cp >= 'A' && cp <= 'Z')
+			class->ascii[(cp|0x20) >> 3] |= 1 << ((cp|0x20) & 7);
+	}
+	if (last < 128) return;
+	if (first < 128) first = 128;
+	
+	regex->has_non_ascii = true;
+	if (regex->range_count == parser->range_capacity)
+	{
+		parser->range_capacity *= 2;
+		regex->ranges = mem_realloc(regex->ranges, sizeof(text_regex_range)*parser->range_capacity);
+	}
+	regex->ranges[regex->range_count].first = first;
+	regex->ranges[regex->range_count].last = last;
+	regex->range_count++;
+	class->range_count++;
+	
+	// small ranges are folded codepoint by codepoint, larger ranges are
+	// compared with the folded text as they are
+	if (fold && regex->ignore_case && last - first < 1024)
+	{
+		for (s32 cp = first; cp <= last; cp++)
+		{
+			s32 folded = text_search_fold_codepoint(cp);
+			if (folded != cp) text_regex_class_add(parser, folded, folded, false);
+		}
+	}
+}
+
+#define text_regex_class_add_range(parser, first, last) text_regex_class_add(parser, first, last, true)
+
+static void text_regex_class_add_shorthand(text_regex_parser *parser, char c)
+{
+	switch (c|0x20)
+	{
+		case 'd':
+		text_regex_class_add_range(parser, '0', '9');
+		break;
+		
+		case 'w':
+		text_regex_class_add_range(parser, '0', '9');
+		text_regex_class_add_range(parser, 'A', 'Z');
+		text_regex_class_add_range(parser, 'a', 'z');
+		text_regex_class_add_range(parser, '_', '_');
+		break;
+		
+		case 's':
+		text_regex_class_add_range(parser, '\t', '\r');
+		text_regex_class_add_range(parser, ' ', ' ');
+		break;
+	}
+}
+
+static bool text_regex_is_shorthand(char c)
+{
+	return c && strchr("dDwWsS", c);
+}
+
+static bool text_regex_is_digit(char c)
+{
+	return (u8)(c - '0') < 10;
+}
+
+// escapes that stand for a single codepoint
+static bool text_regex_parse_escaped_char(char c, s32 *cp)
+{
+	switch (c)
+	{
+		case 't': *cp = '\t'; return true;
+		case 'n': *cp = '\n'; return true;
+		case 'r': *cp = '\r'; return true;
+		case 'f': *cp = '\f'; return true;
+		case 'v': *cp = '\v'; return true;
+		case '0': *cp = 0; return true;
+	}
+	
+	// escaped punctuation is taken literally
+	if ((u8)c < 128 && c && !text_regex_is_digit(c) && (u8)((c|0x20) - 'a') >= 26)
+	{
+		*cp = c;
+		return true;
+	}
+	return false;
+}
+
+static s32 text_regex_parse_class(text_regex_parser *parser)
+{
+	text_regex *regex = parser->regex;
+	
+	bool negated = (*parser->cursor == '^');
+	if (negated) parser->cursor++;
+	
+	s32 index = text_regex_class_create(parser, negated);
+	// like ., a negated class does not match a newline
+	if (negated) text_regex_class_add_range(parser, '\n', '\n');
+	
+	bool first = true;
+	while (*parser->cursor != ']' || first)
+	{
+		first = false;
+		if (!*parser->cursor)
+		{
+			regex->error = "missing ]";
+			return -1;
+		}
+		
+		utf8_int32_t from;
+		if (*parser->cursor == '\\')
+		{
+			char c = parser->cursor[1];
+			if (text_regex_is_shorthand(c))
+			{
+				if (c != (c|0x20))
+				{
+					regex->error = "\\D, \\W and \\S are not supported in a class";
+					return -1;
+				}
+				text_regex_class_add_shorthand(parser, c);
+				parser->cursor += 2;
+				continue;
+			}
+			
+			s32 cp;
+			if (!text_regex_parse_escaped_char(c, &cp))
+			{
+				regex->error = "unknown escape";
+				return -1;
+			}
+			from = cp;
+			parser->cursor += 2;
+		}
+		else
+		{
+			parser->cursor = utf8codepoint(parser->cursor, &from);
+		}
+		
+		utf8_int32_t to = from;
+		if (parser->cursor[0] == '-' && parser->cursor[1] && parser->cursor[1] != ']')
+		{
+			parser->cursor++;
+			if (*parser->cursor == '\\')
+			{
+				s32 cp;
+				if (!text_regex_parse_escaped_char(parser->cursor[1], &cp))
+				{
+					regex->error = "unknown escape";
+					return -1;
+				}
+				to = cp;
+				parser->cursor += 2;
+			}
+			else
+			{
+				parser->cursor = utf8codepoint(parser->cursor, &to);
+			}
+			
+			if (to < from)
+			{
+				regex->error = "invalid range in class";
+				return -1;
+			}
+		}
+		
+		text_regex_class_add_range(parser, from, to);
+	}
+	parser->cursor++;
+	
+	return text_regex_node_create(parser, TEXT_REGEX_NODE_CLASS, index, -1, -1);
+}
+
+static s32 text_regex_parse_alternate(text_regex_parser *parser);
+
+static s32 text_regex_parse_atom(text_regex_parser *parser)
+{
+	text_regex *regex = parser->regex;
+	char c = *parser->cursor;
+	
+	switch (c)
+	{
+		case '(':
+		{
+			parser->cursor++;
+			if (parser->cursor[0] == '?' && parser->cursor[1] == ':') parser->cursor += 2;
+			
+			if (++parser->depth > TEXT_REGEX_MAX_DEPTH)
+			{
+				regex->error = "too many nested groups";
+				return -1;
+			}
+			s32 node = text_regex_parse_alternate(parser);
+			if (regex->error) return -1;
+			parser->depth--;
+			
+			if (*parser->cursor != ')')
+			{
+				regex->error = "missing )";
+				return -1;
+			}
+			parser->cursor++;
+			return node;
+		}
+		
+		case '*':
+		case '+':
+		case '?':
+		regex->error = "nothing to repeat";
+		return -1;
+		
+		case '.':
+		parser->cursor++;
+		return text_regex_node_create(parser, TEXT_REGEX_NODE_ANY, 0, -1, -1);
+		
+		case '^':
+		parser->cursor++;
+		return text_regex_node_create(parser, TEXT_REGEX_NODE_ASSERT, TEXT_REGEX_LINE_START, -1, -1);
+		
+		case '$':
+		parser->cursor++;
+		return text_regex_node_create(parser, TEXT_REGEX_NODE_ASSERT, TEXT_REGEX_LINE_END, -1, -1);
+		
+		case '[':
+		parser->cursor++;
+		return text_regex_parse_class(parser);
+		
+		case '\\':
+		{
+			c = parser->cursor[1];
+			parser->cursor += 2;
+			
+			if (c == 'b')
+				return text_regex_node_create(parser, TEXT_REGEX_NODE_ASSERT, TEXT_REGEX_WORD_BOUNDARY, -1, -1);
+			if (c == 'B')
+				return text_regex_node_create(parser, TEXT_REGEX_NODE_ASSERT, TEXT_REGEX_NOT_WORD_BOUNDARY, -1, -1);
+			
+			if (text_regex_is_shorthand(c))
+			{
+				s32 index = text_regex_class_create(parser, c != (c|0x20));
+				text_regex_class_add_shorthand(parser, c);
+				return text_regex_node_create(parser, TEXT_REGEX_NODE_CLASS, index, -1, -1);
+			}
+			
+			s32 cp;
+			if (!text_regex_parse_escaped_char(c, &cp))
+			{
+				regex->error = "unknown escape";
+				return -1;
+			}
+			return text_regex_node_create(parser, TEXT_REGEX_NODE_CHAR, cp, -1, -1);
+		}
+	}
+	
+	utf8_int32_t cp;
+	parser->cursor = utf8codepoint(parser->cursor, &cp);
+	if (regex->ignore_case) cp = text_search_fold_codepoint(cp);
+	if (cp >= 128) regex->has_non_ascii = true;
+	return text_regex_node_create(parser, TEXT_REGEX_NODE_CHAR, cp, -1, -1);
+}
+
+static bool text_regex_parse_count(text_regex_parser *parser, s32 *count)
+{
+	if (!text_regex_is_digit(*parser->cursor)) return false;
+	
+	*count = 0;
+	while (text_regex_is_digit(*parser->cursor))
+	{
+		if (*count <= TEXT_REGEX_MAX_REPEAT) *count = *count*10 + (*parser->cursor - '0');
+		parser->cursor++;
+	}
+	return true;
+}
+
+static s32 text_regex_parse_repeat(text_regex_parser *parser)
+{
+	text_regex *regex = parser->regex;
+	s32 node = text_regex_parse_atom(parser);
+	if (regex->error) return -1;
+	
+	while (1)
+	{
+		s32 min, max;
+		char c = *parser->cursor;
+		if (c == '*') { min = 0; max = -1; }
+		else if (c == '+') { min = 1; max = -1; }
+		else if (c == '?') { min = 0; max = 1; }
+		else if (c == '{')
+		{
+			// a { that does not start a valid count is taken literally
+			char *start = parser->cursor++;
+			bool valid = text_regex_parse_count(parser, &min);
+			max = min;
+			if (valid && *parser->cursor == ',')
+			{
+				parser->cursor++;
+				if (!text_regex_parse_count(parser, &max)) max = -1;
+			}
+			if (!valid || *parser->cursor != '}')
+			{
+				parser->cursor = start;
+				break;
+			}
+			
+			if (min > TEXT_REGEX_MAX_REPEAT || max > TEXT_REGEX_MAX_REPEAT)
+			{
+				regex->error = "repeat count is too large";
+				return -1;
+			}
+			if (max != -1 && max < min)
+			{
+				regex->error = "invalid repeat count";
+				return -1;
+			}
+		}
+		else break;
+		parser->cursor++;
+		
+		node = text_regex_node_create(parser, TEXT_REGEX_NODE_REPEAT, 0, node, -1);
+		parser->nodes[node].min = min;
+		parser->nodes[node].max = max;
+		if (*parser->cursor == '?')
+		{
+			parser->nodes[node].lazy = true;
+			parser->cursor++;
+		}
+	}
+	
+	return node;
+}
+
+static s32 text_regex_parse_concat(text_regex_parser *parser)
+{
+	s32 result = -1;
+	while (*parser->cursor && *parser->cursor != '|' && *parser->cursor != ')')
+	{
+		s32 node = text_regex_parse_repeat(parser);
+		if (parser->regex->error) return -1;
+		
+		if (result == -1) result = node;
+		else result = text_regex_node_create(parser, TEXT_REGEX_NODE_CONCAT, 0, result, node);
+	}
+	
+	if (result == -1) result = text_regex_node_create(parser, TEXT_REGEX_NODE_EMPTY, 0, -1, -1);
+	return result;
+}
+
+static s32 text_regex_parse_alternate(text_regex_parser *parser)
+{
+	s32 result = text_regex_parse_concat(parser);
+	while (!parser->regex->error && *parser->cursor == '|')
+	{
+		parser->cursor++;
+		s32 node = text_regex_parse_concat(parser);
+		if (parser->regex->error) return -1;
+		
+		result = text_regex_node_create(parser, TEXT_REGEX_NODE_ALTERNATE, 0, result, node);
+	}
+	return result;
+}
+
+static s32 text_regex_emit(text_regex_parser *parser, text_regex_op op, s32 x, s32 y)
+{
+	text_regex *regex = parser->regex;
+	if (regex->program_size == TEXT_REGEX_MAX_PROGRAM_SIZE)
+	{
+		regex->error = "pattern is too large";
+		return -1;
+	}
+	
+	if (regex->program_size == parser->program_capacity)
+	{
+		parser->program_capacity *= 2;
+		regex->program = mem_realloc(regex->program, sizeof(text_regex_instruction)*parser->program_capacity);
+	}
+	
+	text_regex_instruction *instruction = &regex->program[regex->program_size];
+	instruction->op = op;
+	instruction->x = x;
+	instruction->y = y;
+	return regex->program_size++;
+}
+
+static void text_regex_set_split(text_regex *regex, s32 pc, s32 preferred, s32 other, bool lazy)
+{
+	regex->program[pc].x = lazy ? other : preferred;
+	regex->program[pc].y = lazy ? preferred : other;
+}
+
+static void text_regex_compile_node(text_regex_parser *parser, s32 index)
+{
+	text_regex *regex = parser->regex;
+	if (regex->error) return;
+	
+	text_regex_node node = parser->nodes[index];
+	switch (node.type)
+	{
+		case TEXT_REGEX_NODE_EMPTY: break;
+		case TEXT_REGEX_NODE_CHAR: text_regex_emit(parser, TEXT_REGEX_CHAR, node.value, 0); break;
+		case TEXT_REGEX_NODE_ANY: text_regex_emit(parser, TEXT_REGEX_ANY, 0, 0); break;
+		case TEXT_REGEX_NODE_CLASS: text_regex_emit(parser, TEXT_REGEX_CLASS, node.value, 0); break;
+		case TEXT_REGEX_NODE_ASSERT: text_regex_emit(parser, node.value, 0, 0); break;
+		
+		case TEXT_REGEX_NODE_CONCAT:
+		text_regex_compile_node(parser, node.left);
+		text_regex_compile_node(parser, node.right);
+		break;
+		
+		case TEXT_REGEX_NODE_ALTERNATE:
+		{
+			s32 split = text_regex_emit(parser, TEXT_REGEX_SPLIT, 0, 0);
+			text_regex_compile_node(parser, node.left);
+			s32 jump = text_regex_emit(parser, TEXT_REGEX_JUMP, 0, 0);
+			text_regex_compile_node(parser, node.right);
+			if (regex->error) return;
+			
+			text_regex_set_split(regex, split, split + 1, jump + 1, false);
+			regex->program[jump].x = regex->program_size;
+		}
+		break;
+		
+		case TEXT_REGEX_NODE_REPEAT:
+		{
+			// a{2,} is aa+, a{2,4} is aa(a(a)?)?
+			s32 copies = (node.max == -1 && node.min > 0) ? node.min - 1 : node.min;
+			for (s32 i = 0; i < copies; i++)
+				text_regex_compile_node(parser, node.left);
+			if (regex->error) return;
+			
+			if (node.max == -1 && node.min > 0)
+			{
+				s32 loop = regex->program_size;
+				text_regex_compile_node(parser, node.left);
+				s32 split = text_regex_emit(parser, TEXT_REGEX_SPLIT, 0, 0);
+				if (regex->error) return;
+				text_regex_set_split(regex, split, loop, split + 1, node.lazy);
+			}
+			else if (node.max == -1)
+			{
+				s32 split = text_regex_emit(parser, TEXT_REGEX_SPLIT, 0, 0);
+				text_regex_compile_node(parser, node.left);
+				text_regex_emit(parser, TEXT_REGEX_JUMP, split, 0);
+				if (regex->error) return;
+				text_regex_set_split(regex, split, split + 1, regex->program_size, node.lazy);
+			}
+			else if (node.max > node.min)
+			{
+				s32 optional = node.max - node.min;
+				s32 *splits = mem_alloc(sizeof(s32)*optional);
+				for (s32 i = 0; i < optional; i++)
+				{
+					splits[i] = text_regex_emit(parser, TEXT_REGEX_SPLIT, 0, 0);
+					text_regex_compile_node(parser, node.left);
+				}
+				if (!regex->error)
+				{
+					for (s32 i = 0; i < optional; i++)
+						text_regex_set_split(regex, splits[i], splits[i] + 1, regex->program_size, node.lazy);
+				}
+				mem_free(splits);
+			}
+		}
+		break;
+	}
+}
+
+static void text_regex_collect_concat(text_regex_parser *parser, s32 index, s32 *parts, s32 *part_count)
+{
+	text_regex_node *node = &parser->nodes[index];
+	if (node->type != TEXT_REGEX_NODE_CONCAT)
+	{
+		parts[(*part_count)++] = index;
+		return;
+	}
+	text_regex_collect_concat(parser, node->left, parts, part_count);
+	text_regex_collect_concat(parser, node->right, parts, part_count);
+}
+
+// most bytes a node can match, -1 when unbounded
+static s32 text_regex_node_max_length(text_regex_parser *parser, s32 index)
+{
+	text_regex_node *node = &parser->nodes[index];
+	switch (node->type)
+	{
+		case TEXT_REGEX_NODE_CHAR: return utf8codepointsize(node->value);
+		case TEXT_REGEX_NODE_ANY:
+		case TEXT_REGEX_NODE_CLASS: return 4;
+		
+		case TEXT_REGEX_NODE_CONCAT:
+		case TEXT_REGEX_NODE_ALTERNATE:
+		{
+			s32 left = text_regex_node_max_length(parser, node->left);
+			s32 right = text_regex_node_max_length(parser, node->right);
+			if (left == -1 || right == -1) return -1;
+			if (node->type == TEXT_REGEX_NODE_ALTERNATE) return left > right ? left : right;
+			return left + right > TEXT_REGEX_MAX_PROGRAM_SIZE ? -1 : left + right;
+		}
+		
+		case TEXT_REGEX_NODE_REPEAT:
+		{
+			s32 child = text_regex_node_max_length(parser, node->left);
+			if (child == -1 || node->max == -1) return -1;
+			return (s64)child*node->max > TEXT_REGEX_MAX_PROGRAM_SIZE ? -1 : child*node->max;
+		}
+		
+		default: return 0;
+	}
+}
+
+// finds the longest sequence of codepoints that every match contains. offset
+// receives the most bytes a match can start before the sequence, -1 when that
+// is unbounded.
+static void text_regex_find_required_literal(text_regex_parser *parser, s32 index, s32 buffer_size, char *best, s32 *best_length, s32 *offset)
+{
+	s32 *parts = mem_alloc(sizeof(s32)*parser->node_count);
+	s32 part_count = 0;
+	text_regex_collect_concat(parser, index, parts, &part_count);
+	
+	char *run = mem_alloc(buffer_size);
+	s32 run_length = 0;
+	s32 run_offset = 0;
+	s32 prefix_length = 0;
+	for (s32 i = 0; i <= part_count; i++)
+	{
+		text_regex_node *node = i < part_count ? &parser->nodes[parts[i]] : 0;
+		s32 node_length = node ? text_regex_node_max_length(parser, parts[i]) : 0;
+		if (node && node->type == TEXT_REGEX_NODE_CHAR && node->value > 0)
+		{
+			if (!run_length) run_offset = prefix_length;
+			run_length = (char*)utf8catcodepoint(run + run_length, node->value, 4) - run;
+		}
+		// assertions don't consume text so the run continues
+		else if (!node || (node->type != TEXT_REGEX_NODE_ASSERT && node->type != TEXT_REGEX_NODE_EMPTY))
+		{
+			if (run_length > *best_length)
+			{
+				memcpy(best, run, run_length);
+				best[run_length] = 0;
+				*best_length = run_length;
+				*offset = run_offset;
+			}
+			run_length = 0;
+			
+			if (node && node->type == TEXT_REGEX_NODE_REPEAT && node->min > 0)
+			{
+				s32 nested_offset;
+				s32 previous_length = *best_length;
+				text_regex_find_required_literal(parser, node->left, buffer_size, best, best_length, &nested_offset);
+				if (*best_length != previous_length) *offset = -1;
+			}
+		}
+		
+		if (prefix_length != -1) prefix_length = node_length == -1 ? -1 : prefix_length + node_length;
+	}
+	
+	mem_free(run);
+	mem_free(parts);
+}
+
+static bool text_regex_matches(text_regex *regex, text_regex_instruction *instruction, s32 symbol)
+{
+	switch (instruction->op)
+	{
+		case TEXT_REGEX_CHAR: return symbol == instruction->x;
+		case TEXT_REGEX_ANY: return symbol != '\n';
+		case TEXT_REGEX_CLASS:
+		{
+			text_regex_class *class = &regex->classes[instruction->x];
+			bool result = false;
+			if (symbol < 128)
+			{
+				result = (class->ascii[symbol >> 3] >> (symbol & 7)) & 1;
+			}
+			else
+			{
+				text_regex_range *range = regex->ranges + class->range_start;
+				for (s32 i = 0; i < class->range_count && !result; i++)
+					result = (symbol >= range[i].first && symbol <= range[i].last);
+			}
+			return result != class->negated;
+		}
+		default: return false;
+	}
+}
+
+static void text_regex_next_generation(u32 *generation, u32 *marks, s32 mark_count)
+{
+	if (++(*generation) == 0)
+	{
+		memset(marks, 0, sizeof(u32)*mark_count);
+		*generation = 1;
+	}
+}
+
+// adds the instructions reachable from pc without consuming text to dfa_set,
+// assertions are assumed to hold so the dfa matches a superset of the regex.
+static void text_regex_dfa_closure(text_regex *regex, s32 pc, s32 *count)
+{
+	s32 stack_size = 0;
+	regex->dfa_stack[stack_size++] = pc;
+	while (stack_size)
+	{
+		pc = regex->dfa_stack[--stack_size];
+		if (regex->dfa_marks[pc] == regex->dfa_generation) continue;
+		regex->dfa_marks[pc] = regex->dfa_generation;
+		
+		text_regex_instruction *instruction = &regex->program[pc];
+		switch (instruction->op)
+		{
+			case TEXT_REGEX_SPLIT:
+			regex->dfa_stack[stack_size++] = instruction->y;
+			regex->dfa_stack[stack_size++] = instruction->x;
+			break;
+			
+			case TEXT_REGEX_JUMP:
+			regex->dfa_stack[stack_size++] = instruction->x;
+			break;
+			
+			case TEXT_REGEX_LINE_START:
+			case TEXT_REGEX_LINE_END:
+			case TEXT_REGEX_WORD_BOUNDARY:
+			case TEXT_REGEX_NOT_WORD_BOUNDARY:
+			regex->dfa_stack[stack_size++] = pc + 1;
+			break;
+			
+			default:
+			regex->dfa_set[(*count)++] = pc;
+		}
+	}
+}
+
+static s32 text_regex_compare_pc(const void *first, const void *second)
+{
+	return *(s32*)first - *(s32*)second;
+}
+
+// returns the index of the state with the instructions in dfa_set, -1 when
+// there is no room for a new state
+static s32 text_regex_dfa_add_state(text_regex *regex, s32 count, bool is_match)
+{
+	qsort(regex->dfa_set, count, sizeof(s32), text_regex_compare_pc);
+	
+	u32 hash = 2166136261u ^ is_match;
+	for (s32 i = 0; i < count; i++)
+	{
+		hash ^= regex->dfa_set[i];
+		hash *= 16777619u;
+	}
+	
+	u32 mask = regex->dfa_table_size - 1;
+	u32 slot = hash & mask;
+	for (; regex->dfa_table[slot] != -1; slot = (slot + 1) & mask)
+	{
+		text_regex_dfa_state *state = regex->dfa_states[regex->dfa_table[slot]];
+		if (state->hash == hash && state->is_match == is_match && state->pc_count == count &&
+			memcmp(state->pcs, regex->dfa_set, sizeof(s32)*count) == 0)
+			return regex->dfa_table[slot];
+	}
+	
+	if (regex->dfa_state_count == TEXT_REGEX_MAX_DFA_STATES) return -1;
+	
+	text_regex_dfa_state *state = mem_alloc(sizeof(text_regex_dfa_state));
+	memset(state->next, 0xFF, sizeof(state->next));
+	state->is_match = is_match;
+	state->hash = hash;
+	state->pc_count = count;
+	state->pcs = mem_alloc(sizeof(s32)*(count + 1));
+	memcpy(state->pcs, regex->dfa_set, sizeof(s32)*count);
+	
+	s32 index = regex->dfa_state_count++;
+	regex->dfa_states[index] = state;
+	regex->dfa_table[slot] = index;
+	return index;
+}
+
+static s32 text_regex_dfa_slot(text_regex *regex, s32 symbol)
+{
+	if (symbol < 128) return symbol;
+	return regex->has_non_ascii ? -1 : TEXT_REGEX_DFA_OTHER;
+}
+
+// computes the transition under the mutex, returns -1 when the dfa is full
+static s32 text_regex_dfa_step(text_regex *regex, s32 state_index, s32 symbol)
+{
+	mutex_lock(&regex->dfa_mutex);
+	
+	text_regex_dfa_state *state = regex->dfa_states[state_index];
+	s32 slot = text_regex_dfa_slot(regex, symbol);
+	if (slot != -1 && state->next[slot] != TEXT_REGEX_DFA_UNKNOWN)
+	{
+		s32 result = state->next[slot];
+		mutex_unlock(&regex->dfa_mutex);
+		return result;
+	}
+	
+	text_regex_next_generation(&regex->dfa_generation, regex->dfa_marks, regex->program_size);
+	s32 count = 0;
+	for (s32 i = 0; i < state->pc_count; i++)
+	{
+		s32 pc = state->pcs[i];
+		if (text_regex_matches(regex, &regex->program[pc], symbol))
+			text_regex_dfa_closure(regex, pc + 1, &count);
+	}
+	
+	bool is_match = false;
+	for (s32 i = 0; i < count; i++)
+	{
+		if (regex->program[regex->dfa_set[i]].op == TEXT_REGEX_MATCH) is_match = true;
+	}
+	
+	// a match can start at every position
+	text_regex_dfa_closure(regex, 0, &count);
+	
+	s32 result = text_regex_dfa_add_state(regex, count, is_match);
+	if (result != -1 && slot != -1) __atomic_store_n(&state->next[slot], result, __ATOMIC_RELEASE);
+	
+	mutex_unlock(&regex->dfa_mutex);
+	return result;
+}
+
+static s32 text_regex_decode(char *text, char *end, s32 *codepoint)
+{
+	u8 byte = text[0];
+	if (byte < 0x80)
+	{
+		*codepoint = byte;
+		return 1;
+	}
+	
+	s32 length = byte >= 0xF0 ? 4 : byte >= 0xE0 ? 3 : 2;
+	// invalid utf8 is read one byte at a time
+	*codepoint = 0xFFFD;
+	if (byte < 0xC0 || byte >= 0xF8 || end - text < length) return 1;
+	
+	s32 result = byte & (0x3F >> (length - 1));
+	for (s32 i = 1; i < length; i++)
+	{
+		u8 c = text[i];
+		if ((c & 0xC0) != 0x80) return 1;
+		result = (result << 6) | (c & 0x3F);
+	}
+	*codepoint = result;
+	return length;
+}
+
+static s32 text_regex_symbol(text_regex *regex, char *text, char *end, s32 *symbol)
+{
+	u8 byte = *text;
+	if (byte < 0x80)
+	{
+		*symbol = (regex->ignore_case && byte >= 'A' && byte <= 'Z') ? byte|0x20 : byte;
+		return 1;
+	}
+	
+	s32 length = text_regex_decode(text, end, symbol);
+	if (regex->ignore_case) *symbol = text_search_fold_codepoint(*symbol);
+	return length;
+}
+
+// returns 1 and sets match_end when a match of the superset ends in text, 0 when
+// no match ends in text and -1 when the dfa is full.
+static s32 text_regex_dfa_scan(text_regex *regex, char *text, char *end, char **match_end, bool *cancel_search)
+{
+	s32 state_index = 0;
+	text_regex_dfa_state *state = regex->dfa_states[0];
+	
+	char *check_cancel = text + TEXT_SEARCH_BLOCK_SIZE;
+	for (char *cursor = text; cursor < end;)
+	{
+		s32 symbol;
+		s32 length = text_regex_symbol(regex, cursor, end, &symbol);
+		s32 slot = text_regex_dfa_slot(regex, symbol);
+		
+		s32 next = (slot == -1) ? TEXT_REGEX_DFA_UNKNOWN : __atomic_load_n(&state->next[slot], __ATOMIC_ACQUIRE);
+		if (next == TEXT_REGEX_DFA_UNKNOWN)
+		{
+			next = text_regex_dfa_step(regex, state_index, symbol);
+			if (next == -1) return -1;
+		}
+		
+		cursor += length;
+		state_index = next;
+		state = regex->dfa_states[next];
+		if (state->is_match)
+		{
+			*match_end = cursor;
+			return 1;
+		}
+		
+		if (cursor >= check_cancel)
+		{
+			if (cancel_search && *cancel_search) return 0;
+			check_cancel = cursor + TEXT_SEARCH_BLOCK_SIZE;
+		}
+	}
+	
+	return 0;
+}
+
+typedef struct t_text_regex_thread
+{
+	s32 pc;
+	char *start;
+} text_regex_thread;
+
+typedef struct t_text_regex_thread_list
+{
+	text_regex_thread *threads;
+	s32 count;
+} text_regex_thread_list;
+
+// per search memory of the nfa simulation
+typedef struct t_text_regex_scratch
+{
+	text_regex_thread_list current;
+	text_regex_thread_list next;
+	u32 *marks;
+	u32 generation;
+	s32 *stack;
+} text_regex_scratch;
+
+static bool text_regex_is_word_byte(u8 byte)
+{
+	return byte >= 0x80 || byte == '_' || (u8)((byte|0x20) - 'a') < 26 || (u8)(byte - '0') < 10;
+}
+
+static bool text_regex_assertion_holds(text_regex_op op, char *text, char *text_end, char *position)
+{
+	if (op == TEXT_REGEX_LINE_START) return (position == text || position[-1] == '\n');
+	if (op == TEXT_REGEX_LINE_END)
+		return (position == text_end || *position == '\n' ||
+				(*position == '\r' && position + 1 < text_end && position[1] == '\n'));
+	
+	bool word_before = (position > text && text_regex_is_word_byte(position[-1]));
+	bool word_after = (position < text_end && text_regex_is_word_byte(*position));
+	return (word_before != word_after) == (op == TEXT_REGEX_WORD_BOUNDARY);
+}
+
+static void text_regex_add_thread(text_regex *regex, text_regex_scratch *scratch, text_regex_thread_list *list, s32 pc, char *start, char *text, char *text_end, char *position)
+{
+	s32 stack_size = 0;
+	scratch->stack[stack_size++] = pc;
+	while (stack_size)
+	{
+		pc = scratch->stack[--stack_size];
+		if (scratch->marks[pc] == scratch->generation) continue;
+		scratch->marks[pc] = scratch->generation;
+		
+		text_regex_instruction *instruction = &regex->program[pc];
+		switch (instruction->op)
+		{
+			case TEXT_REGEX_SPLIT:
+			scratch->stack[stack_size++] = instruction->y;
+			scratch->stack[stack_size++] = instruction->x;
+			break;
+			
+			case TEXT_REGEX_JUMP:
+			scratch->stack[stack_size++] = instruction->x;
+			break;
+			
+			case TEXT_REGEX_LINE_START:
+			case TEXT_REGEX_LINE_END:
+			case TEXT_REGEX_WORD_BOUNDARY:
+			case TEXT_REGEX_NOT_WORD_BOUNDARY:
+			if (text_regex_assertion_holds(instruction->op, text, text_end, position))
+				scratch->stack[stack_size++] = pc + 1;
+			break;
+			
+			default:
+			list->threads[list->count].pc = pc;
+			list->threads[list->count].start = start;
+			list->count++;
+		}
+	}
+}
+
+// simulates the nfa on [from, to) and finds the leftmost match, earlier
+// alternatives and greedy repeats have priority like in backtracking engines.
+static bool text_regex_simulate(text_regex *regex, text_regex_scratch *scratch, char *text, char *text_end, char *from, char *to, char **match_start, char **match_end, bool *cancel_search)
+{
+	text_regex_thread_list *current = &scratch->current;
+	text_regex_thread_list *next = &scratch->next;
+	current->count = 0;
+	text_regex_next_generation(&scratch->generation, scratch->marks, regex->program_size);
+	
+	bool matched = false;
+	char *check_cancel = from + TEXT_SEARCH_BLOCK_SIZE;
+	for (char *cursor = from;;)
+	{
+		if (!matched) text_regex_add_thread(regex, scratch, current, 0, cursor, text, text_end, cursor);
+		
+		s32 symbol = -1;
+		s32 length = 0;
+		if (cursor < to) length = text_regex_symbol(regex, cursor, to, &symbol);
+		
+		text_regex_next_generation(&scratch->generation, scratch->marks, regex->program_size);
+		next->count = 0;
+		for (s32 i = 0; i < current->count; i++)
+		{
+			text_regex_thread *thread = &current->threads[i];
+			text_regex_instruction *instruction = &regex->program[thread->pc];
+			
+			if (instruction->op == TEXT_REGEX_MATCH)
+			{
+				// empty matches are not reported
+				if (thread->start == cursor) continue;
+				
+				// threads with lower priority are cut off
+				matched = true;
+				*match_start = thread->start;
+				*match_end = cursor;
+				break;
+			}
+			
+			if (symbol != -1 && text_regex_matches(regex, instruction, symbol))
+				text_regex_add_thread(regex, scratch, next, thread->pc + 1, thread->start, text, text_end, cursor + length);
+		}
+		
+		if (cursor >= to) break;
+		
+		text_regex_thread_list *swap = current;
+		current = next;
+		next = swap;
+		cursor += length;
+		if (matched && !current->count) break;
+		
+		if (cursor >= check_cancel)
+		{
+			if (cancel_search && *cancel_search) return false;
+			check_cancel = cursor + TEXT_SEARCH_BLOCK_SIZE;
+		}
+	}
+	
+	scratch->current.count = 0;
+	scratch->next.count = 0;
+	return matched;
+}
+
+static char *text_regex_find_literal(text_regex *regex, char *text, char *end, bool *cancel_search)
+{
+	// blocks overlap by the longest match minus one byte so no match is missed
+	s32 overlap = regex->literal.max_match_length - 1;
+	for (char *cursor = text; end - cursor >= regex->literal.length;)
+	{
+		if (cancel_search && *cancel_search) return 0;
+		
+		s64 block_length = end - cursor;
+		if (block_length > TEXT_SEARCH_BLOCK_SIZE + overlap)
+			block_length = TEXT_SEARCH_BLOCK_SIZE + overlap;
+		
+		s64 offset = text_search_find_needle_ex(&regex->literal, cursor, block_length, 0);
+		if (offset != -1) return cursor + offset;
+		if (cursor + block_length == end) break;
+		cursor += block_length - overlap;
+	}
+	return 0;
+}
+
+static bool text_regex_search_internal(text_regex *regex, char *text, s64 text_length, array *text_matches, s64 *match_count, bool *cancel_search, char **first_start, char **first_end)
+{
+	if (regex->error) return false;
+	
+	text_regex_scratch scratch;
+	scratch.current.threads = mem_alloc(sizeof(text_regex_thread)*regex->program_size);
+	scratch.next.threads = mem_alloc(sizeof(text_regex_thread)*regex->program_size);
+	scratch.marks = mem_alloc(sizeof(u32)*regex->program_size);
+	memset(scratch.marks, 0, sizeof(u32)*regex->program_size);
+	scratch.generation = 0;
+	scratch.stack = mem_alloc(sizeof(s32)*(regex->program_size*2 + 2));
+	
+	char *text_end = text + text_length;
+	text_search_lines lines = text_search_lines_create(text);
+	bool final_result = false;
+	
+	char *literal = 0; // next occurrence of the literal
+	char *cursor = text;
+	while (cursor < text_end)
+	{
+		if (cancel_search && *cancel_search) break;
+		
+		if (regex->has_literal && (!literal || literal < cursor))
+		{
+			literal = text_regex_find_literal(regex, cursor, text_end, cancel_search);
+			if (!literal) break;
+		}
+		
+		char *from = cursor;
+		char *to = text_end;
+		char *next_cursor = text_end; // where to continue when [from, to) has no match
+		char *dfa_end;
+		bool windowed = false;
+		if (regex->has_literal && regex->literal_offset != -1 && regex->max_length != -1)
+		{
+			windowed = true;
+			// every match that contains this occurrence of the literal is close to it,
+			// a match further on contains a later occurrence
+			if (literal - regex->literal_offset > from) from = literal - regex->literal_offset;
+			if (text_end - literal > regex->max_length) to = literal + regex->max_length;
+			next_cursor = literal + 1;
+		}
+		else if (regex->is_single_line)
+		{
+			// a single line match is on the line of the literal or on the line where
+			// the dfa found the end of a possible match
+			char *line = literal;
+			if (!line)
+			{
+				s32 dfa_result = text_regex_dfa_scan(regex, cursor, text_end, &dfa_end, cancel_search);
+				if (dfa_result == 0) break;
+				if (dfa_result == 1) line = dfa_end - 1;
+			}
+			
+			if (line)
+			{
+				from = line;
+				while (from > cursor && from[-1] != '\n') from--;
+				to = memchr(line, '\n', text_end - line);
+				if (!to) to = text_end;
+				else next_cursor = to + 1;
+			}
+		}
+		
+		char *match_start;
+		char *match_end;
+		bool found = (text_regex_dfa_scan(regex, from, to, &dfa_end, cancel_search) != 0 &&
+					  text_regex_simulate(regex, &scratch, text, text_end, from, to, &match_start, &match_end, cancel_search));
+		
+		// a match that does not contain the literal can be an earlier match cut off at
+		// to, the leftmost match is then looked for without the window
+		if (found && windowed && to != text_end && (match_start > literal || match_end < literal + regex->literal.length))
+			found = text_regex_simulate(regex, &scratch, text, text_end, from, text_end, &match_start, &match_end, cancel_search);
+		if (!found)
+		{
+			cursor = next_cursor;
+			continue;
+		}
+		
+		final_result = true;
+		if (first_start)
+		{
+			*first_start = match_start;
+			*first_end = match_end;
+			break;
+		}
+		if (match_count) (*match_count)++;
+		
+		if (text_matches)
+		{
+			text_match new_match;
+			text_search_lines_locate(&lines, match_start, &new_match);
+			// same length as the wildcard matcher reports, one character less for a
+			// match that ends the text
+			s32 match_char_length = text_search_count_codepoints(match_start, match_end - match_start);
+			new_match.word_match_len = (match_end == text_end) ? match_char_length-1 : match_char_length;
+			new_match.line_info = 0;
+			array_push(text_matches, &new_match);
+		}
+		else if (!match_count) break;
+		
+		cursor = match_end;
+	}
+	
+	if (cancel_search && *cancel_search) final_result = false;
+	
+	mem_free(scratch.current.threads);
+	mem_free(scratch.next.threads);
+	mem_free(scratch.marks);
+	mem_free(scratch.stack);
+	
+	return final_result;
+}
+
+bool text_regex_search(text_regex *regex, char *text, s64 text_length, array *text_matches, bool *cancel_search)
+{
+	return text_regex_search_internal(regex, text, text_length, text_matches, 0, cancel_search, 0, 0);
+}
+
+s64 text_regex_count(text_regex *regex, char *text, s64 text_length, bool *cancel_search)
+{
+	s64 match_count = 0;
+	text_regex_search_internal(regex, text, text_length, 0, &match_count, cancel_search, 0, 0);
+	return match_count;
+}
+
+bool text_regex_find(text_regex *regex, char *text, s64 text_length, s64 *match_offset, s64 *match_length, bool *cancel_search)
+{
+	char *start, *end;
+	if (!text_regex_search_internal(regex, text, text_length, 0, 0, cancel_search, &start, &end))
+		return false;
+	
+	if (match_offset) *match_offset = start - text;
+	if (match_length) *match_length = end - start;
+	return true;
+}
+
+text_regex *text_regex_create(char *pattern, bool ignore_case)
+{
+	text_regex *regex = mem_alloc(sizeof(text_regex));
+	memset(regex, 0, sizeof(text_regex));
+	regex->ignore_case = ignore_case;
+	regex->dfa_mutex = mutex_create();
+	
+	text_regex_parser parser;
+	parser.regex = regex;
+	parser.cursor = pattern;
+	parser.depth = 0;
+	parser.node_count = 0;
+	parser.node_capacity = 64;
+	parser.nodes = mem_alloc(sizeof(text_regex_node)*parser.node_capacity);
+	parser.class_capacity = 8;
+	regex->classes = mem_alloc(sizeof(text_regex_class)*parser.class_capacity);
+	parser.range_capacity = 8;
+	regex->ranges = mem_alloc(sizeof(text_regex_range)*parser.range_capacity);
+	parser.program_capacity = 64;
+	regex->program = mem_alloc(sizeof(text_regex_instruction)*parser.program_capacity);
+	
+	s32 root = text_regex_parse_alternate(&parser);
+	if (!regex->error && *parser.cursor) regex->error = "unmatched )";
+	
+	text_regex_compile_node(&parser, root);
+	text_regex_emit(&parser, TEXT_REGEX_MATCH, 0, 0);
+	
+	if (!regex->error)
+	{
+		s32 pattern_length = strlen(pattern);
+		char *best = mem_alloc(pattern_length + 8);
+		s32 best_length = 0;
+		text_regex_find_required_literal(&parser, root, pattern_length + 8, best, &best_length, &regex->literal_offset);
+		regex->max_length = text_regex_node_max_length(&parser, root);
+		
+		// the needle keeps pointing to the literal
+		regex->has_literal = (best_length > 0);
+		regex->literal_text = best;
+		if (regex->has_literal) regex->literal = text_search_needle_create_ex(best, best_length, ignore_case);
+		
+		regex->is_single_line = true;
+		for (s32 pc = 0; pc < regex->program_size; pc++)
+		{
+			text_regex_instruction *instruction = &regex->program[pc];
+			if (instruction->op != TEXT_REGEX_ANY && text_regex_matches(regex, instruction, '\n'))
+				regex->is_single_line = false;
+		}
+		
+		regex->dfa_states = mem_alloc(sizeof(text_regex_dfa_state*)*TEXT_REGEX_MAX_DFA_STATES);
+		regex->dfa_state_count = 0;
+		regex->dfa_table_size = TEXT_REGEX_MAX_DFA_STATES*2;
+		regex->dfa_table = mem_alloc(sizeof(s32)*regex->dfa_table_size);
+		memset(regex->dfa_table, 0xFF, sizeof(s32)*regex->dfa_table_size);
+		regex->dfa_marks = mem_alloc(sizeof(u32)*regex->program_size);
+		memset(regex->dfa_marks, 0, sizeof(u32)*regex->program_size);
+		regex->dfa_generation = 1;
+		regex->dfa_stack = mem_alloc(sizeof(s32)*(regex->program_size*2 + 2));
+		regex->dfa_set = mem_alloc(sizeof(s32)*regex->program_size);
+		
+		// state 0 is where every scan starts
+		s32 count = 0;
+		text_regex_dfa_closure(regex, 0, &count);
+		text_regex_dfa_add_state(regex, count, false);
+	}
+	
+	mem_free(parser.nodes);
+	return regex;
+}
+
+void text_regex_destroy(text_regex *regex)
+{
+	for (s32 i = 0; i < regex->dfa_state_count; i++)
+	{
+		mem_free(regex->dfa_states[i]->pcs);
+		mem_free(regex->dfa_states[i]);
+	}
+	
+	if (regex->dfa_states)
+	{
+		mem_free(regex->dfa_states);
+		mem_free(regex->dfa_table);
+		mem_free(regex->dfa_marks);
+		mem_free(regex->dfa_stack);
+		mem_free(regex->dfa_set);
+	}
+	if (regex->has_literal) text_search_needle_destroy(&regex->literal);
+	if (regex->literal_text) mem_free(regex->literal_text);
+	
+	mem_free(regex->program);
+	mem_free(regex->classes);
+	mem_free(regex->ranges);
+	mutex_destroy(&regex->dfa_mutex);
+	mem_free(regex);
+}
\ No newline at end of file
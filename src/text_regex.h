@@ -0,0 +1,114 @@
+/* 
+*  BSD 2-Clause “Simplified” License
+*  Copyright (c) 2019, Aldrik Ramaekers, aldrik.ramaekers@protonmail.com
+*  All rights reserved.
+*/
+
+#ifndef INCLUDE_TEXT_REGEX
+#define INCLUDE_TEXT_REGEX
+
+// Regular expressions are compiled to a thompson nfa and matched without
+// backtracking, every byte of text is looked at a bounded number of times.
+// Supported: literals, . [] [^] \d \w \s \D \W \S \b \B ^ $ | () (?:)
+// * + ? {n} {n,} {n,m} and their lazy forms. ^ and $ match at line boundaries,
+// . and [^] don't match a newline and empty matches are not reported.
+#define TEXT_REGEX_MAX_PROGRAM_SIZE 20000
+#define TEXT_REGEX_MAX_REPEAT 1000
+// states of the lazy dfa, when all are in use the nfa is simulated directly
+#define TEXT_REGEX_MAX_DFA_STATES 4096
+
+typedef enum t_text_regex_op
+{
+	TEXT_REGEX_CHAR, // x is the codepoint, folded in ignore case mode
+	TEXT_REGEX_ANY,
+	TEXT_REGEX_CLASS, // x is the class index
+	TEXT_REGEX_SPLIT, // continue at x and y, x has priority
+	TEXT_REGEX_JUMP,
+	TEXT_REGEX_LINE_START,
+	TEXT_REGEX_LINE_END,
+	TEXT_REGEX_WORD_BOUNDARY,
+	TEXT_REGEX_NOT_WORD_BOUNDARY,
+	TEXT_REGEX_MATCH,
+} text_regex_op;
+
+typedef struct t_text_regex_instruction
+{
+	text_regex_op op;
+	s32 x;
+	s32 y;
+} text_regex_instruction;
+
+typedef struct t_text_regex_range
+{
+	s32 first;
+	s32 last;
+} text_regex_range;
+
+typedef struct t_text_regex_class
+{
+	bool negated;
+	u8 ascii[16]; // bit per ascii codepoint, before negation
+	s32 range_start; // ranges above ascii
+	s32 range_count;
+} text_regex_class;
+
+// dfa states are sets of nfa instructions, transitions are filled in the first
+// time a symbol is seen. symbols are codepoints, folded in ignore case mode.
+#define TEXT_REGEX_DFA_OTHER 128 // non-ascii symbols when the pattern has none
+#define TEXT_REGEX_DFA_UNKNOWN -1
+typedef struct t_text_regex_dfa_state
+{
+	s32 next[TEXT_REGEX_DFA_OTHER+1];
+	bool is_match; // a non-empty match ends at the symbol that led to this state
+	u32 hash;
+	s32 pc_count;
+	s32 *pcs;
+} text_regex_dfa_state;
+
+typedef struct t_text_regex
+{
+	char *error; // 0 when the pattern compiled
+	bool ignore_case;
+	
+	text_regex_instruction *program;
+	s32 program_size;
+	text_regex_class *classes;
+	s32 class_count;
+	text_regex_range *ranges;
+	s32 range_count;
+	bool has_non_ascii; // pattern mentions codepoints above ascii
+	bool is_single_line; // no match can contain a newline
+	
+	// every match contains this literal, searched for with the substring kernels
+	bool has_literal;
+	char *literal_text;
+	text_search_needle literal;
+	s32 literal_offset; // most bytes a match starts before the literal, -1 when unbounded
+	s32 max_length; // most bytes a match spans, -1 when unbounded
+	
+	// shared by all threads searching with the regex, transitions are read
+	// without locking and computed under the mutex
+	mutex dfa_mutex;
+	text_regex_dfa_state **dfa_states;
+	s32 dfa_state_count;
+	s32 *dfa_table; // open addressing table of state indices, -1 when empty
+	s32 dfa_table_size;
+	u32 *dfa_marks;
+	u32 dfa_generation;
+	s32 *dfa_stack;
+	s32 *dfa_set;
+} text_regex;
+
+// compile once per search, the regex can be used by any number of threads.
+// error is set when the pattern is invalid.
+text_regex *text_regex_create(char *pattern, bool ignore_case);
+void text_regex_destroy(text_regex *regex);
+
+// same results as string_contains_ex, the text does not have to end with a
+// NUL byte. text_regex_find only looks for the first match and text_regex_count
+// returns the number of matches text_regex_search would find.
+bool text_regex_search(text_regex *regex, char *text, s64 text_length, array *text_matches, bool *cancel_search);
+bool text_regex_find(text_regex *regex, char *text, s64 text_length, s64 *match_offset, s64 *match_length, bool *cancel_search);
+s64 text_regex_count(text_regex *regex, char *text, s64 text_length, bool *cancel_search);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,1171 @@
+/* 
+*  BSD 2-Clause “Simplified” License
+*  Copyright (c) 2019, Aldrik Ramaekers, aldrik.ramaekers@protonmail.com
+*  All rights reserved.
+*/
+
+text_search_kernel text_search_active_kernel = TEXT_SEARCH_KERNEL_AUTO;
+
+void text_search_set_kernel(text_search_kernel kernel)
+{
+	if (kernel == TEXT_SEARCH_KERNEL_AUTO)
+	{
+		kernel = TEXT_SEARCH_KERNEL_SCALAR;
+#ifdef TEXT_SEARCH_X86
+		__builtin_cpu_init();
+		if (__builtin_cpu_supports("sse2")) kernel = TEXT_SEARCH_KERNEL_SSE2;
+		if (__builtin_cpu_supports("avx2")) kernel = TEXT_SEARCH_KERNEL_AVX2;
+#endif
+	}
+
+#ifndef TEXT_SEARCH_X86
+	kernel = TEXT_SEARCH_KERNEL_SCALAR;
+#endif
+	
+	text_search_active_kernel = kernel;
+}
+
+char *text_search_kernel_name(text_search_kernel kernel)
+{
+	switch(kernel)
+	{
+		case TEXT_SEARCH_KERNEL_AUTO: return "auto";
+		case TEXT_SEARCH_KERNEL_SCALAR: return "scalar";
+		case TEXT_SEARCH_KERNEL_SSE2: return "sse2";
+		case TEXT_SEARCH_KERNEL_AVX2: return "avx2";
+	}
+	return "unknown";
+}
+
+bool text_search_is_literal(char *text_to_find)
+{
+	if (!*text_to_find) return false;
+	
+	while(*text_to_find)
+	{
+		if (*text_to_find == '*' || *text_to_find == '?') return false;
+		text_to_find++;
+	}
+	return true;
+}
+
+// simple one to one case folding. codepoints encoded in one or two bytes are looked
+// up in the table, the few codepoints above that which fold are handled in
+// text_search_fold_codepoint. folding never produces a longer utf8 sequence so a
+// match is never shorter than the folded needle.
+#define TEXT_SEARCH_FOLD_TABLE_SIZE 0x800
+static u16 text_search_fold_table[TEXT_SEARCH_FOLD_TABLE_SIZE];
+static bool text_search_fold_table_ready = false;
+
+static void text_search_create_fold_table()
+{
+	for (s32 cp = 0; cp < TEXT_SEARCH_FOLD_TABLE_SIZE; cp++)
+	{
+		utf8_int32_t lower = utf8lwrcodepoint(cp);
+		
+		// cyrillic is not handled by utf8lwrcodepoint
+		if (cp >= 0x410 && cp <= 0x42F) lower = cp + 0x20;
+		if (cp >= 0x400 && cp <= 0x40F) lower = cp + 0x50;
+		
+		if (lower >= TEXT_SEARCH_FOLD_TABLE_SIZE) lower = cp;
+		text_search_fold_table[cp] = lower;
+	}
+	text_search_fold_table_ready = true;
+}
+
+utf8_int32_t text_search_fold_codepoint(utf8_int32_t cp)
+{
+	if (!text_search_fold_table_ready) text_search_create_fold_table();
+	// utf8codepoint returns negative values for stray continuation bytes
+	if (cp < 0) return cp;
+	if (cp < TEXT_SEARCH_FOLD_TABLE_SIZE) return text_search_fold_table[cp];
+	
+	switch(cp)
+	{
+		case 0x1E9E: return 0xDF; // capital sharp s
+		case 0x2126: return 0x3C9; // ohm sign
+		case 0x212A: return 'k'; // kelvin sign
+		case 0x212B: return 0xE5; // angstrom sign
+	}
+	
+	// latin extended additional, upper case is even
+	if (cp >= 0x1E00 && cp <= 0x1EFF && !(cp & 1) && !(cp >= 0x1E96 && cp <= 0x1E9F)) return cp + 1;
+	// fullwidth latin
+	if (cp >= 0xFF21 && cp <= 0xFF3A) return cp + 0x20;
+	
+	return cp;
+}
+
+static inline u8 text_search_lower(u8 ch)
+{
+	return (u8)(ch - 'A') < 26 ? ch | 0x20 : ch;
+}
+
+// bytes that are not part of a valid sequence decode to a value above the unicode
+// range so they only match the same byte
+#define TEXT_SEARCH_INVALID_BYTE 0x110000
+
+// decodes one codepoint without reading past end
+static inline u8 *text_search_decode(u8 *text, u8 *end, utf8_int32_t *cp)
+{
+	u8 ch = *text;
+	s32 length = 1;
+	if (ch >= 0xF0) length = 4;
+	else if (ch >= 0xE0) length = 3;
+	else if (ch >= 0xC0) length = 2;
+	
+	if (length == 1)
+	{
+		*cp = ch < 0x80 ? ch : TEXT_SEARCH_INVALID_BYTE | ch;
+		return text + 1;
+	}
+	if (text + length > end)
+	{
+		*cp = TEXT_SEARCH_INVALID_BYTE | ch;
+		return text + 1;
+	}
+	
+	utf8_int32_t result = ch & (0x7F >> length);
+	for (s32 i = 1; i < length; i++)
+	{
+		if ((text[i] & 0xC0) != 0x80)
+		{
+			*cp = TEXT_SEARCH_INVALID_BYTE | ch;
+			return text + 1;
+		}
+		result = (result << 6) | (text[i] & 0x3F);
+	}
+	
+	*cp = result;
+	return text + length;
+}
+
+text_search_needle text_search_needle_create_ex(char *needle, s32 needle_length, bool ignore_case)
+{
+	text_search_needle result;
+	result.text = needle;
+	result.length = needle_length;
+	result.ignore_case = ignore_case;
+	result.is_ascii = true;
+	result.max_match_length = needle_length;
+	result.codepoints = 0;
+	result.codepoint_count = 0;
+	
+	if (ignore_case)
+	{
+		if (!text_search_fold_table_ready) text_search_create_fold_table();
+		
+		// folding never makes a codepoint longer
+		result.text = mem_alloc(needle_length+1);
+		result.codepoints = mem_alloc(sizeof(utf8_int32_t)*(needle_length+1));
+		
+		u8 *end = (u8*)needle + needle_length;
+		char *folded = result.text;
+		for (u8 *ch = (u8*)needle; ch < end;)
+		{
+			utf8_int32_t cp;
+			ch = text_search_decode(ch, end, &cp);
+			cp = text_search_fold_codepoint(cp);
+			if (cp >= 0x80) result.is_ascii = false;
+			
+			result.codepoints[result.codepoint_count++] = cp;
+			if (cp & TEXT_SEARCH_INVALID_BYTE)
+				*folded++ = cp & 0xFF;
+			else
+				folded = utf8catcodepoint(folded, cp, 4);
+		}
+		*folded = 0;
+		
+		result.length = folded - result.text;
+		// every codepoint of the needle can match a codepoint of up to 4 bytes
+		result.max_match_length = result.codepoint_count*4;
+	}
+	
+	u8 *n = (u8*)result.text;
+	s32 l = result.length;
+	
+	bool seen[256] = {0};
+	s32 distinct_bytes = 0;
+	for (s32 i = 0; i < 256; i++) result.skip[i] = l;
+	for (s32 i = 0; i < l; i++)
+	{
+		result.skip[n[i]] = l-1-i;
+		if (!seen[n[i]]) distinct_bytes++;
+		seen[n[i]] = true;
+	}
+	
+	// the folded needle has no upper case ascii, text bytes are not folded before the lookup
+	if (ignore_case)
+	{
+		for (s32 ch = 'A'; ch <= 'Z'; ch++) result.skip[ch] = result.skip[ch | 0x20];
+	}
+	
+	if (text_search_active_kernel == TEXT_SEARCH_KERNEL_AUTO)
+		text_search_set_kernel(TEXT_SEARCH_KERNEL_AUTO);
+	
+	if (text_search_active_kernel == TEXT_SEARCH_KERNEL_SCALAR &&
+		(l >= TEXT_SEARCH_TWO_WAY_MIN_LENGTH || (l > 2 && distinct_bytes <= TEXT_SEARCH_SMALL_ALPHABET)))
+		result.algorithm = TEXT_SEARCH_TWO_WAY;
+	else
+		result.algorithm = TEXT_SEARCH_FIRST_LAST_FILTER;
+	
+	// maximal suffix for both byte orderings, the longer one gives the
+	// critical factorization of the needle.
+	s32 ms[2];
+	s32 period[2];
+	for (s32 order = 0; order < 2; order++)
+	{
+		s32 ip = -1, jp = 0, k = 1, p = 1;
+		while (jp + k < l)
+		{
+			u8 a = n[ip+k];
+			u8 b = n[jp+k];
+			if (a == b)
+			{
+				if (k == p)
+				{
+					jp += p;
+					k = 1;
+				}
+				else k++;
+			}
+			else if (order == 0 ? a > b : a < b)
+			{
+				jp += k;
+				k = 1;
+				p = jp - ip;
+			}
+			else
+			{
+				ip = jp++;
+				k = p = 1;
+			}
+		}
+		ms[order] = ip;
+		period[order] = p;
+	}
+	
+	s32 select = ms[1] > ms[0] ? 1 : 0;
+	result.critical_pos = ms[select];
+	result.period = period[select];
+	
+	// periodic needles remember how much of the needle already matched
+	if (l > 0 && memcmp(n, n + result.period, result.critical_pos+1) == 0)
+	{
+		result.memory_reset = l - result.period;
+	}
+	else
+	{
+		result.memory_reset = 0;
+		s32 right = l - result.critical_pos - 1;
+		result.period = (result.critical_pos > right ? result.critical_pos : right) + 1;
+	}
+	
+	return result;
+}
+
+// The matchers below are written once with an ignore_case argument and
+// instantiated for both cases, the argument is a constant after inlining.
+// In ignore case mode the needle is folded and text bytes are lowered before
+// every comparison.
+#define TEXT_SEARCH_FOLD(_ch, _ignore_case) ((_ignore_case) ? text_search_lower(_ch) : (_ch))
+
+__attribute__((always_inline))
+static inline bool text_search_equals(u8 *text, u8 *needle, s32 length, bool ignore_case)
+{
+	if (!ignore_case) return memcmp(text, needle, length) == 0;
+	
+	for (s32 i = 0; i < length; i++)
+	{
+		if (text_search_lower(text[i]) != needle[i]) return false;
+	}
+	return true;
+}
+
+__attribute__((always_inline))
+static inline s64 text_search_two_way(text_search_needle *needle, u8 *text, s64 text_length, bool ignore_case)
+{
+	u8 *n = (u8*)needle->text;
+	s32 l = needle->length;
+	s32 ms = needle->critical_pos;
+	
+	u8 *h = text;
+	u8 *last_start = text + text_length - l;
+	s32 mem = 0;
+	while (h <= last_start)
+	{
+		// bad character skip on the last byte of the window
+		s32 k = needle->skip[h[l-1]];
+		if (k)
+		{
+			if (k < mem) k = mem;
+			h += k;
+			mem = 0;
+			continue;
+		}
+		
+		// compare right half
+		k = (ms+1 > mem) ? ms+1 : mem;
+		while (k < l && n[k] == TEXT_SEARCH_FOLD(h[k], ignore_case)) k++;
+		if (k < l)
+		{
+			h += k - ms;
+			mem = 0;
+			continue;
+		}
+		
+		// compare left half
+		k = ms+1;
+		while (k > mem && n[k-1] == TEXT_SEARCH_FOLD(h[k-1], ignore_case)) k--;
+		if (k <= mem) return h - text;
+		
+		h += needle->period;
+		mem = needle->memory_reset;
+	}
+	
+	return -1;
+}
+
+static s64 text_search_find_two_way(text_search_needle *needle, u8 *text, s64 text_length)
+{
+	if (needle->ignore_case) return text_search_two_way(needle, text, text_length, true);
+	return text_search_two_way(needle, text, text_length, false);
+}
+
+// The first/last byte filters verify candidates with memcmp. When verification
+// work exceeds a few times the scanned length the rest of the text is searched
+// with two-way so the worst case stays linear.
+#define TEXT_SEARCH_VERIFY_BUDGET(_scanned) (4*(_scanned) + 4096)
+
+__attribute__((always_inline))
+static inline s64 text_search_first_last_scalar(text_search_needle *needle, u8 *text, s64 text_length, bool ignore_case)
+{
+	u8 *n = (u8*)needle->text;
+	s32 l = needle->length;
+	u8 *text_start = text;
+	u8 *last_start = text + text_length - l;
+	s64 work = 0;
+	
+	while (text <= last_start)
+	{
+		if (ignore_case)
+		{
+			while (text <= last_start && text_search_lower(*text) != n[0]) text++;
+			if (text > last_start) return -1;
+		}
+		else
+		{
+			text = memchr(text, n[0], last_start - text + 1);
+			if (!text) return -1;
+		}
+		
+		if (TEXT_SEARCH_FOLD(text[l-1], ignore_case) == n[l-1])
+		{
+			if (l <= 2 || text_search_equals(text+1, n+1, l-2, ignore_case))
+				return text - text_start;
+			
+			work += l;
+			if (work > TEXT_SEARCH_VERIFY_BUDGET(text - text_start))
+			{
+				s64 rest = text_search_find_two_way(needle, text, last_start - text + l);
+				return rest == -1 ? -1 : (text - text_start) + rest;
+			}
+		}
+		text++;
+	}
+	
+	return -1;
+}
+
+static s64 text_search_find_first_last_scalar(text_search_needle *needle, u8 *text, s64 text_length)
+{
+	if (needle->ignore_case) return text_search_first_last_scalar(needle, text, text_length, true);
+	return text_search_first_last_scalar(needle, text, text_length, false);
+}
+
+#ifdef TEXT_SEARCH_X86
+// Compare the first and last byte of the needle against 16/32 positions at once,
+// only positions where both match are verified with memcmp. In ignore case mode
+// text bytes are or'ed with 0x20 when the needle byte is a letter, which only maps
+// the upper case letter onto the lower case one.
+__attribute__((target("sse2"), always_inline))
+static inline s64 text_search_first_last_sse2(text_search_needle *needle, u8 *text, s64 text_length, bool ignore_case)
+{
+	u8 *n = (u8*)needle->text;
+	s32 l = needle->length;
+	__m128i first = _mm_set1_epi8(n[0]);
+	__m128i last = _mm_set1_epi8(n[l-1]);
+	__m128i first_case = _mm_set1_epi8((u8)(n[0] - 'a') < 26 ? 0x20 : 0);
+	__m128i last_case = _mm_set1_epi8((u8)(n[l-1] - 'a') < 26 ? 0x20 : 0);
+	s64 work = 0;
+	
+	s64 i = 0;
+	for (; i + l - 1 + 16 <= text_length; i += 16)
+	{
+		__m128i block_first = _mm_loadu_si128((__m128i*)(text + i));
+		__m128i block_last = _mm_loadu_si128((__m128i*)(text + i + l - 1));
+		if (ignore_case)
+		{
+			block_first = _mm_or_si128(block_first, first_case);
+			block_last = _mm_or_si128(block_last, last_case);
+		}
+		
+		u32 mask = _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(first, block_first),
+												   _mm_cmpeq_epi8(last, block_last)));
+		while (mask)
+		{
+			s32 bit = __builtin_ctz(mask);
+			if (l <= 2 || text_search_equals(text + i + bit + 1, n + 1, l - 2, ignore_case))
+				return i + bit;
+			mask &= mask - 1;
+			work += l;
+		}
+		
+		if (work > TEXT_SEARCH_VERIFY_BUDGET(i))
+			break;
+	}
+	
+	s64 rest;
+	if (work > TEXT_SEARCH_VERIFY_BUDGET(i))
+		rest = text_search_find_two_way(needle, text + i, text_length - i);
+	else
+		rest = text_search_find_first_last_scalar(needle, text + i, text_length - i);
+	return rest == -1 ? -1 : i + rest;
+}
+
+__attribute__((target("sse2")))
+static s64 text_search_find_first_last_sse2(text_search_needle *needle, u8 *text, s64 text_length)
+{
+	if (needle->ignore_case) return text_search_first_last_sse2(needle, text, text_length, true);
+	return text_search_first_last_sse2(needle, text, text_length, false);
+}
+
+__attribute__((target("avx2"), always_inline))
+static inline s64 text_search_first_last_avx2(text_search_needle *needle, u8 *text, s64 text_length, bool ignore_case)
+{
+	u8 *n = (u8*)needle->text;
+	s32 l = needle->length;
+	__m256i first = _mm256_set1_epi8(n[0]);
+	__m256i last = _mm256_set1_epi8(n[l-1]);
+	__m256i first_case = _mm256_set1_epi8((u8)(n[0] - 'a') < 26 ? 0x20 : 0);
+	__m256i last_case = _mm256_set1_epi8((u8)(n[l-1] - 'a') < 26 ? 0x20 : 0);
+	s64 work = 0;
+	
+	s64 i = 0;
+	for (; i + l - 1 + 32 <= text_length; i += 32)
+	{
+		__m256i block_first = _mm256_loadu_si256((__m256i*)(text + i));
+		__m256i block_last = _mm256_loadu_si256((__m256i*)(text + i + l - 1));
+		if (ignore_case)
+		{
+			block_first = _mm256_or_si256(block_first, first_case);
+			block_last = _mm256_or_si256(block_last, last_case);
+		}
+		
+		u32 mask = _mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(first, block_first),
+														 _mm256_cmpeq_epi8(last, block_last)));
+		while (mask)
+		{
+			s32 bit = __builtin_ctz(mask);
+			if (l <= 2 || text_search_equals(text + i + bit + 1, n + 1, l - 2, ignore_case))
+				return i + bit;
+			mask &= mask - 1;
+			work += l;
+		}
+		
+		if (work > TEXT_SEARCH_VERIFY_BUDGET(i))
+			break;
+	}
+	
+	s64 rest;
+	if (work > TEXT_SEARCH_VERIFY_BUDGET(i))
+		rest = text_search_find_two_way(needle, text + i, text_length - i);
+	else
+		rest = text_search_find_first_last_sse2(needle, text + i, text_length - i);
+	return rest == -1 ? -1 : i + rest;
+}
+
+__attribute__((target("avx2")))
+static s64 text_search_find_first_last_avx2(text_search_needle *needle, u8 *text, s64 text_length)
+{
+	if (needle->ignore_case) return text_search_first_last_avx2(needle, text, text_length, true);
+	return text_search_first_last_avx2(needle, text, text_length, false);
+}
+#endif
+
+static s64 text_search_find_bytes(text_search_needle *needle, u8 *text, s64 text_length)
+{
+	// memchr is already vectorized by libc
+	if (needle->length == 1 && !needle->ignore_case)
+	{
+		u8 *result = memchr(text, needle->text[0], text_length);
+		return result ? result - text : -1;
+	}
+	
+	if (needle->algorithm == TEXT_SEARCH_TWO_WAY)
+		return text_search_find_two_way(needle, text, text_length);
+	
+	if (text_search_active_kernel == TEXT_SEARCH_KERNEL_AUTO)
+		text_search_set_kernel(TEXT_SEARCH_KERNEL_AUTO);
+	
+	switch(text_search_active_kernel)
+	{
+#ifdef TEXT_SEARCH_X86
+		case TEXT_SEARCH_KERNEL_AVX2: return text_search_find_first_last_avx2(needle, text, text_length);
+		case TEXT_SEARCH_KERNEL_SSE2: return text_search_find_first_last_sse2(needle, text, text_length);
+#endif
+		default: return text_search_find_first_last_scalar(needle, text, text_length);
+	}
+}
+
+static bool text_search_is_ascii(u8 *text, s64 text_length)
+{
+	u64 high_bits = 0;
+	s64 i = 0;
+	for (; i + 8 <= text_length; i += 8)
+	{
+		u64 word;
+		memcpy(&word, text + i, 8);
+		high_bits |= word;
+	}
+	for (; i < text_length; i++) high_bits |= text[i];
+	
+	return (high_bits & 0x8080808080808080ull) == 0;
+}
+
+// codepoint by codepoint comparison of the folded text, only used for parts of
+// the text that contain non-ascii bytes.
+static s64 text_search_find_folded_utf8(text_search_needle *needle, u8 *text, s64 text_length, s32 *match_length)
+{
+	utf8_int32_t first = needle->codepoints[0];
+	u8 *end = text + text_length;
+	
+	u8 *start = text;
+	while (start < end)
+	{
+		// continuation bytes can not start a match
+		if ((*start & 0xC0) == 0x80)
+		{
+			start++;
+			continue;
+		}
+		
+		utf8_int32_t cp;
+		u8 *next = text_search_decode(start, end, &cp);
+		if (text_search_fold_codepoint(cp) == first)
+		{
+			u8 *cursor = next;
+			s32 matched = 1;
+			while (matched < needle->codepoint_count && cursor < end)
+			{
+				cursor = text_search_decode(cursor, end, &cp);
+				if (text_search_fold_codepoint(cp) != needle->codepoints[matched]) break;
+				matched++;
+			}
+			
+			if (matched == needle->codepoint_count)
+			{
+				*match_length = cursor - start;
+				return start - text;
+			}
+		}
+		start = next;
+	}
+	
+	return -1;
+}
+
+s64 text_search_find_needle_ex(text_search_needle *needle, char *text, s64 text_length, s32 *match_length)
+{
+	s32 needle_length = needle->length;
+	if (needle_length > text_length || needle_length == 0) return -1;
+	
+	if (!needle->ignore_case)
+	{
+		if (match_length) *match_length = needle_length;
+		return text_search_find_bytes(needle, (u8*)text, text_length);
+	}
+	
+	// ascii parts of the text are searched with the byte matchers, parts with other
+	// bytes are folded codepoint by codepoint. a folded needle with non-ascii
+	// codepoints can never match ascii text. segments start small and grow so
+	// checking them costs no more than searching up to the next match.
+	s32 overlap = needle->max_match_length - 1;
+	s64 segment_size = 256;
+	for (s64 start = 0; start + needle_length <= text_length; start += segment_size)
+	{
+		if (start) segment_size *= 2;
+		if (segment_size > TEXT_SEARCH_FOLD_SEGMENT_SIZE) segment_size = TEXT_SEARCH_FOLD_SEGMENT_SIZE;
+		
+		s64 segment_length = text_length - start;
+		if (segment_length > segment_size + overlap)
+			segment_length = segment_size + overlap;
+		
+		u8 *segment = (u8*)text + start;
+		s32 segment_match_length = needle_length;
+		s64 offset = -1;
+		if (text_search_is_ascii(segment, segment_length))
+		{
+			if (needle->is_ascii && segment_length >= needle_length)
+				offset = text_search_find_bytes(needle, segment, segment_length);
+		}
+		else
+		{
+			offset = text_search_find_folded_utf8(needle, segment, segment_length, &segment_match_length);
+		}
+		
+		if (offset != -1)
+		{
+			if (match_length) *match_length = segment_match_length;
+			return start + offset;
+		}
+	}
+	
+	return -1;
+}
+
+s64 text_search_find_literal(char *text, s64 text_length, char *needle, s32 needle_length)
+{
+	text_search_needle compiled = text_search_needle_create(needle, needle_length);
+	return text_search_find_needle(&compiled, text, text_length);
+}
+
+void text_search_needle_destroy(text_search_needle *needle)
+{
+	if (!needle->ignore_case) return;
+	
+	mem_free(needle->text);
+	mem_free(needle->codepoints);
+}
+
+static inline bool text_search_is_codepoint_start(char ch)
+{
+	return (ch & 0xC0) != 0x80;
+}
+
+static inline bool text_search_is_counted(u8 ch, bool codepoints)
+{
+	return codepoints ? text_search_is_codepoint_start(ch) : ch == '\n';
+}
+
+// counts newlines, or the bytes that start a codepoint, last receives the position
+// of the last newline counted and is left alone when there is none.
+__attribute__((always_inline))
+static inline s64 text_search_count_scalar(u8 *text, s64 length, bool codepoints, u8 **last)
+{
+	s64 count = 0;
+	for (s64 i = 0; i < length; i++)
+	{
+		if (text_search_is_counted(text[i], codepoints))
+		{
+			count++;
+			if (last) *last = text + i;
+		}
+	}
+	return count;
+}
+
+#ifdef TEXT_SEARCH_X86
+// continuation bytes are -128..-65 as signed bytes, everything above starts a codepoint
+__attribute__((target("sse2,popcnt"), always_inline))
+static inline s64 text_search_count_sse2(u8 *text, s64 length, bool codepoints, u8 **last)
+{
+	__m128i newline = _mm_set1_epi8('\n');
+	__m128i continuation = _mm_set1_epi8(-65);
+	s64 count = 0;
+	
+	s64 i = 0;
+	for (; i + 16 <= length; i += 16)
+	{
+		__m128i block = _mm_loadu_si128((__m128i*)(text + i));
+		u32 mask = _mm_movemask_epi8(codepoints ? _mm_cmpgt_epi8(block, continuation) : _mm_cmpeq_epi8(block, newline));
+		if (!mask) continue;
+		
+		count += __builtin_popcount(mask);
+		if (last) *last = text + i + 31 - __builtin_clz(mask);
+	}
+	
+	return count + text_search_count_scalar(text + i, length - i, codepoints, last);
+}
+
+__attribute__((target("avx2,popcnt"), always_inline))
+static inline s64 text_search_count_avx2(u8 *text, s64 length, bool codepoints, u8 **last)
+{
+	__m256i newline = _mm256_set1_epi8('\n');
+	__m256i continuation = _mm256_set1_epi8(-65);
+	s64 count = 0;
+	
+	s64 i = 0;
+	for (; i + 32 <= length; i += 32)
+	{
+		__m256i block = _mm256_loadu_si256((__m256i*)(text + i));
+		u32 mask = _mm256_movemask_epi8(codepoints ? _mm256_cmpgt_epi8(block, continuation) : _mm256_cmpeq_epi8(block, newline));
+		if (!mask) continue;
+		
+		count += __builtin_popcount(mask);
+		if (last) *last = text + i + 31 - __builtin_clz(mask);
+	}
+	
+	return count + text_search_count_scalar(text + i, length - i, codepoints, last);
+}
+
+__attribute__((target("sse2,popcnt")))
+static s64 text_search_count_sse2_newlines(u8 *text, s64 length, u8 **last)
+{
+	return text_search_count_sse2(text, length, false, last);
+}
+
+__attribute__((target("sse2,popcnt")))
+static s64 text_search_count_sse2_codepoints(u8 *text, s64 length)
+{
+	return text_search_count_sse2(text, length, true, 0);
+}
+
+__attribute__((target("avx2,popcnt")))
+static s64 text_search_count_avx2_newlines(u8 *text, s64 length, u8 **last)
+{
+	return text_search_count_avx2(text, length, false, last);
+}
+
+__attribute__((target("avx2,popcnt")))
+static s64 text_search_count_avx2_codepoints(u8 *text, s64 length)
+{
+	return text_search_count_avx2(text, length, true, 0);
+}
+#endif
+
+s64 text_search_count_newlines(char *text, s64 length, char **last_newline)
+{
+	if (text_search_active_kernel == TEXT_SEARCH_KERNEL_AUTO)
+		text_search_set_kernel(TEXT_SEARCH_KERNEL_AUTO);
+	
+	// written back through a char pointer, a u8** cast of last_newline would not
+	// be seen by the caller under strict aliasing
+	u8 *last = (u8*)*last_newline;
+	s64 count;
+	switch(text_search_active_kernel)
+	{
+#ifdef TEXT_SEARCH_X86
+		case TEXT_SEARCH_KERNEL_AVX2: count = text_search_count_avx2_newlines((u8*)text, length, &last); break;
+		case TEXT_SEARCH_KERNEL_SSE2: count = text_search_count_sse2_newlines((u8*)text, length, &last); break;
+#endif
+		default: count = text_search_count_scalar((u8*)text, length, false, &last); break;
+	}
+	*last_newline = (char*)last;
+	return count;
+}
+
+s64 text_search_count_codepoints(char *text, s64 length)
+{
+	// not worth a vector for the length of a typical match
+	if (length < 16)
+		return text_search_count_scalar((u8*)text, length, true, 0);
+	
+	if (text_search_active_kernel == TEXT_SEARCH_KERNEL_AUTO)
+		text_search_set_kernel(TEXT_SEARCH_KERNEL_AUTO);
+	
+	switch(text_search_active_kernel)
+	{
+#ifdef TEXT_SEARCH_X86
+		case TEXT_SEARCH_KERNEL_AVX2: return text_search_count_avx2_codepoints((u8*)text, length);
+		case TEXT_SEARCH_KERNEL_SSE2: return text_search_count_sse2_codepoints((u8*)text, length);
+#endif
+		default: return text_search_count_scalar((u8*)text, length, true, 0);
+	}
+}
+
+text_search_lines text_search_lines_create(char *text)
+{
+	text_search_lines lines;
+	lines.counted_until = text;
+	lines.line_start = text;
+	lines.line_nr = 1;
+	lines.column_start = text;
+	lines.column = 0;
+	return lines;
+}
+
+void text_search_lines_locate(text_search_lines *lines, char *match, text_match *result)
+{
+	// the first character of the match is included, a match starting
+	// with a newline is reported on the next line at offset -1
+	if (lines->counted_until <= match)
+	{
+		char *last_newline = 0;
+		lines->line_nr += text_search_count_newlines(lines->counted_until, match + 1 - lines->counted_until, &last_newline);
+		if (last_newline) lines->line_start = last_newline + 1;
+		lines->counted_until = match + 1;
+	}
+	
+	if (lines->column_start < lines->line_start)
+	{
+		lines->column_start = lines->line_start;
+		lines->column = 0;
+	}
+	if (lines->column_start < match)
+	{
+		lines->column += text_search_count_codepoints(lines->column_start, match - lines->column_start);
+		lines->column_start = match;
+	}
+	
+	result->line_nr = lines->line_nr;
+	result->word_offset = lines->line_start > match ? -1 : lines->column;
+	result->line_start = lines->line_start;
+}
+
+// finds the matches that start in [start, end), they can continue up to text_end.
+// line numbers are counted from start.
+static bool text_search_literal_range(text_search_needle *needle, char *start, char *end, char *text_end, array *text_matches, s64 *match_count, bool *cancel_search)
+{
+	bool save_info = (text_matches != 0);
+	s32 needle_length = needle->length;
+	s32 overlap = needle->max_match_length - 1;
+	
+	char *search_end = text_end - end > overlap ? end + overlap : text_end;
+	text_search_lines lines = text_search_lines_create(start);
+	bool final_result = false;
+	
+	char *cursor = start;
+	while (cursor + needle_length <= search_end)
+	{
+		if (cancel_search && *cancel_search)
+		{
+			final_result = false;
+			break;
+		}
+		
+		// search one block at a time so cancel_search is checked regularly,
+		// blocks overlap by the longest match minus one byte so no match is missed
+		s64 block_length = search_end - cursor;
+		if (block_length > TEXT_SEARCH_BLOCK_SIZE + overlap)
+			block_length = TEXT_SEARCH_BLOCK_SIZE + overlap;
+		
+		s32 match_length;
+		s64 offset = text_search_find_needle_ex(needle, cursor, block_length, &match_length);
+		if (offset == -1)
+		{
+			if (cursor + block_length == search_end) break;
+			cursor += block_length - overlap;
+			continue;
+		}
+		
+		char *match = cursor + offset;
+		if (match >= end) break;
+		final_result = true;
+		if (match_count) (*match_count)++;
+		
+		if (save_info)
+		{
+			text_match new_match;
+			text_search_lines_locate(&lines, match, &new_match);
+			// length of the matched text, the wildcard matcher reports one character
+			// less for a match that ends the text
+			s32 match_char_length = text_search_count_codepoints(match, match_length);
+			new_match.word_match_len = (match + match_length == text_end) ? match_char_length-1 : match_char_length;
+			new_match.line_info = 0;
+			array_push(text_matches, &new_match);
+		}
+		else if (!match_count) break;
+		
+		// matches can overlap
+		cursor = match + 1;
+	}
+	
+	return final_result;
+}
+
+bool text_search_literal_ex(char *text_to_search, char *text_to_find, array *text_matches, s64 *match_count, bool *cancel_search, bool ignore_case)
+{
+	char *text_end = text_to_search + strlen(text_to_search);
+	text_search_needle needle = text_search_needle_create_ex(text_to_find, strlen(text_to_find), ignore_case);
+	bool final_result = text_search_literal_range(&needle, text_to_search, text_end, text_end, text_matches, match_count, cancel_search);
+	text_search_needle_destroy(&needle);
+	return final_result;
+}
+
+typedef struct t_text_search_magic
+{
+	char *bytes;
+	s32 length;
+} text_search_magic;
+
+// only signatures with bytes that don't occur in text, files starting with a
+// printable signature like "MZ" or "RIFF" are left to the content check
+static text_search_magic text_search_binary_magic[] =
+{
+	{"\x89PNG\r\n\x1A\n", 8},
+	{"\xFF\xD8\xFF", 3}, // jpeg
+	{"PK\x03\x04", 4}, // zip, jar, docx
+	{"PK\x05\x06", 4}, // empty zip
+	{"\x1F\x8B", 2}, // gzip
+	{"\xFD" "7zXZ\x00", 6},
+	{"7z\xBC\xAF\x27\x1C", 6},
+	{"\x28\xB5\x2F\xFD", 4}, // zstd
+	{"Rar!\x1A\x07", 6},
+	{"\x7F" "ELF", 4},
+	{"\xCA\xFE\xBA\xBE", 4}, // java class, mach-o fat binary
+	{"\xFE\xED\xFA\xCE", 4}, // mach-o
+	{"\xFE\xED\xFA\xCF", 4},
+	{"\xCE\xFA\xED\xFE", 4},
+	{"\xCF\xFA\xED\xFE", 4},
+	{"\x00" "asm", 4}, // webassembly
+	{"SQLite format 3\x00", 16},
+};
+
+bool text_search_is_binary(char *content, s64 content_length)
+{
+	u8 *text = (u8*)content;
+	s64 length = content_length < TEXT_SEARCH_SNIFF_SIZE ? content_length : TEXT_SEARCH_SNIFF_SIZE;
+	
+	for (s32 i = 0; i < sizeof(text_search_binary_magic)/sizeof(text_search_magic); i++)
+	{
+		text_search_magic *magic = &text_search_binary_magic[i];
+		if (length >= magic->length && memcmp(text, magic->bytes, magic->length) == 0)
+			return true;
+	}
+	
+	if (memchr(text, 0, length)) return true;
+	
+	s64 suspicious = 0;
+	u8 *end = text + length;
+	for (u8 *ch = text; ch < end;)
+	{
+		if (*ch >= 0x20 && *ch < 0x7F)
+		{
+			ch++;
+			continue;
+		}
+		
+		// sequence cut off by the end of the block
+		if (*ch >= 0xC0 && end - ch < 4) break;
+		
+		utf8_int32_t cp;
+		u8 *next = text_search_decode(ch, end, &cp);
+		if (cp & TEXT_SEARCH_INVALID_BYTE) suspicious++;
+		else if (cp < 0x20 && cp != '\n' && cp != '\r' && cp != '\t' && cp != '\f' && cp != '\v' && cp != '\b' && cp != 0x1B) suspicious++;
+		else if (cp == 0x7F) suspicious++;
+		ch = next;
+	}
+	
+	return suspicious*100 > length*TEXT_SEARCH_BINARY_PERCENTAGE;
+}
+
+bool text_search_raw(char *content, s64 content_length, char *text_to_find, struct t_text_regex *regex, array *text_matches, bool *cancel_search, bool ignore_case)
+{
+	char *query = text_to_find;
+	while (*query == '*') query++;
+	
+	char *match = 0;
+	if (regex)
+	{
+		s64 offset;
+		if (text_regex_find(regex, content, content_length, &offset, 0, cancel_search))
+			match = content + offset;
+	}
+	else if (text_search_is_literal(query))
+	{
+		text_search_needle needle = text_search_needle_create_ex(query, strlen(query), ignore_case);
+		s64 offset = text_search_find_needle_ex(&needle, content, content_length, 0);
+		text_search_needle_destroy(&needle);
+		
+		if (offset != -1) match = content + offset;
+	}
+	else
+	{
+		// wildcard queries are matched against every part between NUL bytes
+		char *end = content + content_length;
+		for (char *part = content; part < end; part += strlen(part) + 1)
+		{
+			if (cancel_search && *cancel_search) return false;
+			
+			if (string_contains_wildcard(part, text_to_find, 0, cancel_search, ignore_case))
+			{
+				match = part;
+				break;
+			}
+		}
+	}
+	
+	if (!match) return false;
+	
+	if (text_matches)
+	{
+		text_match new_match;
+		new_match.line_nr = 0;
+		new_match.word_offset = match - content;
+		new_match.word_match_len = 0;
+		new_match.line_start = match;
+		new_match.line_info = 0;
+		array_push(text_matches, &new_match);
+	}
+	
+	return true;
+}
+
+bool text_search_content(file_content *content, char *text_to_find, struct t_text_regex *regex, array *text_matches, bool *cancel_search, bool ignore_case, binary_file_mode binary_mode, search_info *info)
+{
+	if (!content->content) return false;
+	
+	if (binary_mode != BINARY_FILES_TEXT && text_search_is_binary(content->content, content->content_length))
+	{
+		if (binary_mode == BINARY_FILES_RAW)
+			return text_search_raw(content->content, content->content_length, text_to_find, regex, text_matches, cancel_search, ignore_case);
+		
+		if (info) __atomic_fetch_add(&info->binary_skip_count, 1, __ATOMIC_RELAXED);
+		return false;
+	}
+	
+	if (regex)
+		return text_regex_search(regex, content->content, content->content_length, text_matches, cancel_search);
+	if (ignore_case)
+		return string_contains_ignore_case(content->content, text_to_find, text_matches, cancel_search);
+	return string_contains_ex(content->content, text_to_find, text_matches, cancel_search);
+}
+
+s64 text_search_count_content(file_content *content, char *text_to_find, struct t_text_regex *regex, bool *cancel_search, bool ignore_case, binary_file_mode binary_mode, search_info *info)
+{
+	if (!content->content) return 0;
+	
+	if (binary_mode != BINARY_FILES_TEXT && text_search_is_binary(content->content, content->content_length))
+	{
+		if (binary_mode == BINARY_FILES_RAW)
+			return text_search_raw(content->content, content->content_length, text_to_find, regex, 0, cancel_search, ignore_case) ? 1 : 0;
+		
+		if (info) __atomic_fetch_add(&info->binary_skip_count, 1, __ATOMIC_RELAXED);
+		return 0;
+	}
+	
+	if (regex)
+		return text_regex_count(regex, content->content, content->content_length, cancel_search);
+	return string_count_matches(content->content, text_to_find, cancel_search, ignore_case);
+}
+
+text_search_split *text_search_split_create(file_content *content, char *text_to_find, struct t_text_regex *regex, bool *cancel_search, bool ignore_case, binary_file_mode binary_mode, search_mode mode)
+{
+	if (!content->content || content->content_length < TEXT_SEARCH_SPLIT_MIN_SIZE) return 0;
+	if (binary_mode != BINARY_FILES_TEXT && text_search_is_binary(content->content, content->content_length)) return 0;
+	
+	// same query handling as string_contains_ex
+	char *query = text_to_find;
+	if (!regex)
+	{
+		while (*query == '*') query++;
+		if (!*query || !text_search_is_literal(query)) return 0;
+	}
+	else if (!regex->is_single_line) return 0;
+	
+	text_search_split *split = mem_alloc(sizeof(text_search_split));
+	split->text = content->content;
+	// the text matchers stop at the first NUL byte, regexes search the whole content
+	split->text_end = split->text + (regex ? content->content_length : (s64)strlen(split->text));
+	split->mode = mode;
+	split->found = false;
+	split->cancel_search = cancel_search;
+	split->is_literal = !regex;
+	split->regex = regex;
+	if (split->is_literal) split->needle = text_search_needle_create_ex(query, strlen(query), ignore_case);
+	split->next_range = 0;
+	split->done_count = 0;
+	
+	s64 text_length = split->text_end - split->text;
+	s32 max_range_count = (text_length + TEXT_SEARCH_SPLIT_RANGE_SIZE - 1) / TEXT_SEARCH_SPLIT_RANGE_SIZE;
+	split->ranges = mem_alloc(sizeof(text_search_range)*max_range_count);
+	split->range_count = 0;
+	
+	// ranges end after the first newline past their nominal size
+	char *start = split->text;
+	while (start < split->text_end)
+	{
+		char *end = split->text_end;
+		if (split->text_end - start > TEXT_SEARCH_SPLIT_RANGE_SIZE)
+		{
+			char *newline = memchr(start + TEXT_SEARCH_SPLIT_RANGE_SIZE, '\n', split->text_end - start - TEXT_SEARCH_SPLIT_RANGE_SIZE);
+			if (newline) end = newline + 1;
+		}
+		
+		text_search_range *range = &split->ranges[split->range_count++];
+		range->start = start;
+		range->end = end;
+		range->newline_count = 0;
+		range->match_count = 0;
+		range->matches = array_create(sizeof(text_match));
+		range->matches.reserve_jump = 1024;
+		range->result = false;
+		start = end;
+	}
+	
+	return split;
+}
+
+s32 text_search_split_claim(text_search_split *split)
+{
+	s32 range = __atomic_fetch_add(&split->next_range, 1, __ATOMIC_RELAXED);
+	return range < split->range_count ? range : -1;
+}
+
+void text_search_split_search(text_search_split *split, s32 range_index)
+{
+	text_search_range *range = &split->ranges[range_index];
+	
+	// one match is enough, later ranges are claimed but not searched
+	if (split->mode == SEARCH_MODE_FILES_WITH_MATCHES && __atomic_load_n(&split->found, __ATOMIC_RELAXED))
+	{
+		__atomic_fetch_add(&split->done_count, 1, __ATOMIC_RELEASE);
+		return;
+	}
+	
+	array *text_matches = split->mode == SEARCH_MODE_MATCHES ? &range->matches : 0;
+	s64 *match_count = split->mode == SEARCH_MODE_COUNT ? &range->match_count : 0;
+	if (split->is_literal)
+		range->result = text_search_literal_range(&split->needle, range->start, range->end, split->text_end, text_matches, match_count, split->cancel_search);
+	else if (match_count)
+	{
+		*match_count = text_regex_count(split->regex, range->start, range->end - range->start, split->cancel_search);
+		range->result = *match_count > 0;
+	}
+	else
+		range->result = text_regex_search(split->regex, range->start, range->end - range->start, text_matches, split->cancel_search);
+	if (range->result) __atomic_store_n(&split->found, true, __ATOMIC_RELAXED);
+	
+	char *last_newline = 0;
+	range->newline_count = text_search_count_newlines(range->start, range->end - range->start, &last_newline);
+	
+	__atomic_fetch_add(&split->done_count, 1, __ATOMIC_RELEASE);
+}
+
+bool text_search_split_finish(text_search_split *split, array *text_matches, s64 *match_count)
+{
+	s32 range;
+	while ((range = text_search_split_claim(split)) != -1)
+		text_search_split_search(split, range);
+	
+	// other threads can still be searching the ranges they claimed
+	while (__atomic_load_n(&split->done_count, __ATOMIC_ACQUIRE) < split->range_count)
+		thread_sleep(TEXT_SEARCH_SPLIT_WAIT_US);
+	
+	bool cancelled = split->cancel_search && *split->cancel_search;
+	bool result = false;
+	s64 line_offset = 0;
+	for (s32 i = 0; i < split->range_count; i++)
+	{
+		text_search_range *range = &split->ranges[i];
+		result |= range->result;
+		if (match_count && !cancelled) *match_count += range->match_count;
+		
+		for (s32 m = 0; m < range->matches.length && text_matches && !cancelled; m++)
+		{
+			text_match *match = array_at(&range->matches, m);
+			match->line_nr += line_offset;
+			array_push(text_matches, match);
+		}
+		line_offset += range->newline_count;
+		
+		array_destroy(&range->matches);
+	}
+	
+	if (split->is_literal) text_search_needle_destroy(&split->needle);
+	mem_free(split->ranges);
+	mem_free(split);
+	
+	return result && !cancelled;
+}
\ No newline at end of file
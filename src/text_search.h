@@ -0,0 +1,184 @@
+/* 
+*  BSD 2-Clause “Simplified” License
+*  Copyright (c) 2019, Aldrik Ramaekers, aldrik.ramaekers@protonmail.com
+*  All rights reserved.
+*/
+
+#ifndef INCLUDE_TEXT_SEARCH
+#define INCLUDE_TEXT_SEARCH
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define TEXT_SEARCH_X86
+#include <immintrin.h>
+#endif
+
+// text is searched in blocks of this size so cancel_search is checked regularly
+#define TEXT_SEARCH_BLOCK_SIZE megabytes(1)
+
+typedef enum t_text_search_kernel
+{
+	TEXT_SEARCH_KERNEL_AUTO,
+	TEXT_SEARCH_KERNEL_SCALAR,
+	TEXT_SEARCH_KERNEL_SSE2,
+	TEXT_SEARCH_KERNEL_AVX2,
+} text_search_kernel;
+
+typedef enum t_text_search_algorithm
+{
+	TEXT_SEARCH_FIRST_LAST_FILTER, // candidate filter on first and last byte
+	TEXT_SEARCH_TWO_WAY, // Crochemore-Perrin with a skip table, long or repetitive needles
+} text_search_algorithm;
+
+// the vectorized filter beats two-way at every needle length and falls back to
+// two-way itself on candidate-heavy input, the scalar filter only wins for short
+// needles. these limits apply to the scalar kernel.
+#define TEXT_SEARCH_TWO_WAY_MIN_LENGTH 64
+#define TEXT_SEARCH_SMALL_ALPHABET 2
+
+// in ignore case mode text is checked for non-ascii bytes in segments of this size,
+// only segments that contain them are searched codepoint by codepoint
+#define TEXT_SEARCH_FOLD_SEGMENT_SIZE kilobytes(16)
+
+typedef struct t_text_search_needle
+{
+	char *text; // folded in ignore case mode
+	s32 length;
+	text_search_algorithm algorithm;
+	
+	// ignore case mode
+	bool ignore_case;
+	bool is_ascii; // folded needle has no multi-byte codepoints
+	s32 max_match_length; // bytes of text a match can span
+	utf8_int32_t *codepoints; // folded needle
+	s32 codepoint_count;
+	
+	// two-way factorization
+	s32 critical_pos;
+	s32 period;
+	s32 memory_reset; // needle-period when the needle is periodic, 0 otherwise
+	s32 skip[256]; // distance from the last occurrence of a byte to the end of the needle
+} text_search_needle;
+
+extern text_search_kernel text_search_active_kernel;
+
+// used by benchmarks to compare kernels, AUTO selects the fastest supported kernel
+void text_search_set_kernel(text_search_kernel kernel);
+char *text_search_kernel_name(text_search_kernel kernel);
+
+bool text_search_is_literal(char *text_to_find);
+
+// Both return the byte offset of the first occurrence of needle or -1. Create the
+// needle once when searching for the same text repeatedly. Worst case is linear
+// in text_length for every needle searched case sensitive or in ascii text.
+// match_length receives the number of bytes matched, which can differ from the
+// needle length when case is ignored.
+#define text_search_needle_create(needle, needle_length) text_search_needle_create_ex(needle, needle_length, false)
+#define text_search_find_needle(needle, text, text_length) text_search_find_needle_ex(needle, text, text_length, 0)
+text_search_needle text_search_needle_create_ex(char *needle, s32 needle_length, bool ignore_case);
+s64 text_search_find_needle_ex(text_search_needle *needle, char *text, s64 text_length, s32 *match_length);
+void text_search_needle_destroy(text_search_needle *needle);
+s64 text_search_find_literal(char *text, s64 text_length, char *needle, s32 needle_length);
+
+// simple case folding used by the ignore case mode
+utf8_int32_t text_search_fold_codepoint(utf8_int32_t cp);
+
+// binary content is detected on the first block of this size
+#define TEXT_SEARCH_SNIFF_SIZE 8192
+// content is binary when more than this percentage of the first block is invalid
+// utf8 or control characters
+#define TEXT_SEARCH_BINARY_PERCENTAGE 10
+
+// true for content that starts with a known binary file signature, has a NUL byte
+// in the first block or too many bytes that don't belong in text.
+bool text_search_is_binary(char *content, s64 content_length);
+
+// searches content including NUL bytes. a match is reported once, at the first
+// occurrence, with line_nr 0 and word_offset set to the byte offset in content.
+bool text_search_raw(char *content, s64 content_length, char *text_to_find, struct t_text_regex *regex, array *text_matches, bool *cancel_search, bool ignore_case);
+
+// searches file content like string_contains_ex, binary content is skipped and
+// counted in info or searched as raw bytes depending on binary_mode. content is
+// matched against regex instead of text_to_find when it is set. without
+// text_matches the search stops at the first match.
+bool text_search_content(file_content *content, char *text_to_find, struct t_text_regex *regex, array *text_matches, bool *cancel_search, bool ignore_case, binary_file_mode binary_mode, search_info *info);
+// same search, returns the number of matches text_search_content would find
+// without saving them. a raw binary match counts as one.
+s64 text_search_count_content(file_content *content, char *text_to_find, struct t_text_regex *regex, bool *cancel_search, bool ignore_case, binary_file_mode binary_mode, search_info *info);
+
+// line bookkeeping for matchers that find matches first, newlines and columns are
+// only counted up to the next match so text without matches costs nothing.
+typedef struct t_text_search_lines
+{
+	char *counted_until; // newlines before this point are counted
+	char *line_start;
+	s32 line_nr;
+	char *column_start; // codepoints before this point on the current line are counted
+	s32 column;
+} text_search_lines;
+
+// vectorized, last_newline receives the last newline in text and is left alone when
+// there is none.
+s64 text_search_count_newlines(char *text, s64 length, char **last_newline);
+s64 text_search_count_codepoints(char *text, s64 length);
+
+// matches have to be located in ascending order, fills in line_nr, word_offset and
+// line_start of result.
+text_search_lines text_search_lines_create(char *text);
+void text_search_lines_locate(text_search_lines *lines, char *match, text_match *result);
+
+// same results as string_contains_ex for queries without wildcards. every match is
+// counted in match_count when it is set, also without text_matches.
+#define text_search_literal(text_to_search, text_to_find, text_matches, cancel_search, ignore_case) text_search_literal_ex(text_to_search, text_to_find, text_matches, 0, cancel_search, ignore_case)
+bool text_search_literal_ex(char *text_to_search, char *text_to_find, array *text_matches, s64 *match_count, bool *cancel_search, bool ignore_case);
+
+// content of at least this size is split into ranges that are searched by
+// several threads at once
+#define TEXT_SEARCH_SPLIT_MIN_SIZE (megabytes(16))
+#define TEXT_SEARCH_SPLIT_RANGE_SIZE (megabytes(4))
+#define TEXT_SEARCH_SPLIT_WAIT_US 100
+
+typedef struct t_text_search_range
+{
+	char *start; // first byte of a line
+	char *end; // matches start before end, literal matches can continue past it
+	s64 newline_count; // in [start, end)
+	array matches; // text_match, line numbers counted from start
+	s64 match_count; // SEARCH_MODE_COUNT
+	bool result;
+} text_search_range;
+
+typedef struct t_text_search_split
+{
+	char *text;
+	char *text_end;
+	search_mode mode;
+	bool found; // a range has a match, SEARCH_MODE_FILES_WITH_MATCHES skips the rest
+	bool *cancel_search;
+	bool is_literal;
+	text_search_needle needle;
+	struct t_text_regex *regex;
+	
+	s32 range_count;
+	text_search_range *ranges;
+	s32 next_range;
+	s32 done_count;
+} text_search_split;
+
+// Ranges start at line boundaries, so a match is found in the range it starts in.
+// Line numbers are fixed up with a prefix sum of the newlines in earlier ranges.
+// Splitting is only done for literal queries and regexes that can't match a newline.
+// It returns 0 for small or binary content and for wildcard queries; search
+// those with text_search_content.
+// mode decides whether matches are saved, counted or only the first one is found.
+text_search_split *text_search_split_create(file_content *content, char *text_to_find, struct t_text_regex *regex, bool *cancel_search, bool ignore_case, binary_file_mode binary_mode, search_mode mode);
+// returns the index of a range no thread took yet or -1. the thread that created the
+// split claims ranges until none are left, other threads can claim ranges as long as
+// it has not called text_search_split_finish.
+s32 text_search_split_claim(text_search_split *split);
+void text_search_split_search(text_search_split *split, s32 range);
+// waits until every range is searched, appends the matches to text_matches in order
+// or adds their number to match_count and destroys the split. same result as
+// text_search_content.
+bool text_search_split_finish(text_search_split *split, array *text_matches, s64 *match_count);
+
+#endif
\ No newline at end of file
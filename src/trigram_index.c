@@ -0,0 +1,679 @@
+/* 
+*  BSD 2-Clause “Simplified” License
+*  Copyright (c) 2019, Aldrik Ramaekers, aldrik.ramaekers@protonmail.com
+*  All rights reserved.
+*/
+
+typedef struct t_trigram_index_posting
+{
+	u32 trigram;
+	u32 last_file; // file index + 1 of the last file added, so a file is added once
+	u32 count;
+	u32 capacity;
+	u32 *files;
+} trigram_index_posting;
+
+typedef struct t_trigram_index_builder
+{
+	s32 *slots; // open addressing table of indices into postings, -1 when empty
+	s32 slot_bits;
+	trigram_index_posting *postings;
+	s32 posting_count;
+	s32 posting_capacity;
+} trigram_index_builder;
+
+static inline u32 trigram_index_lower(u8 ch)
+{
+	return (u8)(ch - 'A') < 26 ? ch | 0x20 : ch;
+}
+
+static inline u32 trigram_index_slot(u32 trigram, s32 slot_bits)
+{
+	return (trigram * 2654435761u) >> (32 - slot_bits);
+}
+
+static trigram_index_builder trigram_index_builder_create()
+{
+	trigram_index_builder builder;
+	builder.slot_bits = 16;
+	builder.slots = mem_alloc(sizeof(s32) << builder.slot_bits);
+	memset(builder.slots, 0xFF, sizeof(s32) << builder.slot_bits);
+	builder.posting_capacity = 1 << (builder.slot_bits - 1);
+	builder.postings = mem_alloc(sizeof(trigram_index_posting)*builder.posting_capacity);
+	builder.posting_count = 0;
+	return builder;
+}
+
+static void trigram_index_builder_destroy(trigram_index_builder *builder)
+{
+	for (s32 i = 0; i < builder->posting_count; i++)
+	{
+		mem_free(builder->postings[i].files);
+	}
+	mem_free(builder->postings);
+	mem_free(builder->slots);
+}
+
+static void trigram_index_builder_grow(trigram_index_builder *builder)
+{
+	mem_free(builder->slots);
+	builder->slot_bits++;
+	builder->slots = mem_alloc(sizeof(s32) << builder->slot_bits);
+	memset(builder->slots, 0xFF, sizeof(s32) << builder->slot_bits);
+	
+	u32 mask = (1u << builder->slot_bits) - 1;
+	for (s32 i = 0; i < builder->posting_count; i++)
+	{
+		u32 slot = trigram_index_slot(builder->postings[i].trigram, builder->slot_bits);
+		while (builder->slots[slot] != -1) slot = (slot + 1) & mask;
+		builder->slots[slot] = i;
+	}
+	
+	builder->posting_capacity = 1 << (builder->slot_bits - 1);
+	builder->postings = mem_realloc(builder->postings, sizeof(trigram_index_posting)*builder->posting_capacity);
+}
+
+static trigram_index_posting *trigram_index_builder_get(trigram_index_builder *builder, u32 trigram)
+{
+	u32 mask = (1u << builder->slot_bits) - 1;
+	u32 slot = trigram_index_slot(trigram, builder->slot_bits);
+	while (builder->slots[slot] != -1)
+	{
+		trigram_index_posting *posting = &builder->postings[builder->slots[slot]];
+		if (posting->trigram == trigram) return posting;
+		slot = (slot + 1) & mask;
+	}
+	
+	// table is kept at most half full
+	if (builder->posting_count == builder->posting_capacity)
+	{
+		trigram_index_builder_grow(builder);
+		return trigram_index_builder_get(builder, trigram);
+	}
+	
+	builder->slots[slot] = builder->posting_count;
+	trigram_index_posting *posting = &builder->postings[builder->posting_count++];
+	posting->trigram = trigram;
+	posting->last_file = 0;
+	posting->count = 0;
+	posting->capacity = 0;
+	posting->files = 0;
+	return posting;
+}
+
+static void trigram_index_builder_add(trigram_index_builder *builder, u8 *content, s64 length, u32 file_index)
+{
+	if (length < 3) return;
+	
+	u32 trigram = (trigram_index_lower(content[0]) << 8) | trigram_index_lower(content[1]);
+	for (s64 i = 2; i < length; i++)
+	{
+		trigram = ((trigram << 8) | trigram_index_lower(content[i])) & 0xFFFFFF;
+		
+		trigram_index_posting *posting = trigram_index_builder_get(builder, trigram);
+		if (posting->last_file == file_index + 1) continue;
+		posting->last_file = file_index + 1;
+		
+		if (posting->count == posting->capacity)
+		{
+			posting->capacity = posting->capacity ? posting->capacity*2 : 4;
+			if (posting->files)
+			{
+				posting->files = mem_realloc(posting->files, sizeof(u32)*posting->capacity);
+			}
+			else
+			{
+				posting->files = mem_alloc(sizeof(u32)*posting->capacity);
+			}
+		}
+		posting->files[posting->count++] = file_index;
+	}
+}
+
+static s32 trigram_index_compare_u32(const void *a, const void *b)
+{
+	u32 x = *(u32*)a;
+	u32 y = *(u32*)b;
+	return x < y ? -1 : x > y;
+}
+
+static s32 trigram_index_compare_postings(const void *a, const void *b)
+{
+	return trigram_index_compare_u32(&((trigram_index_posting*)a)->trigram, &((trigram_index_posting*)b)->trigram);
+}
+
+static s32 trigram_index_compare_found_files(const void *a, const void *b)
+{
+	return strcmp(((found_file*)a)->path, ((found_file*)b)->path);
+}
+
+static s32 trigram_index_varint_length(u32 value)
+{
+	s32 length = 1;
+	while (value >= 0x80)
+	{
+		value >>= 7;
+		length++;
+	}
+	return length;
+}
+
+static s32 trigram_index_write_varint(u8 *buffer, u32 value)
+{
+	s32 length = 0;
+	while (value >= 0x80)
+	{
+		buffer[length++] = (value & 0x7F) | 0x80;
+		value >>= 7;
+	}
+	buffer[length++] = value;
+	return length;
+}
+
+static bool trigram_index_read_varint(u8 **cursor, u8 *end, u32 *value)
+{
+	u32 result = 0;
+	for (s32 shift = 0; shift < 35 && *cursor < end; shift += 7)
+	{
+		u8 byte = *(*cursor)++;
+		result |= (u32)(byte & 0x7F) << shift;
+		if (!(byte & 0x80))
+		{
+			*value = result;
+			return true;
+		}
+	}
+	return false;
+}
+
+static bool trigram_index_write_padding(FILE *file, u64 *offset)
+{
+	u8 zero[8] = {0};
+	s32 padding = (8 - (*offset % 8)) % 8;
+	*offset += padding;
+	return fwrite(zero, 1, padding, file) == padding;
+}
+
+static bool trigram_index_write(trigram_index_builder *builder, array *list, trigram_index_file *files, char *index_path)
+{
+	// postings are written sorted by trigram, files within a posting are added in
+	// the order they are read
+	qsort(builder->postings, builder->posting_count, sizeof(trigram_index_posting), trigram_index_compare_postings);
+	for (s32 i = 0; i < builder->posting_count; i++)
+	{
+		trigram_index_posting *posting = &builder->postings[i];
+		qsort(posting->files, posting->count, sizeof(u32), trigram_index_compare_u32);
+	}
+	
+	trigram_index_header header;
+	header.magic = TRIGRAM_INDEX_MAGIC;
+	header.version = TRIGRAM_INDEX_VERSION;
+	header.file_count = list->length;
+	header.trigram_count = builder->posting_count;
+	header.files_offset = sizeof(trigram_index_header);
+	header.trigrams_offset = header.files_offset + (u64)header.file_count*sizeof(trigram_index_file);
+	header.postings_offset = header.trigrams_offset + (u64)header.trigram_count*sizeof(trigram_index_entry);
+	
+	u64 postings_size = 0;
+	for (s32 i = 0; i < builder->posting_count; i++)
+	{
+		trigram_index_posting *posting = &builder->postings[i];
+		u32 previous = 0;
+		for (u32 f = 0; f < posting->count; f++)
+		{
+			postings_size += trigram_index_varint_length(posting->files[f] - previous);
+			previous = posting->files[f];
+		}
+	}
+	header.paths_offset = header.postings_offset + postings_size;
+	header.paths_offset += (8 - (header.paths_offset % 8)) % 8;
+	
+	u64 paths_size = 0;
+	for (s32 i = 0; i < list->length; i++)
+	{
+		files[i].path_offset = paths_size;
+		paths_size += strlen(((found_file*)list->data)[i].path) + 1;
+	}
+	header.index_size = header.paths_offset + paths_size;
+	
+	// written next to the index and renamed so readers never see a partial file
+	char temp_path[MAX_INPUT_LENGTH];
+	snprintf(temp_path, MAX_INPUT_LENGTH, "%s.tmp", index_path);
+	FILE *file = fopen(temp_path, "wb");
+	if (!file) return false;
+	
+	bool result = true;
+	result &= fwrite(&header, sizeof(header), 1, file) == 1;
+	if (header.file_count)
+		result &= fwrite(files, sizeof(trigram_index_file), header.file_count, file) == header.file_count;
+	
+	u64 postings_offset = 0;
+	for (s32 i = 0; i < builder->posting_count && result; i++)
+	{
+		trigram_index_posting *posting = &builder->postings[i];
+		trigram_index_entry entry;
+		entry.trigram = posting->trigram;
+		entry.file_count = posting->count;
+		entry.postings_offset = postings_offset;
+		result &= fwrite(&entry, sizeof(entry), 1, file) == 1;
+		
+		u32 previous = 0;
+		for (u32 f = 0; f < posting->count; f++)
+		{
+			postings_offset += trigram_index_varint_length(posting->files[f] - previous);
+			previous = posting->files[f];
+		}
+	}
+	
+	u8 buffer[kilobytes(64)];
+	s32 buffer_length = 0;
+	for (s32 i = 0; i < builder->posting_count && result; i++)
+	{
+		trigram_index_posting *posting = &builder->postings[i];
+		u32 previous = 0;
+		for (u32 f = 0; f < posting->count; f++)
+		{
+			if (buffer_length > sizeof(buffer) - 5)
+			{
+				result &= fwrite(buffer, 1, buffer_length, file) == buffer_length;
+				buffer_length = 0;
+			}
+			buffer_length += trigram_index_write_varint(buffer + buffer_length, posting->files[f] - previous);
+			previous = posting->files[f];
+		}
+	}
+	result &= fwrite(buffer, 1, buffer_length, file) == buffer_length;
+	
+	u64 offset = header.postings_offset + postings_size;
+	result &= trigram_index_write_padding(file, &offset);
+	for (s32 i = 0; i < list->length && result; i++)
+	{
+		char *path = ((found_file*)list->data)[i].path;
+		result &= fwrite(path, 1, strlen(path) + 1, file) == strlen(path) + 1;
+	}
+	
+	result &= fclose(file) == 0;
+	if (result) result = trigram_index_replace_file(temp_path, index_path);
+	if (!result) platform_delete_file(temp_path);
+	
+	return result;
+}
+
+bool trigram_index_build_block(trigram_index_build *build)
+{
+	array list = array_create(sizeof(found_file));
+	list.reserve_jump = 1000;
+	memory_bucket bucket = memory_bucket_init(megabytes(1));
+	file_filter filter = file_filter_create(build->filter);
+	platform_list_files_block(&list, build->directory, &filter, build->recursive, &bucket, false, &build->cancel, 0);
+	file_filter_destroy(&filter);
+	
+	// file indices follow the path order so files can be looked up with a binary search
+	qsort(list.data, list.length, sizeof(found_file), trigram_index_compare_found_files);
+	build->file_count = list.length;
+	
+	trigram_index_file *files = mem_alloc(sizeof(trigram_index_file)*(list.length + 1));
+	trigram_index_builder builder = trigram_index_builder_create();
+	
+	s32 thread_count = platform_get_cpu_count();
+	file_reader *reader = file_reader_create(thread_count, build->max_file_size);
+	for (s32 i = 0; i < list.length; i++)
+	{
+		char *path = ((found_file*)list.data)[i].path;
+		
+		// size and time are taken before reading, a file that changes while it is
+		// read is seen as changed by every query
+		trigram_index_file *file = &files[i];
+		file->size = 0;
+		file->mtime = 0;
+		file->flags = TRIGRAM_INDEX_FILE_UNINDEXED;
+		file->unused = 0;
+		if (!trigram_index_stat_file(path, &file->size, &file->mtime)) continue;
+		
+		file_reader_submit(reader, path, (void*)(intptr_t)i);
+	}
+	file_reader_finish_submitting(reader);
+	
+	file_read read;
+	while (!build->cancel && file_reader_next(reader, &read))
+	{
+		s32 index = (intptr_t)read.data;
+		if (read.content.content && !text_search_is_binary(read.content.content, read.content.content_length))
+		{
+			trigram_index_builder_add(&builder, read.content.content, read.content.content_length, index);
+			files[index].flags = 0;
+		}
+		file_reader_release(reader, &read);
+		build->files_indexed++;
+	}
+	file_reader_destroy(reader);
+	
+	bool result = false;
+	if (!build->cancel)
+		result = trigram_index_write(&builder, &list, files, build->index_path);
+	
+	trigram_index_builder_destroy(&builder);
+	mem_free(files);
+	memory_bucket_destroy(&bucket);
+	array_destroy(&list);
+	
+	return result;
+}
+
+static void *trigram_index_build_thread(void *args)
+{
+	trigram_index_build *build = args;
+	build->succeeded = trigram_index_build_block(build);
+	build->done = true;
+	
+	return 0;
+}
+
+static char *trigram_index_copy_string(char *string)
+{
+	s32 length = strlen(string);
+	char *result = mem_alloc(length + 1);
+	string_copyn(result, string, length + 1);
+	return result;
+}
+
+trigram_index_build *trigram_index_build_start(char *directory, char *filter, bool recursive, s32 max_file_size, char *index_path)
+{
+	trigram_index_build *build = mem_alloc(sizeof(trigram_index_build));
+	build->directory = trigram_index_copy_string(directory);
+	build->filter = trigram_index_copy_string(filter);
+	build->index_path = trigram_index_copy_string(index_path);
+	build->recursive = recursive;
+	build->max_file_size = max_file_size;
+	build->cancel = false;
+	build->done = false;
+	build->succeeded = false;
+	build->file_count = 0;
+	build->files_indexed = 0;
+	build->thread = thread_start(trigram_index_build_thread, build);
+	
+	return build;
+}
+
+bool trigram_index_build_finish(trigram_index_build *build)
+{
+	thread_join(&build->thread);
+	bool result = build->succeeded;
+	
+	mem_free(build->directory);
+	mem_free(build->filter);
+	mem_free(build->index_path);
+	mem_free(build);
+	
+	return result;
+}
+
+trigram_index trigram_index_open(char *index_path)
+{
+	trigram_index index;
+	memset(&index, 0, sizeof(trigram_index));
+	
+	if (!trigram_index_map_file(&index, index_path)) return index;
+	
+	trigram_index_header *header = (trigram_index_header*)index.data;
+	u64 size = index.size;
+	bool valid = size >= sizeof(trigram_index_header) &&
+		header->magic == TRIGRAM_INDEX_MAGIC &&
+		header->version == TRIGRAM_INDEX_VERSION &&
+		header->index_size == size &&
+		header->files_offset % 8 == 0 && header->trigrams_offset % 8 == 0 &&
+		header->files_offset >= sizeof(trigram_index_header) &&
+		header->files_offset + (u64)header->file_count*sizeof(trigram_index_file) <= header->trigrams_offset &&
+		header->trigrams_offset + (u64)header->trigram_count*sizeof(trigram_index_entry) <= header->postings_offset &&
+		header->postings_offset <= header->paths_offset &&
+		header->paths_offset <= size;
+	
+	// every path ends with a 0 byte, the last one at the end of the file
+	if (valid && header->file_count) valid = index.data[size-1] == 0;
+	
+	if (!valid)
+	{
+		trigram_index_unmap_file(&index);
+		memset(&index, 0, sizeof(trigram_index));
+		return index;
+	}
+	
+	index.is_open = true;
+	index.header = header;
+	index.files = (trigram_index_file*)(index.data + header->files_offset);
+	index.trigrams = (trigram_index_entry*)(index.data + header->trigrams_offset);
+	index.postings = index.data + header->postings_offset;
+	index.paths = (char*)index.data + header->paths_offset;
+	
+	return index;
+}
+
+void trigram_index_close(trigram_index *index)
+{
+	if (index->is_open) trigram_index_unmap_file(index);
+	if (index->changed) mem_free(index->changed);
+	index->changed = 0;
+	index->watched = false;
+	index->is_open = false;
+}
+
+static trigram_index_entry *trigram_index_find_trigram(trigram_index *index, u32 trigram)
+{
+	s32 low = 0;
+	s32 high = (s32)index->header->trigram_count - 1;
+	while (low <= high)
+	{
+		s32 mid = low + (high - low) / 2;
+		trigram_index_entry *entry = &index->trigrams[mid];
+		if (entry->trigram == trigram) return entry;
+		if (entry->trigram < trigram) low = mid + 1;
+		else high = mid - 1;
+	}
+	return 0;
+}
+
+static s32 trigram_index_find_file(trigram_index *index, char *path)
+{
+	u64 paths_size = index->size - index->header->paths_offset;
+	
+	s32 low = 0;
+	s32 high = (s32)index->header->file_count - 1;
+	while (low <= high)
+	{
+		s32 mid = low + (high - low) / 2;
+		u64 path_offset = index->files[mid].path_offset;
+		if (path_offset >= paths_size) return -1;
+		
+		s32 compare = strcmp(index->paths + path_offset, path);
+		if (compare == 0) return mid;
+		if (compare < 0) low = mid + 1;
+		else high = mid - 1;
+	}
+	return -1;
+}
+
+// trigrams of the literal parts of text_to_find, '*' and '?' split parts. in
+// ignore case mode only ascii bytes are used, except k which the kelvin sign
+// folds to.
+static s32 trigram_index_query_trigrams(char *text_to_find, bool ignore_case, u32 *trigrams)
+{
+	s32 count = 0;
+	s32 run = 0;
+	u32 trigram = 0;
+	for (u8 *ch = (u8*)text_to_find; *ch; ch++)
+	{
+		bool usable = *ch != '*' && *ch != '?';
+		if (ignore_case && (*ch >= 0x80 || trigram_index_lower(*ch) == 'k')) usable = false;
+		if (!usable)
+		{
+			run = 0;
+			continue;
+		}
+		
+		trigram = ((trigram << 8) | trigram_index_lower(*ch)) & 0xFFFFFF;
+		if (++run < 3) continue;
+		
+		bool duplicate = false;
+		for (s32 i = 0; i < count && !duplicate; i++)
+		{
+			duplicate = trigrams[i] == trigram;
+		}
+		if (!duplicate) trigrams[count++] = trigram;
+	}
+	return count;
+}
+
+static s32 trigram_index_compare_entries(const void *a, const void *b)
+{
+	return trigram_index_compare_u32(&(*(trigram_index_entry**)a)->file_count, &(*(trigram_index_entry**)b)->file_count);
+}
+
+trigram_index_query trigram_index_query_create(trigram_index *index, char *text_to_find, bool ignore_case)
+{
+	trigram_index_query query;
+	query.use_index = false;
+	query.candidates = 0;
+	
+	if (!index->is_open) return query;
+	
+	s32 length = strlen(text_to_find);
+	u32 *trigrams = mem_alloc(sizeof(u32)*(length + 1));
+	trigram_index_entry **entries = mem_alloc(sizeof(trigram_index_entry*)*(length + 1));
+	s32 trigram_count = trigram_index_query_trigrams(text_to_find, ignore_case, trigrams);
+	
+	s32 file_count = index->header->file_count;
+	u32 *files = 0;
+	s32 candidate_count = 0;
+	bool valid = trigram_count > 0;
+	bool missing = false;
+	for (s32 i = 0; i < trigram_count && !missing; i++)
+	{
+		entries[i] = trigram_index_find_trigram(index, trigrams[i]);
+		if (!entries[i]) missing = true;
+		else if (entries[i]->file_count > file_count) valid = false;
+	}
+	
+	// the shortest posting list is decoded, the others are merged into it
+	if (valid && !missing)
+	{
+		qsort(entries, trigram_count, sizeof(trigram_index_entry*), trigram_index_compare_entries);
+		
+		u8 *end = (u8*)index->paths;
+		files = mem_alloc(sizeof(u32)*(entries[0]->file_count + 1));
+		for (s32 i = 0; i < trigram_count && valid; i++)
+		{
+			trigram_index_entry *entry = entries[i];
+			if (entry->postings_offset >= (u64)(end - index->postings))
+			{
+				valid = false;
+				break;
+			}
+			
+			u8 *cursor = index->postings + entry->postings_offset;
+			u32 file = 0;
+			s32 kept = 0;
+			s32 c = 0;
+			for (u32 f = 0; f < entry->file_count && (i == 0 || c < candidate_count); f++)
+			{
+				u32 delta;
+				if (!trigram_index_read_varint(&cursor, end, &delta) || file + delta >= file_count)
+				{
+					valid = false;
+					break;
+				}
+				file += delta;
+				
+				if (i == 0)
+				{
+					files[kept++] = file;
+					continue;
+				}
+				
+				while (c < candidate_count && files[c] < file) c++;
+				if (c < candidate_count && files[c] == file) files[kept++] = files[c++];
+			}
+			candidate_count = kept;
+		}
+	}
+	
+	if (valid)
+	{
+		query.use_index = true;
+		query.candidates = mem_alloc(file_count/8 + 1);
+		memset(query.candidates, 0, file_count/8 + 1);
+		for (s32 i = 0; i < candidate_count && !missing; i++)
+		{
+			query.candidates[files[i] / 8] |= 1 << (files[i] % 8);
+		}
+	}
+	
+	if (files) mem_free(files);
+	mem_free(entries);
+	mem_free(trigrams);
+	
+	return query;
+}
+
+bool trigram_index_may_match(trigram_index *index, trigram_index_query *query, char *path)
+{
+	if (!query->use_index) return true;
+	
+	s32 file_index = trigram_index_find_file(index, path);
+	if (file_index == -1) return true;
+	
+	trigram_index_file *file = &index->files[file_index];
+	if (file->flags & TRIGRAM_INDEX_FILE_UNINDEXED) return true;
+	if (query->candidates[file_index / 8] & (1 << (file_index % 8))) return true;
+	if (index->watched) return (index->changed[file_index / 8] & (1 << (file_index % 8))) != 0;
+	
+	// the index only knows what the file contained when it was built
+	u64 size, mtime;
+	if (!trigram_index_stat_file(path, &size, &mtime)) return true;
+	return size != file->size || mtime != file->mtime;
+}
+
+void trigram_index_query_destroy(trigram_index_query *query)
+{
+	if (query->candidates) mem_free(query->candidates);
+	query->candidates = 0;
+	query->use_index = false;
+}
+
+void trigram_index_watch(trigram_index *index)
+{
+	if (!index->is_open || index->watched) return;
+	
+	s32 file_count = index->header->file_count;
+	if (!index->changed)
+	{
+		index->changed = mem_alloc(file_count/8 + 1);
+		memset(index->changed, 0, file_count/8 + 1);
+	}
+	index->watched = true;
+}
+
+static void trigram_index_mark_changed(trigram_index *index, char *path)
+{
+	s32 file_index = trigram_index_find_file(index, path);
+	if (file_index != -1) index->changed[file_index / 8] |= 1 << (file_index % 8);
+}
+
+void trigram_index_apply_event(trigram_index *index, file_watcher_event *event)
+{
+	if (!index->changed) return;
+	
+	// files that are not in the index are always searched, deleted files are
+	// not listed anymore
+	switch(event->type)
+	{
+		case FILE_WATCHER_OVERFLOW: index->watched = false; break;
+		case FILE_WATCHER_RENAMED:
+		{
+			trigram_index_mark_changed(index, event->old_path);
+			trigram_index_mark_changed(index, event->path);
+		} break;
+		case FILE_WATCHER_CREATED:
+		case FILE_WATCHER_MODIFIED:
+		case FILE_WATCHER_DELETED: trigram_index_mark_changed(index, event->path); break;
+	}
+}
\ No newline at end of file
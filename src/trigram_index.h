@@ -0,0 +1,125 @@
+/* 
+*  BSD 2-Clause “Simplified” License
+*  Copyright (c) 2019, Aldrik Ramaekers, aldrik.ramaekers@protonmail.com
+*  All rights reserved.
+*/
+
+#ifndef INCLUDE_TRIGRAM_INDEX
+#define INCLUDE_TRIGRAM_INDEX
+
+// Index file layout, all sections are 8 byte aligned and offsets are from the
+// start of the file:
+// header | files, sorted by path | trigrams, sorted | postings | paths
+// posting lists are varint encoded deltas between ascending file indices.
+#define TRIGRAM_INDEX_MAGIC 0x58444954 // "TIDX"
+#define TRIGRAM_INDEX_VERSION 1
+
+// trigrams are indexed with ascii letters in lower case so the same index
+// works for case sensitive and ignore case queries.
+#define TRIGRAM_INDEX_FILE_UNINDEXED 1 // binary, too big or unreadable, always a candidate
+
+typedef struct t_trigram_index_header
+{
+	u32 magic;
+	u32 version;
+	u32 file_count;
+	u32 trigram_count;
+	u64 files_offset;
+	u64 trigrams_offset;
+	u64 postings_offset;
+	u64 paths_offset;
+	u64 index_size;
+} trigram_index_header;
+
+typedef struct t_trigram_index_file
+{
+	u64 path_offset; // from paths_offset
+	u64 size;
+	u64 mtime; // nanoseconds, only compared for equality
+	u32 flags;
+	u32 unused;
+} trigram_index_file;
+
+typedef struct t_trigram_index_entry
+{
+	u32 trigram;
+	u32 file_count;
+	u64 postings_offset; // from postings_offset
+} trigram_index_entry;
+
+typedef struct t_trigram_index
+{
+	bool is_open;
+	u8 *data;
+	s64 size;
+	void *mapping; // platform handle of the mapping
+	trigram_index_header *header;
+	trigram_index_file *files;
+	trigram_index_entry *trigrams;
+	u8 *postings;
+	char *paths;
+	
+	// files a file watcher reported as changed since the index was built
+	bool watched;
+	u8 *changed; // bit per file in the index
+} trigram_index;
+
+typedef struct t_trigram_index_query
+{
+	bool use_index; // false when the query has no usable trigram, every file is a candidate
+	u8 *candidates; // bit per file in the index
+} trigram_index_query;
+
+typedef struct t_trigram_index_build
+{
+	char *directory; // ends with a path separator, like platform_list_files
+	char *filter;
+	char *index_path;
+	bool recursive;
+	s32 max_file_size;
+	thread thread;
+	bool cancel;
+	bool done;
+	bool succeeded;
+	s32 file_count; // listed files
+	s32 files_indexed;
+} trigram_index_build;
+
+// trigram_index_build_start builds the index of directory on a background thread
+// and replaces the file at index_path when it is done. on linux readers that have
+// the old index open keep using it, on windows it can't be replaced while open.
+// check build->done and call trigram_index_build_finish once to free the build,
+// set build->cancel to stop early.
+trigram_index_build *trigram_index_build_start(char *directory, char *filter, bool recursive, s32 max_file_size, char *index_path);
+bool trigram_index_build_finish(trigram_index_build *build);
+bool trigram_index_build_block(trigram_index_build *build);
+
+// the index is memory-mapped, is_open is false when index_path does not exist or
+// is not a valid index.
+trigram_index trigram_index_open(char *index_path);
+void trigram_index_close(trigram_index *index);
+
+// a file can only contain text_to_find when it contains every trigram of its
+// literal parts. trigram_index_may_match returns true for files that are not in
+// the index or changed since it was built, only files it returns true for have to
+// be verified with string_contains_ex.
+trigram_index_query trigram_index_query_create(trigram_index *index, char *text_to_find, bool ignore_case);
+bool trigram_index_may_match(trigram_index *index, trigram_index_query *query, char *path);
+void trigram_index_query_destroy(trigram_index_query *query);
+
+// a watched index trusts the events of a file watcher instead of checking the
+// size and time of every file that is not a candidate. the subscription has to be
+// made before the index is built, FILE_WATCHER_OVERFLOW turns checking back on.
+// unlike the check a change is only seen once its event is applied, the watcher
+// reports writes with a short delay and up to FILE_WATCHER_RESCAN_INTERVAL_MS
+// late when it rescans.
+void trigram_index_watch(trigram_index *index);
+void trigram_index_apply_event(trigram_index *index, file_watcher_event *event);
+
+// implemented per platform
+bool trigram_index_map_file(trigram_index *index, char *path);
+void trigram_index_unmap_file(trigram_index *index);
+bool trigram_index_stat_file(char *path, u64 *size, u64 *mtime);
+bool trigram_index_replace_file(char *from, char *to);
+
+#endif
\ No newline at end of file
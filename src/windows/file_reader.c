@@ -0,0 +1,51 @@
+/* 
+*  BSD 2-Clause “Simplified” License
+*  Copyright (c) 2019, Aldrik Ramaekers, aldrik.ramaekers@protonmail.com
+*  All rights reserved.
+*/
+
+file_content file_reader_read_blocking(file_reader *reader, char *path, s64 *reserved)
+{
+	file_content result;
+	result.content = 0;
+	result.content_length = 0;
+	result.file_error = 0;
+	*reserved = 0;
+	
+	// the error of a file that can't be opened comes from platform_read_file_content
+	s64 size = platform_get_file_size(path);
+	if (reader->max_file_size && size > reader->max_file_size)
+	{
+		result.file_error = FILE_ERROR_TOO_BIG;
+		return result;
+	}
+	
+	if (size >= 0)
+	{
+		if (!file_reader_wait_for_budget(reader, size+1))
+		{
+			result.file_error = FILE_ERROR_GENERIC;
+			return result;
+		}
+		*reserved = size+1;
+	}
+	
+	// a file that grows in between takes a little more than it reserved
+	result = platform_read_file_content(path, "rb");
+	if (!result.content && *reserved)
+	{
+		file_reader_unreserve(reader, *reserved);
+		*reserved = 0;
+	}
+	return result;
+}
+
+// no io_uring on windows, always use the thread pool
+bool file_reader_io_uring_start(file_reader *reader)
+{
+	return false;
+}
+
+void file_reader_io_uring_stop(file_reader *reader)
+{
+}
\ No newline at end of file
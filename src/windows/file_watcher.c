@@ -0,0 +1,77 @@
+/* 
+*  BSD 2-Clause “Simplified” License
+*  Copyright (c) 2019, Aldrik Ramaekers, aldrik.ramaekers@protonmail.com
+*  All rights reserved.
+*/
+
+char file_watcher_separator()
+{
+	return '\\';
+}
+
+// no native notifications on windows yet, the tree is rescanned
+bool file_watcher_backend_start(file_watcher *watcher)
+{
+	return false;
+}
+
+void file_watcher_backend_stop(file_watcher *watcher)
+{
+}
+
+bool file_watcher_backend_wait(file_watcher *watcher)
+{
+	return false;
+}
+
+static u64 file_watcher_filetime(FILETIME time)
+{
+	// 100 nanosecond intervals
+	return (((u64)time.dwHighDateTime << 32) | time.dwLowDateTime) * 100;
+}
+
+void file_watcher_scan(file_watcher *watcher, char *directory)
+{
+	char pattern[MAX_INPUT_LENGTH];
+	snprintf(pattern, MAX_INPUT_LENGTH, "%s*", directory);
+	
+	WIN32_FIND_DATAA data;
+	HANDLE find = FindFirstFileA(pattern, &data);
+	if (find == INVALID_HANDLE_VALUE) return;
+	
+	do
+	{
+		if (watcher->stop) break;
+		if ((strcmp(data.cFileName, ".") == 0) || (strcmp(data.cFileName, "..") == 0))
+			continue;
+		if (data.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT)
+			continue;
+		
+		char path[MAX_INPUT_LENGTH];
+		snprintf(path, MAX_INPUT_LENGTH, "%s%s", directory, data.cFileName);
+		if (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+		{
+			string_appendn(path, "\\", MAX_INPUT_LENGTH);
+			file_watcher_scan(watcher, path);
+		}
+		else
+		{
+			file_watcher_file_found(watcher, path, ((u64)data.nFileSizeHigh << 32) | data.nFileSizeLow,
+									file_watcher_filetime(data.ftLastWriteTime));
+		}
+	}
+	while (FindNextFileA(find, &data));
+	
+	FindClose(find);
+}
+
+bool file_watcher_stat(char *path, bool *is_directory, u64 *size, u64 *mtime)
+{
+	WIN32_FILE_ATTRIBUTE_DATA data;
+	if (!GetFileAttributesExA(path, GetFileExInfoStandard, &data)) return false;
+	
+	*is_directory = (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0;
+	*size = ((u64)data.nFileSizeHigh << 32) | data.nFileSizeLow;
+	*mtime = file_watcher_filetime(data.ftLastWriteTime);
+	return true;
+}
\ No newline at end of file
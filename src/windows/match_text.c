@@ -0,0 +1,39 @@
+/* 
+*  BSD 2-Clause “Simplified” License
+*  Copyright (c) 2019, Aldrik Ramaekers, aldrik.ramaekers@protonmail.com
+*  All rights reserved.
+*/
+
+bool match_text_open_file(match_text *text, char *path)
+{
+	HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+	if (file == INVALID_HANDLE_VALUE) return false;
+	
+	text->file = file;
+	return true;
+}
+
+s32 match_text_read_file(match_text *text, s64 offset, char *buffer, s32 length)
+{
+	s32 total = 0;
+	while (total < length)
+	{
+		// the offset of a synchronous read is given with the overlapped struct
+		OVERLAPPED overlapped;
+		memset(&overlapped, 0, sizeof(overlapped));
+		overlapped.Offset = (DWORD)(offset+total);
+		overlapped.OffsetHigh = (DWORD)((offset+total) >> 32);
+		
+		DWORD read = 0;
+		if (!ReadFile(text->file, buffer+total, length-total, &read, &overlapped))
+			return GetLastError() == ERROR_HANDLE_EOF ? total : -1;
+		if (read == 0) break;
+		total += read;
+	}
+	return total;
+}
+
+void match_text_close_file(match_text *text)
+{
+	CloseHandle(text->file);
+}
\ No newline at end of file
@@ -11,6 +11,7 @@
 #include <wingdi.h>
 #include <gdiplus.h>
 #include <shlobj.h>
+#include <psapi.h>
 #include "../external/LooplessSizeMove.c"
 
 struct t_platform_window
@@ -985,6 +986,74 @@ s32 platform_get_file_size(char *path)
 	return length;
 }
 
+bool platform_get_file_info(char *path, file_info *info)
+{
+	// the file index is only available from an open handle, backup semantics
+	// allows opening directories
+	HANDLE file = CreateFileA(path, 0, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+							  0, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS, 0);
+	if (file == INVALID_HANDLE_VALUE) return false;
+	
+	BY_HANDLE_FILE_INFORMATION data;
+	bool result = GetFileInformationByHandle(file, &data);
+	CloseHandle(file);
+	if (!result) return false;
+	
+	info->size = ((u64)data.nFileSizeHigh << 32) | data.nFileSizeLow;
+	info->mtime = (((u64)data.ftLastWriteTime.dwHighDateTime << 32) | data.ftLastWriteTime.dwLowDateTime) * 100;
+	info->device = data.dwVolumeSerialNumber;
+	info->inode = ((u64)data.nFileIndexHigh << 32) | data.nFileIndexLow;
+	info->is_directory = (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0;
+	return true;
+}
+
+u64 platform_get_file_physical_offset(char *path)
+{
+	HANDLE file = CreateFileA(path, FILE_READ_ATTRIBUTES, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+							  0, OPEN_EXISTING, 0, 0);
+	if (file == INVALID_HANDLE_VALUE) return 0;
+	
+	// room for the first extent only, fragmented files return ERROR_MORE_DATA.
+	// the position is in clusters, which orders the same as bytes
+	STARTING_VCN_INPUT_BUFFER input;
+	input.StartingVcn.QuadPart = 0;
+	RETRIEVAL_POINTERS_BUFFER output;
+	DWORD bytes;
+	
+	u64 result = 0;
+	if (DeviceIoControl(file, FSCTL_GET_RETRIEVAL_POINTERS, &input, sizeof(input), &output, sizeof(output), &bytes, 0) ||
+		GetLastError() == ERROR_MORE_DATA)
+	{
+		if (output.ExtentCount && output.Extents[0].Lcn.QuadPart != -1)
+			result = output.Extents[0].Lcn.QuadPart;
+	}
+	CloseHandle(file);
+	
+	return result;
+}
+
+bool platform_evict_file_cache(char *path)
+{
+	// the cache manager drops the cached pages of a file that is opened without buffering
+	HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+							  0, OPEN_EXISTING, FILE_FLAG_NO_BUFFERING, 0);
+	if (file == INVALID_HANDLE_VALUE) return false;
+	
+	CloseHandle(file);
+	return true;
+}
+
+// links are followed
+static bool platform_get_file_dedup_identity(char *path, file_identity *identity)
+{
+	file_info info;
+	if (!platform_get_file_info(path, &info)) return false;
+	
+	identity->device = info.device;
+	identity->inode = info.inode;
+	return true;
+}
+
 file_content platform_read_file_content(char *path, const char *mode)
 {
 	file_content result;
@@ -1053,6 +1122,11 @@ void platform_delete_file(char *path)
 	remove(path);
 }
 
+void platform_create_directory(char *path)
+{
+	CreateDirectoryA(path, NULL);
+}
+
 bool platform_write_file_content(char *path, const char *mode, char *buffer, s32 len)
 {
 	bool result = false;
@@ -1091,40 +1165,36 @@ bool set_active_directory(char *path)
 	return SetCurrentDirectory(path);
 }
 
-void platform_list_files_block(array *list, char *start_dir, array filters, bool recursive, memory_bucket *bucket,  bool include_directories, bool *is_cancelled, search_info *info)
+void platform_list_files_block(array *list, char *start_dir, file_filter *filter, bool recursive, memory_bucket *bucket,  bool include_directories, bool *is_cancelled, search_info *info)
 {
 	assert(list);
 	s32 len = 0;
 	char *matched_filter = 0;
 	
-	char *subdirname_buf;
-	if (bucket)
-		subdirname_buf = memory_bucket_reserve(bucket, MAX_INPUT_LENGTH);
-	else
-		subdirname_buf = mem_alloc(MAX_INPUT_LENGTH);
-	
-	char *start_dir_fix;
-	if (bucket)
-		start_dir_fix = memory_bucket_reserve(bucket, MAX_INPUT_LENGTH);
-	else
-		start_dir_fix = mem_alloc(MAX_INPUT_LENGTH);
+	// only found files go in the bucket, it is kept for the whole search
+	char *subdirname_buf = mem_alloc(MAX_INPUT_LENGTH);
+	char *start_dir_fix = mem_alloc(MAX_INPUT_LENGTH);
 	snprintf(start_dir_fix, MAX_INPUT_LENGTH, "%s*", start_dir);
 	
-	char *start_dir_clean;
-	if (bucket)
-		start_dir_clean = memory_bucket_reserve(bucket, MAX_INPUT_LENGTH);
-	else
-		start_dir_clean = mem_alloc(MAX_INPUT_LENGTH);
+	char *start_dir_clean = mem_alloc(MAX_INPUT_LENGTH);
 	string_copyn(start_dir_clean, start_dir, MAX_INPUT_LENGTH);
 	
+	// subdirectories are checked before they are entered, except the first one
+	file_dedup *dedup = info ? info->dedup : 0;
+	file_identity identity;
+	if (dedup && !dedup->has_root && platform_get_file_dedup_identity(start_dir, &identity))
+		file_dedup_set_root(dedup, identity);
+	u64 device = dedup ? dedup->device : 0;
+	
 	WIN32_FIND_DATAA file_info;
 	HWND handle = FindFirstFileA(start_dir_fix, &file_info);
 	
-	if (!bucket)
-		mem_free(start_dir_fix);
+	mem_free(start_dir_fix);
 	
 	if (handle == INVALID_HANDLE_VALUE)
 	{
+		mem_free(subdirname_buf);
+		mem_free(start_dir_clean);
 		return;
 	}
 	
@@ -1133,8 +1203,8 @@ void platform_list_files_block(array *list, char *start_dir, array filters, bool
 		if (*is_cancelled) break;
 		char *name = file_info.cFileName;
 		
-		// symbolic link is not allowed..
-		if ((file_info.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT))
+		// links are only followed when the dedup set can stop a loop
+		if ((file_info.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT) && !(dedup && dedup->follow_symlinks))
 			continue;
 		
 		
@@ -1143,21 +1213,29 @@ void platform_list_files_block(array *list, char *start_dir, array filters, bool
 			if ((strcmp(name, ".") == 0) || (strcmp(name, "..") == 0))
 				continue;
 			
+			// the whole subtree is skipped
+			if (info && info->ignore && file_ignore_matches(info->ignore, name, true))
+			{
+				info->ignored_dir_count++;
+				continue;
+			}
+			
+			// mounted folders and followed links can lead to a directory that was walked already
+			if (dedup)
+			{
+				snprintf(subdirname_buf, MAX_INPUT_LENGTH, "%s%s", start_dir_clean, name);
+				if (!platform_get_file_dedup_identity(subdirname_buf, &identity) || !file_dedup_visit_directory(dedup, identity))
+					continue;
+			}
+			
 			if (include_directories)
 			{
-				if ((len = filter_matches(&filters, name, 
+				if ((len = file_filter_matches(filter, name, 
 										  &matched_filter)) && len != -1)
 				{
 					// is file
-					char *buf;
-					if (bucket)
-						buf = memory_bucket_reserve(bucket, MAX_INPUT_LENGTH);
-					else
-						buf = mem_alloc(MAX_INPUT_LENGTH);
-					snprintf(buf, MAX_INPUT_LENGTH, "%s%s",start_dir, name);
-					
 					found_file f;
-					f.path = buf;
+					f.path = create_found_file_path(bucket, start_dir, name);
 					
 					if (bucket)
 						f.matched_filter= memory_bucket_reserve(bucket, len+1);
@@ -1181,7 +1259,11 @@ void platform_list_files_block(array *list, char *start_dir, array filters, bool
 				string_appendn(subdirname_buf, "\\", MAX_INPUT_LENGTH);
 				
 				// is directory
-				platform_list_files_block(list, subdirname_buf, filters, recursive, bucket, include_directories, is_cancelled, info);
+				if (info && info->ignore) file_ignore_enter(info->ignore, subdirname_buf, name);
+				if (dedup) dedup->device = identity.device;
+				platform_list_files_block(list, subdirname_buf, filter, recursive, bucket, include_directories, is_cancelled, info);
+				if (dedup) dedup->device = device;
+				if (info && info->ignore) file_ignore_leave(info->ignore);
 			}
 		}
 		else if ((file_info.dwFileAttributes & FILE_ATTRIBUTE_COMPRESSED) ||
@@ -1191,22 +1273,28 @@ void platform_list_files_block(array *list, char *start_dir, array filters, bool
 				 (file_info.dwFileAttributes & FILE_ATTRIBUTE_READONLY) ||
 				 (file_info.dwFileAttributes & FILE_ATTRIBUTE_ARCHIVE))
 		{
+			if (info && info->ignore && file_ignore_matches(info->ignore, name, false))
+			{
+				info->ignored_file_count++;
+				continue;
+			}
+			
+			// a hard link or followed link to a file that was found already
+			if (dedup)
+			{
+				snprintf(subdirname_buf, MAX_INPUT_LENGTH, "%s%s", start_dir_clean, name);
+				if (!platform_get_file_dedup_identity(subdirname_buf, &identity) || !file_dedup_visit_file(dedup, identity))
+					continue;
+			}
+			
 			if (info) info->file_count++;
 			
-			if ((len = filter_matches(&filters, name, 
+			if ((len = file_filter_matches(filter, name, 
 									  &matched_filter)) && len != -1)
 			{
 				// is file
-				char *buf;
-				if (bucket)
-					buf = memory_bucket_reserve(bucket, MAX_INPUT_LENGTH);
-				else
-					buf = mem_alloc(MAX_INPUT_LENGTH);
-				
-				snprintf(buf, MAX_INPUT_LENGTH, "%s%s",start_dir, name);
-				
 				found_file f;
-				f.path = buf;
+				f.path = create_found_file_path(bucket, start_dir, name);
 				
 				if (bucket)
 					f.matched_filter = memory_bucket_reserve(bucket, len+1);
@@ -1223,8 +1311,8 @@ void platform_list_files_block(array *list, char *start_dir, array filters, bool
 	}
 	while (FindNextFile(handle, &file_info) != 0);
 	
-	if (!bucket)
-		mem_free(start_dir_clean);
+	mem_free(subdirname_buf);
+	mem_free(start_dir_clean);
 	
 	FindClose(handle);
 }
@@ -1445,6 +1533,14 @@ s32 platform_get_memory_size()
 	return result;
 }
 
+u64 platform_get_peak_memory_usage()
+{
+	PROCESS_MEMORY_COUNTERS counters;
+	if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) return 0;
+	
+	return counters.PeakWorkingSetSize;
+}
+
 s32 platform_get_cpu_count()
 {
 	SYSTEM_INFO info;
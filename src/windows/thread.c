@@ -65,7 +65,8 @@ void thread_exit()
 
 void thread_sleep(u64 microseconds)
 {
-	Sleep(microseconds/1000);
+	// rounded up, Sleep(0) only gives up the time slice
+	Sleep((DWORD)((microseconds+999)/1000));
 }
 
 mutex mutex_create()
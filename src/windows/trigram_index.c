@@ -0,0 +1,57 @@
+/* 
+*  BSD 2-Clause “Simplified” License
+*  Copyright (c) 2019, Aldrik Ramaekers, aldrik.ramaekers@protonmail.com
+*  All rights reserved.
+*/
+
+bool trigram_index_map_file(trigram_index *index, char *path)
+{
+	HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+	if (file == INVALID_HANDLE_VALUE) return false;
+	
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(file, &size) || size.QuadPart == 0)
+	{
+		CloseHandle(file);
+		return false;
+	}
+	
+	// the mapping keeps the file open
+	HANDLE mapping = CreateFileMappingA(file, 0, PAGE_READONLY, 0, 0, 0);
+	CloseHandle(file);
+	if (!mapping) return false;
+	
+	void *data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if (!data)
+	{
+		CloseHandle(mapping);
+		return false;
+	}
+	
+	index->data = data;
+	index->size = size.QuadPart;
+	index->mapping = mapping;
+	return true;
+}
+
+void trigram_index_unmap_file(trigram_index *index)
+{
+	UnmapViewOfFile(index->data);
+	CloseHandle(index->mapping);
+}
+
+bool trigram_index_stat_file(char *path, u64 *size, u64 *mtime)
+{
+	WIN32_FILE_ATTRIBUTE_DATA data;
+	if (!GetFileAttributesExA(path, GetFileExInfoStandard, &data)) return false;
+	
+	*size = ((u64)data.nFileSizeHigh << 32) | data.nFileSizeLow;
+	// 100 nanosecond intervals
+	*mtime = (((u64)data.ftLastWriteTime.dwHighDateTime << 32) | data.ftLastWriteTime.dwLowDateTime) * 100;
+	return true;
+}
+
+bool trigram_index_replace_file(char *from, char *to)
+{
+	return MoveFileExA(from, to, MOVEFILE_REPLACE_EXISTING) != 0;
+}
\ No newline at end of file
@@ -0,0 +1,122 @@
+/* 
+*  BSD 2-Clause “Simplified” License
+*  Copyright (c) 2019, Aldrik Ramaekers, aldrik.ramaekers@protonmail.com
+*  All rights reserved.
+*/
+
+worker_control worker_control_create(s32 min_count, s32 max_count)
+{
+	worker_control control;
+	memset(&control, 0, sizeof(worker_control));
+	if (max_count < 1) max_count = 1;
+	if (min_count < 1) min_count = 1;
+	if (min_count > max_count) min_count = max_count;
+	
+	control.min_count = min_count;
+	control.max_count = max_count;
+	control.active_count = max_count;
+	control.stats = mem_alloc(sizeof(worker_stats)*max_count);
+	memset(control.stats, 0, sizeof(worker_stats)*max_count);
+	control.lowest_count = max_count;
+	control.highest_count = max_count;
+	control.start_time = platform_get_time(TIME_FULL, TIME_US);
+	control.last_update = control.start_time;
+	
+	return control;
+}
+
+void worker_control_destroy(worker_control *control)
+{
+	mem_free(control->stats);
+	control->stats = 0;
+}
+
+bool worker_control_is_active(worker_control *control, s32 index)
+{
+	return index < __atomic_load_n(&control->active_count, __ATOMIC_RELAXED);
+}
+
+void worker_control_add_busy(worker_control *control, s32 index, u64 us, u64 bytes)
+{
+	worker_stats *stats = &control->stats[index];
+	__atomic_fetch_add(&stats->busy_us, us, __ATOMIC_RELAXED);
+	__atomic_fetch_add(&stats->bytes, bytes, __ATOMIC_RELAXED);
+	__atomic_fetch_add(&stats->files, 1, __ATOMIC_RELAXED);
+}
+
+void worker_control_add_blocked(worker_control *control, s32 index, u64 us)
+{
+	__atomic_fetch_add(&control->stats[index].blocked_us, us, __ATOMIC_RELAXED);
+}
+
+static void worker_control_set_count(worker_control *control, s32 count, s32 change)
+{
+	__atomic_store_n(&control->active_count, count, __ATOMIC_RELAXED);
+	control->last_change = change;
+	if (!change) return;
+	
+	control->change_count++;
+	if (count < control->lowest_count) control->lowest_count = count;
+	if (count > control->highest_count) control->highest_count = count;
+}
+
+void worker_control_update(worker_control *control)
+{
+	u64 now = platform_get_time(TIME_FULL, TIME_US);
+	u64 elapsed = now - control->last_update;
+	if (elapsed < WORKER_CONTROL_INTERVAL_US) return;
+	
+	worker_stats total;
+	memset(&total, 0, sizeof(worker_stats));
+	for (s32 i = 0; i < control->max_count; i++)
+	{
+		worker_stats *stats = &control->stats[i];
+		total.busy_us += __atomic_load_n(&stats->busy_us, __ATOMIC_RELAXED);
+		total.blocked_us += __atomic_load_n(&stats->blocked_us, __ATOMIC_RELAXED);
+		total.bytes += __atomic_load_n(&stats->bytes, __ATOMIC_RELAXED);
+		total.files += __atomic_load_n(&stats->files, __ATOMIC_RELAXED);
+	}
+	
+	u64 busy = total.busy_us - control->last_total.busy_us;
+	u64 blocked = total.blocked_us - control->last_total.blocked_us;
+	f32 throughput = (total.bytes - control->last_total.bytes) / (f32)elapsed;
+	
+	s32 count = control->active_count;
+	control->count_time_sum += (u64)count * elapsed;
+	control->last_total = total;
+	control->last_update = now;
+	
+	// nothing was searched, there is nothing to compare
+	if (!busy && !blocked) return;
+	if (control->min_count == control->max_count) return;
+	
+	f32 busy_fraction = busy / (f32)(busy + blocked);
+	if (control->last_change && throughput < control->last_throughput * (1.0f - WORKER_CONTROL_TOLERANCE))
+	{
+		// the count is left alone for a while so it doesn't flip back and forth
+		worker_control_set_count(control, count - control->last_change, -control->last_change);
+		control->last_change = 0;
+		control->hold = WORKER_CONTROL_HOLD_INTERVALS;
+	}
+	else if (control->hold)
+	{
+		control->hold--;
+		control->last_change = 0;
+	}
+	else if (busy_fraction > WORKER_CONTROL_BUSY_HIGH && count < control->max_count)
+		worker_control_set_count(control, count+1, 1);
+	else if (busy_fraction < WORKER_CONTROL_BUSY_LOW && count > control->min_count)
+		worker_control_set_count(control, count-1, -1);
+	else
+		control->last_change = 0;
+	
+	control->last_throughput = throughput;
+}
+
+f32 worker_control_average_count(worker_control *control)
+{
+	u64 elapsed = control->last_update - control->start_time;
+	if (!elapsed) return control->active_count;
+	
+	return control->count_time_sum / (f32)elapsed;
+}
\ No newline at end of file
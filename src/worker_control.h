@@ -0,0 +1,76 @@
+/* 
+*  BSD 2-Clause “Simplified” License
+*  Copyright (c) 2019, Aldrik Ramaekers, aldrik.ramaekers@protonmail.com
+*  All rights reserved.
+*/
+
+#ifndef INCLUDE_WORKER_CONTROL
+#define INCLUDE_WORKER_CONTROL
+
+// time between two decisions of the controller
+#define WORKER_CONTROL_INTERVAL_US 200000
+// workers that are busy more than this fraction of the time have to wait for cpu,
+// one more can help
+#define WORKER_CONTROL_BUSY_HIGH 0.85f
+// workers that are busy less than this fraction of the time wait for reads, one
+// less does the same work
+#define WORKER_CONTROL_BUSY_LOW 0.5f
+// a change is undone when throughput drops more than this fraction after it
+#define WORKER_CONTROL_TOLERANCE 0.05f
+// intervals without a change after a change was undone
+#define WORKER_CONTROL_HOLD_INTERVALS 5
+// parked workers check this often whether they can work again
+#define WORKER_CONTROL_PARK_US 1000
+
+// time and work of one worker, only written by that worker
+typedef struct t_worker_stats
+{
+	u64 busy_us; // working on a file
+	u64 blocked_us; // waiting for the next file
+	u64 bytes;
+	u64 files;
+} worker_stats;
+
+// Controller for a pool of max_count workers of which only the first active_count
+// take work, the others are parked. The thread that owns the pool calls
+// worker_control_update regularly, which compares how much of their time the
+// active workers were busy and how many bytes they got through with the previous
+// interval, and grows or shrinks active_count by one between min_count and
+// max_count. A change that made throughput worse is undone.
+typedef struct t_worker_control
+{
+	s32 min_count;
+	s32 max_count;
+	s32 active_count; // read by the workers without locking
+	worker_stats *stats; // one per worker
+	
+	u64 last_update; // microseconds
+	worker_stats last_total;
+	f32 last_throughput; // bytes per microsecond in the previous interval
+	s32 last_change; // -1, 0 or 1
+	s32 hold; // intervals left without changes
+	
+	// statistics of the chosen counts
+	s32 lowest_count;
+	s32 highest_count;
+	s32 change_count;
+	u64 count_time_sum; // active_count * microseconds, for the average
+	u64 start_time;
+} worker_control;
+
+// starts with every worker active, min_count == max_count keeps the count fixed
+worker_control worker_control_create(s32 min_count, s32 max_count);
+void worker_control_destroy(worker_control *control);
+
+// called by worker index before it takes work
+bool worker_control_is_active(worker_control *control, s32 index);
+void worker_control_add_busy(worker_control *control, s32 index, u64 us, u64 bytes);
+void worker_control_add_blocked(worker_control *control, s32 index, u64 us);
+
+// called by the owner of the pool, does nothing until WORKER_CONTROL_INTERVAL_US passed
+void worker_control_update(worker_control *control);
+
+// time weighted average of active_count since the controller was created
+f32 worker_control_average_count(worker_control *control);
+
+#endif
\ No newline at end of file